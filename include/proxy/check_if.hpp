@@ -27,24 +27,39 @@
 #ifndef CHECK_IF_H
 #define CHECK_IF_H
 
-#include "include/utils/if_prop.hpp"
+#include "include/utils/if_cache.hpp"
+#include "include/utils/netlink_socket.hpp"
 #include "vector"
+#include <map>
 
 /**
  * @brief Monitored running state the network interfaces.
+ *        The state is tracked with rtnetlink events (RTMGRP_LINK, RTMGRP_IPV4_IFADDR and RTMGRP_IPV6_IFADDR),
+ *        if no netlink socket can be opened the interfaces are polled with getifaddrs().
+ *        Every event refreshes the process wide #if_cache.
  */
 class check_if
 {
 private:
     int m_addr_family;
 
-    if_prop m_if_property_a;
-    if_prop m_if_property_b;
-    if_prop* m_current_prop;
-
     std::vector<int> m_check_lst;
     std::vector<int> m_swap_to_up;
     std::vector<int> m_swap_to_down;
+    std::vector<int> m_addr_changed;
+
+    netlink_socket m_nl_sock;
+    std::vector<char> m_buf;
+    std::map<int, bool> m_running; //if_index to running state
+
+    //running state of an interface in an if_cache snapshot
+    bool is_running(const if_cache_snapshot& snapshot, int if_index);
+
+    //refresh the interface cache and compare the running state of all monitored interfaces with it
+    bool resync();
+
+    //handle a RTM_NEWLINK, RTM_DELLINK, RTM_NEWADDR or RTM_DELADDR message
+    void handle_event(struct nlmsghdr* nlh, std::map<int, bool>& prev_running, std::vector<int>& flapped);
 
 public:
 
@@ -63,11 +78,30 @@ public:
     std::vector<int> init(std::vector<int>& check_lst, int addr_family);
 
     /**
-     * @brief Trigger the monitoring.
+     * @brief Trigger the monitoring by polling all interfaces.
      * @return Return true on success.
      */
     bool check();
 
+    /**
+     * @brief Wait for interface events and process them. Without netlink the function
+     *        sleeps the timeout and polls all interfaces.
+     * @param timeout_msec maximal time to wait for an event
+     * @return Return true on success.
+     */
+    bool check(int timeout_msec);
+
+    /**
+     * @brief Return true if the interfaces are monitored with netlink events.
+     */
+    bool is_event_driven() const;
+
+    /**
+     * @brief Get the netlink socket of the interface events, e.g. to wait for them with epoll.
+     * @return socket descriptor or -1 if the interfaces are polled
+     */
+    int get_event_socket() const;
+
     /**
      * @brief Return the interface indexes who swap their running state to up after the last monitoring trigger.
      */
@@ -78,6 +112,11 @@ public:
      */
     std::vector<int> swap_to_down();
 
+    /**
+     * @brief Return the interface indexes whose addresses of the monitored IP version changed after the last monitoring trigger.
+     */
+    std::vector<int> addr_changed();
+
     /**
      * @brief Test the functionality of check_if.
      */
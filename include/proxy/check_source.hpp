@@ -28,26 +28,77 @@
 #define CHECK_SOURCE_H
 
 #include "include/utils/mc_tables.hpp"
+#include "include/utils/addr_storage.hpp"
+
+#include <map>
+using namespace std;
+
+class routing;
+
+/**
+ * @brief Packet counter of a monitored forwarding rule and the check round of its last update.
+ */
+struct sg_counter{
+     unsigned long pkts;
+     unsigned int check_round;
+};
+
+/**
+ * @brief Monitored forwarding rules.
+ * @param first pair of source and multicast group address
+ * @param second packet counter
+ */
+typedef map<pair<addr_storage, addr_storage>, struct sg_counter> sg_counter_map;
+
+/**
+ * @brief Pair for #sg_counter_map.
+ */
+typedef pair<pair<addr_storage, addr_storage>, struct sg_counter> sg_counter_pair;
 
 /**
  * @brief Monitored the forwarding rules in the Linux kernel table. If a source is unused for
  * a long time it can be removed.
  */
 class check_source{
+public:
+     /**
+      * @brief Where the packet counters come from.
+      */
+     enum check_mode {
+          PROC_TABLE /** parse the whole table ipX_mr_cache on every check */,
+          SG_COUNTER /** query only the counters of the monitored forwarding rules (SIOCGETSGCNT) */
+     };
+
 private:
      int m_addr_family;
+     check_mode m_mode;
 
+     //PROC_TABLE
      mc_tables m_check_src_a;
      mc_tables m_check_src_b;
      mc_tables* m_current_check;
+
+     //SG_COUNTER
+     routing* m_routing;
+     unsigned int m_check_round;
+     sg_counter_map m_counter_map;
+
+     bool is_src_unused_proc_table(int vif, const addr_storage& src_addr, const addr_storage& g_addr);
+     bool is_src_unused_sg_counter(const addr_storage& src_addr, const addr_storage& g_addr);
 public:
 
+     /**
+      * @brief Create check_source.
+      */
+     check_source();
+
      /**
       * @brief Initialize check_source.
       * @param addr_family used IP version (AF_INET or AF_INET6)
+      * @param mode source of the packet counters
       * @return Return true on success.
       */
-     bool init(int addr_family);
+     bool init(int addr_family, check_mode mode);
 
      /**
       * @brief Trigger the monitoring.
@@ -39,6 +39,16 @@
  */
 #define IGMP_RECEIVER_KERNEL_MSG 0
 
+/**
+ * @brief Receive buffer size, IGMPv3 reports may fill a whole packet.
+ */
+#define IGMP_RECEIVER_MAX_PACKET_SIZE 65535 //bytes
+
+/**
+ * @brief Maximum response time of an IGMPv1 query, it has no Max Resp Code.
+ */
+#define IGMP_RECEIVER_V1_MAX_RESP_TIME 10000 //msec, RFC 2236 Section 4
+
 /**
  * @brief Receive IGMP messages.
  */
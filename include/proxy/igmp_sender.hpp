@@ -28,6 +28,9 @@
 #define IGMP_SENDER_HPP
 
 #include "include/proxy/sender.hpp"
+#include "include/utils/mc_msg_format.hpp"
+
+#include <netinet/igmp.h>
 
 /**
  * @brief Generates IGMP messages.
@@ -38,8 +41,33 @@ private:
           GENERAL_QUERY, GROUP_SPECIFIC_QUERY
      };
 
+     int m_query_size; //size of a query or -1 if the version is not supported
+     struct igmpv3_query m_gq; //prebuilt General Query, IGMPv2 uses the first 8 bytes
+     struct igmpv3_query m_gsq; //Group Specific Query template with an unspecified group
+     struct sockaddr_in m_gq_dst; //all hosts address
+     struct sockaddr_in m_gsq_dst; //destination template, the group is set per query
+
      bool create_mc_query(msg_type type, unsigned char* buf,const addr_storage* g_addr=NULL);
      int get_msg_min_size();
+
+     //build the query packets and destination addresses once
+     bool init_templates();
+
+     //patch a group into the Group Specific Query template
+     void fill_gsq(const addr_storage& g_addr, struct igmpv3_query* query, struct sockaddr_in* dst);
+
+     //reused buffers of the batch sends
+     std::vector<struct mroute_socket_packet> m_packets;
+     std::vector<struct igmpv3_query> m_gsq_buf;
+     std::vector<struct sockaddr_in> m_gsq_dst_buf;
+
+     struct sockaddr_in m_all_routers_dst; //destination of IGMPv2 leaves
+     struct sockaddr_in m_igmpv3_dst; //destination of IGMPv3 reports
+     std::vector<unsigned char> m_report_buf;
+     std::vector<struct sockaddr_in> m_report_dst_buf;
+
+     //pack the groups into IGMPv1/2 reports or into IGMPv3 reports with as many records as fit the mtu
+     bool send_raw_reports(int if_index, const std::vector<addr_storage>& g_addrs, report_type type);
 public:
      /**
       * @brief Create an igmp_sender.
@@ -50,8 +78,8 @@ public:
 
     bool send_general_query(int if_index);
     bool send_group_specific_query(int if_index, const addr_storage& g_addr);
-    bool send_report(int if_index, const addr_storage& g_addr);
-    bool send_leave(int if_index, const addr_storage& g_addr);
+    bool send_general_queries(const std::vector<int>& if_indexes);
+    bool send_group_specific_queries(const gsq_vector& queries);
 };
 
 #endif // IGMP_SENDER_HPP
@@ -34,6 +34,7 @@
 #include <iostream>
 #include <string>
 #include <list>
+#include <vector>
 
 #include <sstream>
 #include <boost/thread.hpp>
@@ -95,7 +96,8 @@ typedef struct {
           ROUTING_MSG    /** Message type used from module @ref mod_proxy_instance to introduce the module @ref mod_routing. */,
           CONFIG_MSG     /** Message type used from module @ref mod_proxy to set and delete interfaces of the proxy instances. */,
           EXIT_CMD       /** Message type to stop the proxy instances. */,
-          DEBUG_MSG      /** Message type to collect debug information for the module @ref mod_proxy. */
+          DEBUG_MSG      /** Message type to collect debug information for the module @ref mod_proxy. */,
+          SENDER_MSG     /** Message type used from module @ref mod_proxy_instance to introduce the module @ref mod_sender. */
      };
 
      std::string msg_type_to_string(){
@@ -106,6 +108,7 @@ typedef struct {
           case RECEIVER_MSG: return "RECEIVER_MSG";
           case ROUTING_MSG: return "ROUTING_MSG";
           case DEBUG_MSG: return "DEBUG_MSG";
+          case SENDER_MSG: return "SENDER_MSG";
           case EXIT_CMD: return "EXIT_CMD";
           case CONFIG_MSG: return "CONFIG_MSG";
           default: return "ERROR";
@@ -161,14 +164,17 @@ struct clock_msg: public intrusive_message{
       * @brief A module @ref mod_timer can remind about this actions.
       */
      enum clock_action{
-          SEND_GQ_TO_ALL /** Send to all downstreams General Queries. */,
+          SEND_GQ_TO_ALL /** Age the groups and sources of all interfaces once per Query Interval, the General Queries are sent with SEND_GQ. */,
           SEND_GSQ       /** Send a Group Specific Query to an interface and to a group. */,
           DEL_GROUP      /** Delete a group from an interface. */,
-          SEND_GQ        /** not implementeted at the moment. */
+          SEND_GQ        /** Send a General Query to a downstream and schedule its next one. */,
+          SEND_REPORT    /** Answer a query on the upstream in the raw membership mode. */,
+          SEND_DUE_REPORTS /** The report window of the shared sender expired, send the collected Membership Reports. */,
+          OTHER_QUERIER_PRESENT /** A reminder of the other querier present timer of a downstream expired. */
      };
 
      /**
-      * @brief Constructor used for the actions DEL_GROUP, SEND_GQ and SEND_GSQ.
+      * @brief Constructor used for the actions DEL_GROUP, SEND_GQ, SEND_GSQ, SEND_REPORT and OTHER_QUERIER_PRESENT.
       * @param type type of the clock action
       * @param if_index actionfor a specific interface index
       * @param g_addr action for a specific multicast group
@@ -181,7 +187,7 @@ struct clock_msg: public intrusive_message{
      }
 
      /**
-      * @brief Constructor used for the action SEND_GQ_TO_ALL.
+      * @brief Constructor used for the actions SEND_GQ_TO_ALL and SEND_DUE_REPORTS.
       * @param type type of the clock action
       */
      clock_msg(clock_action type){
@@ -208,6 +214,43 @@ struct clock_msg: public intrusive_message{
      addr_storage g_addr;
 };
 
+/**
+ * @brief A range of multicast groups.
+ * @param first prefix address
+ * @param second prefix length
+ */
+typedef std::pair<addr_storage, int> group_prefix;
+
+/**
+ * @brief A group record of an IGMPv3 or MLDv2 membership report.
+ */
+struct group_record{
+
+     /**
+      * @brief Constructor of a group record.
+      * @param type record type (MC_MSG_MODE_IS_INCLUDE ... MC_MSG_BLOCK_OLD_SOURCES)
+      * @param g_addr multicast group of the record
+      */
+     group_record(int type, const addr_storage& g_addr):
+          type(type), g_addr(g_addr) {
+     }
+
+     /**
+      * @brief Record type.
+      */
+     int type;
+
+     /**
+      * @brief Multicast group of the record.
+      */
+     addr_storage g_addr;
+
+     /**
+      * @brief Source addresses of the record.
+      */
+     std::vector<addr_storage> src_addrs;
+};
+
 //message_type: RECEIVER_MSG
 /**
  * @brief Message used from module @ref mod_receiver to inform the
@@ -221,31 +264,35 @@ struct receiver_msg: public intrusive_message{
      enum receiver_action{
           JOIN           /** a Join message for a specific group on a specific interface */,
           LEAVE          /** a Leave message for a specific group on a specific interface */,
-          CACHE_MISS     /** a Cache Miss message from the Linux Kernel */
+          CACHE_MISS     /** a Cache Miss message from the Linux Kernel */,
+          QUERY          /** a General Query (unspecified group) or a Group Specific Query on a specific interface */,
+          RECORDS        /** all group records of an IGMPv3 or MLDv2 membership report on a specific interface */
      };
 
-     //CACHE_MISS
+     //CACHE_MISS, JOIN, LEAVE, RECORDS
      /**
-      * @brief Constructor used for the action CACHE_MISS.
+      * @brief Constructor used for the actions CACHE_MISS, JOIN, LEAVE and RECORDS (the records are filled in afterwards).
       * @param type type of the receiver action
       * @param if_index action for a specific interface index
-      * @param src_addr action for a specific source
+      * @param src_addr action for a specific source, the reporting host for JOIN, LEAVE and RECORDS
       * @param g_addr action for a specific multicast group
       */
      receiver_msg(receiver_action type, int if_index, addr_storage src_addr, addr_storage g_addr):
-          type(type), if_index(if_index), src_addr(src_addr), g_addr(g_addr) {
+          type(type), if_index(if_index), src_addr(src_addr), g_addr(g_addr), max_resp_time(0) {
           HC_LOG_TRACE("");
      }
 
-     //JOIN, LEAVE
+     //QUERY
      /**
-      * @brief Constructor used for the actions JOIN and LEAVE.
+      * @brief Constructor used for the action QUERY.
       * @param type type of the receiver action
       * @param if_index action for a specific interface index
-      * @param g_addr action for a specific multicast group
+      * @param src_addr address of the querier
+      * @param g_addr queried multicast group or an unspecified address for a General Query
+      * @param max_resp_time maximum response time of the query in msec
       */
-     receiver_msg(receiver_action type, int if_index, addr_storage g_addr):
-          type(type), if_index(if_index), g_addr(g_addr) {
+     receiver_msg(receiver_action type, int if_index, addr_storage src_addr, addr_storage g_addr, int max_resp_time):
+          type(type), if_index(if_index), src_addr(src_addr), g_addr(g_addr), max_resp_time(max_resp_time) {
           HC_LOG_TRACE("");
      }
 
@@ -273,6 +320,15 @@ struct receiver_msg: public intrusive_message{
       */
      addr_storage g_addr;
 
+     /**
+      * @brief Maximum response time of a query.
+      */
+     int max_resp_time; //msec
+
+     /**
+      * @brief Group records of a membership report.
+      */
+     std::vector<group_record> records;
 };
 
 //message_type: ROUTING_MSG
@@ -288,9 +344,19 @@ struct routing_msg: public intrusive_message{
           ADD_VIF   /** Message type to add a virtual interface to the multicast routing table. */,
           DEL_VIF   /** Message type to delete a virtual interface from the mutlicast table. */,
           ADD_ROUTE /** Message type to add a forwarding route to the multicast routing table. */,
-          DEL_ROUTE /** Message type to delete a forwarding route from the multciast routing table. */
+          DEL_ROUTE /** Message type to delete a forwarding route from the multciast routing table. */,
+          RECONCILE /** Message type to compare the forwarding routes of the kernel with the intended routes and repair the differences. */
      };
 
+     /**
+      * @brief Constructor used for the action RECONCILE.
+      * @param type type of the action
+      */
+     routing_msg(routing_action type):
+          type(type), if_index(-1), vif(-1) {
+          HC_LOG_TRACE("");
+     }
+
      /**
       * @brief Constructor used for the actions  ADD_VIF and DEL_VIF.
       * @param type type of the action
@@ -369,6 +435,110 @@ struct routing_msg: public intrusive_message{
      addr_storage src_addr;
 };
 
+//message_type: SENDER_MSG
+class proxy_instance;
+
+/**
+ * @brief Message used from module @ref mod_proxy_instance to introduce the module @ref mod_sender.
+ */
+struct sender_msg: public intrusive_message{
+
+     /**
+      * @brief Available message types.
+      */
+     enum sender_action{
+          SEND_GQ            /** Send General Queries to a list of interfaces. */,
+          SEND_GSQ           /** Send a list of Group Specific Queries. */,
+          JOIN               /** Join a list of groups on an interface for a proxy instance. */,
+          LEAVE              /** Leave a list of groups on an interface for a proxy instance. */,
+          SEND_CURRENT_STATE /** Report the current state of a list of groups or of all groups (empty list) in the raw membership mode. */,
+          SET_RAW_MEMBERSHIP /** Enable or disable the raw membership mode of an interface for a proxy instance. */
+     };
+
+     /**
+      * @brief Constructor used for the action SEND_GQ.
+      * @param type type of the action
+      * @param if_indexes interfaces to query
+      */
+     sender_msg(sender_action type, const std::vector<int>& if_indexes):
+          type(type), owner(NULL), if_index(0), if_indexes(if_indexes), enable(false) {
+          HC_LOG_TRACE("");
+     }
+
+     /**
+      * @brief Constructor used for the action SEND_GSQ.
+      * @param type type of the action
+      * @param queries interfaces and multicast groups to query
+      */
+     sender_msg(sender_action type, const std::vector<std::pair<int, addr_storage> >& queries):
+          type(type), owner(NULL), if_index(0), queries(queries), enable(false) {
+          HC_LOG_TRACE("");
+     }
+
+     /**
+      * @brief Constructor used for the actions JOIN, LEAVE and SEND_CURRENT_STATE.
+      * @param type type of the action
+      * @param owner proxy instance that joins or leaves the groups
+      * @param if_index action for a specific interface index
+      * @param g_addrs multicast groups
+      */
+     sender_msg(sender_action type, proxy_instance* owner, int if_index, const std::vector<addr_storage>& g_addrs):
+          type(type), owner(owner), if_index(if_index), g_addrs(g_addrs), enable(false) {
+          HC_LOG_TRACE("");
+     }
+
+     /**
+      * @brief Constructor used for the action SET_RAW_MEMBERSHIP.
+      * @param type type of the action
+      * @param owner proxy instance that uses the mode
+      * @param if_index action for a specific interface index
+      * @param enable true to enable the mode
+      */
+     sender_msg(sender_action type, proxy_instance* owner, int if_index, bool enable):
+          type(type), owner(owner), if_index(if_index), enable(enable) {
+          HC_LOG_TRACE("");
+     }
+
+     ~sender_msg(){
+          HC_LOG_TRACE("");
+     }
+
+     /**
+      * @brief Type of the sender message.
+      */
+     sender_action type;
+
+     /**
+      * @brief Proxy instance that submitted the message.
+      */
+     proxy_instance* owner;
+
+     /**
+      * @brief Action on a specific interface index.
+      */
+     int if_index;
+
+     /**
+      * @brief Interfaces of the General Queries.
+      */
+     std::vector<int> if_indexes;
+
+     /**
+      * @brief Interfaces and multicast groups of the Group Specific Queries.
+      */
+     std::vector<std::pair<int, addr_storage> > queries;
+
+     /**
+      * @brief Action for a list of multicast groups.
+      */
+     std::vector<addr_storage> g_addrs;
+
+     /**
+      * @brief Enable or disable the raw membership mode.
+      */
+     bool enable;
+};
+
 //message_type: CONFIG_MSG
 /**
  * @brief Message used from module @ref mod_proxy to
@@ -382,7 +552,13 @@ struct config_msg: public intrusive_message{
      enum config_action{
           ADD_DOWNSTREAM /** downstreams can be added to a proxy instance*/,
           DEL_DOWNSTREAM /** downstreams can be delete form a proxy instance */,
-          SET_UPSTREAM   /** an upstream can be changed */
+          SET_UPSTREAM   /** an upstream can be changed */,
+          CHANGE_ADDR    /** the addresses of an interface changed */,
+          SET_FAST_LEAVE /** a downstream deletes a group as soon as its last known host leaves */,
+          STATIC_GROUPS  /** groups are joined permanently by the upstream or by a downstream */,
+          ADD_UPSTREAM   /** an upstream is added or its link is running again, the prefixes are its assigned groups */,
+          DEL_UPSTREAM   /** the link of an upstream is down, its groups are moved to the other upstreams */,
+          SET_BACKUP_UPSTREAM /** an upstream only gets groups if all other upstreams are down */
      };
 
      //routing_action: ADD_VIF and DEL_VIF
@@ -397,6 +573,32 @@ struct config_msg: public intrusive_message{
           HC_LOG_TRACE("");
      }
 
+     //config_action: STATIC_GROUPS
+     /**
+      * @brief Create a config_msg with a list of groups.
+      * @param type configuration type
+      * @param if_index index of the to change interface
+      * @param vif virtual index of the to change interface
+      * @param g_addrs multicast groups of the interface
+      */
+     config_msg(config_action type,int if_index, int vif, const std::vector<addr_storage>& g_addrs):
+          type(type), if_index(if_index), vif(vif), g_addrs(g_addrs) {
+          HC_LOG_TRACE("");
+     }
+
+     //config_action: ADD_UPSTREAM
+     /**
+      * @brief Create a config_msg with a list of group ranges.
+      * @param type configuration type
+      * @param if_index index of the to change interface
+      * @param vif virtual index of the to change interface
+      * @param prefixes multicast group ranges of the interface
+      */
+     config_msg(config_action type,int if_index, int vif, const std::vector<group_prefix>& prefixes):
+          type(type), if_index(if_index), vif(vif), prefixes(prefixes) {
+          HC_LOG_TRACE("");
+     }
+
      ~config_msg(){
           HC_LOG_TRACE("");
      }
@@ -415,6 +617,16 @@ struct config_msg: public intrusive_message{
       * @brief Action on a virtual interface index.
       */
      int vif;
+
+     /**
+      * @brief Multicast groups of the action STATIC_GROUPS.
+      */
+     std::vector<addr_storage> g_addrs;
+
+     /**
+      * @brief Multicast group ranges of the action ADD_UPSTREAM.
+      */
+     std::vector<group_prefix> prefixes;
 };
 
 //message_type: DEBUG_MSG
@@ -483,9 +695,12 @@ public:
       */
      void join_debug_msg(){
           boost::unique_lock<boost::mutex> lock(m_global_lock);
+          boost::system_time timeout = boost::get_system_time() + boost::posix_time::millisec(m_timeout_msec);
           while(m_counter > 0){
-               cond_all_done.timed_wait(lock,boost::posix_time::millisec(m_timeout_msec));
-               m_counter =0;
+               //every response wakes up, the proxy instances that miss the timeout are ignored
+               if(!cond_all_done.timed_wait(lock, timeout)){
+                    m_counter =0;
+               }
           }
      }
 
@@ -34,6 +34,11 @@
  */
 #define MLD_RECEIVER_KERNEL_MSG 0
 
+/**
+ * @brief Receive buffer size, MLDv2 reports may fill a whole packet.
+ */
+#define MLD_RECEIVER_MAX_PACKET_SIZE 65535 //bytes
+
 /**
  * @brief Receive MLD messages.
  */
@@ -42,6 +47,9 @@ private:
      int get_ctrl_min_size();
      int get_iov_min_size();
      void analyse_packet(struct msghdr* msg, int info_size);
+
+     //the link-local address of the sending host or an unspecified address
+     addr_storage get_src_addr(struct msghdr* msg);
 public:
      bool init(int addr_family, int version, mroute_socket* mrt_sock);
 
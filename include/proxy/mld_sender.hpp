@@ -28,6 +28,9 @@
 #define MLD_SENDER_HPP
 
 #include "include/proxy/sender.hpp"
+#include "include/utils/mc_msg_format.hpp"
+
+#include <netinet/icmp6.h>
 
 /**
  * @brief This fields will fill by the Linux kernel.
@@ -53,11 +56,39 @@ private:
           GENERAL_QUERY, MC_ADDR_SPECIFIC_QUERY
      };
 
+     int m_query_size; //size of a query or -1 if the version is not supported
+     struct mldv2_query m_gq; //prebuilt General Query, MLDv1 uses the first 24 bytes
+     struct mldv2_query m_gsq; //Multicast Address Specific Query template with an unspecified address
+     struct sockaddr_in6 m_gq_dst; //all nodes address
+     struct sockaddr_in6 m_gsq_dst; //destination template, the group is set per query
+
      bool choose_if(int if_index);
      int get_msg_min_size();
      bool add_hbh_opt_header();
      bool create_mc_query(msg_type type, unsigned char* buf,const addr_storage* g_addr=NULL);
 
+     //build the query packets and destination addresses once
+     bool init_templates();
+
+     //patch a group into the Multicast Address Specific Query template
+     void fill_gsq(const addr_storage& g_addr, struct mldv2_query* query, struct sockaddr_in6* dst);
+
+     //reused buffers of the batch sends
+     std::vector<struct mroute_socket_packet> m_packets;
+     std::vector<struct mldv2_query> m_gsq_buf;
+     std::vector<struct sockaddr_in6> m_gsq_dst_buf;
+
+     struct sockaddr_in6 m_all_routers_dst; //destination of MLDv1 dones
+     struct sockaddr_in6 m_mldv2_dst; //destination of MLDv2 reports
+     std::vector<unsigned char> m_report_buf;
+     std::vector<struct sockaddr_in6> m_report_dst_buf;
+
+     //reports are sent from the link-local address of the interface (RFC 3810 Section 5.2.13)
+     bool get_link_local_addr(int if_index, struct in6_addr* addr);
+
+     //pack the groups into MLDv1 reports or into MLDv2 reports with as many records as fit the mtu
+     bool send_raw_reports(int if_index, const std::vector<addr_storage>& g_addrs, report_type type);
+
 public:
      /**
       * @brief Create an mld_sender.
@@ -68,8 +99,8 @@ public:
 
      bool send_general_query(int if_index);
      bool send_group_specific_query(int if_index, const addr_storage& g_addr);
-     bool send_report(int if_index, const addr_storage& g_addr);
-     bool send_leave(int if_index, const addr_storage& g_addr);
+     bool send_general_queries(const std::vector<int>& if_indexes);
+     bool send_group_specific_queries(const gsq_vector& queries);
 };
 
 #endif // MLD_SENDER_HPP
@@ -32,11 +32,14 @@
 
 #include "include/utils/addr_storage.hpp"
 #include "include/utils/mroute_socket.hpp"
-#include "include/utils/if_prop.hpp"
+#include "include/utils/if_cache.hpp"
 #include "include/proxy/proxy_instance.hpp"
 #include "include/proxy/receiver.hpp"
+#include "include/proxy/check_if.hpp"
+#include "include/proxy/worker_pool.hpp"
 
 #include <map>
+#include <set>
 #include <vector>
 #include <string>
 using namespace std;
@@ -109,11 +112,36 @@ typedef pair<int,int> interface_pair;
  */
 #define PROXY_DEBUG_MSG_TIMEOUT 3000 //msec
 
+/**
+ * @brief Maximal time to wait for interface events, it is also the interval of the status output.
+ */
+#define PROXY_CHECK_IF_TIMEOUT 2000 //msec
+
+/**
+ * @brief Interval to compare the kernel forwarding routes with the intended routes of the module @ref mod_routing.
+ */
+#define PROXY_RECONCILE_INTERVAL 60 //sec
+
+/**
+ * @brief Maximum number of events of one wakeup of the single threaded event loop.
+ */
+#define PROXY_EVENT_LOOP_MAX_EVENTS 16
+
 /**
  * @brief Path to change the rp filter flag.
  */
 #define PROXY_RP_FILTER_PATH "/proc/sys/net/ipv4/conf/"
 
+/**
+ * @brief Maximum number of groups of a prefix in a static group directive.
+ */
+#define PROXY_MAX_STATIC_PREFIX_GROUPS 1024
+
+/**
+ * @brief Maximum number of shards of a proxy instance.
+ */
+#define PROXY_MAX_SHARDS 64
+
 /**
  * @brief Default path to find the config file.
  */
@@ -130,6 +158,15 @@ private:
      bool m_print_status;
 
      bool m_rest_rp_filter;
+     bool m_batch_routes; //program forwarding rules with rtnetlink batches
+     bool m_raw_membership; //join the upstream groups with generated reports
+     int m_report_window; //msec, collect the generated reports of the raw membership mode
+     int m_gq_jitter; //msec, maximum deviation of a General Query from the Query Interval
+     bool m_remember_sources; //install routes of the last seen sources when a group is joined again
+     bool m_single_thread; //drive the receiver, proxy instances, routing and timers from one event loop
+     int m_pool_threads; //threads of the worker pool that runs the proxy instances, 0 = CPU cores, -1 = one thread per proxy instance
+     worker_pool* m_worker_pool;
+     bool m_lock_memory; //lock the pages of the process into memory (mlockall)
      vector<string> m_restore_rp_filter_vector; //save interface who musst set to true after end
 
      string m_config_path;
@@ -140,11 +177,16 @@ private:
      vector<proxy_instance*> m_proxy_instances;
      interface_map m_interface_map;
      up_down_map m_up_down_map;
+     std::set<int> m_fast_leave; //downstreams in fast leave mode
+     std::map<int, std::vector<addr_storage> > m_static_groups; //interface to its permanently joined groups
+     std::map<int, std::vector<int> > m_more_upstreams; //first upstream of an instance to its further upstreams
+     std::map<int, std::vector<group_prefix> > m_upstream_prefixes; //upstream to its assigned group ranges
+     std::set<int> m_backup_upstreams; //upstreams that only get groups if the other upstreams of there instance are down
+     std::map<int, int> m_shards; //first upstream of an instance to its number of shards
      vif_map m_vif_map;
 
      receiver* m_receiver;
      mroute_socket m_mrt_sock;
-     if_prop m_if_prop;
 
      int get_free_vif_number();
 
@@ -163,15 +205,34 @@ private:
 
      bool load_config(string path); //load the config file and add the interfaces to state_table
 
+     //add a multicast group or all groups of a prefix (e.g. 239.1.0.0/24) to g_addrs
+     bool parse_static_groups(const string& str, vector<addr_storage>& g_addrs);
+
+     //read a CPU list with ranges (e.g. 2,4-5)
+     bool parse_cpu_list(const string& str, vector<int>& cpus);
+
+     //read a multicast group range (e.g. 239.1.0.0/16) assigned to an upstream
+     bool parse_group_prefix(const string& str, group_prefix& prefix);
+
+     //the upstreams of instances with more than one upstream, there link state moves groups instead of removing them
+     set<int> get_shared_upstreams();
+
 
      //check the state_table for valid input, interfaces can only used on time ==> true = check ok, false = double interfaces
      bool check_double_used_if(const vector<int>* new_interfaces);
      bool init_vif_map();
-     bool init_if_prop();
+     bool init_if_prop(); //fill the interface cache
      bool check_and_set_flags(vector<int>& interface_list); //check up and running flag, set multicast and allMulti flag
      bool init_mrt_socket(); //create ipv4/ipv6 socket and set mrt-flag
      bool start_proxy_instances();
 
+     //send a message to all shards of an instance, instance is the index of its first shard in m_proxy_instances
+     void add_instance_msg(int instance, proxy_msg& msg);
+
+     //single threaded mode: receive packets and send expired reminders until an interface event arrives or the timeout expires,
+     //epoll_fd waits for the multicast routing socket and the interface events
+     bool wait_for_events(int epoll_fd, check_if& check_interface, int timeout_msec);
+
 
      //bool init_routing_table(); //add all interfaces from state_table to ip_mr_vif (phyint or tunnel) , allocate memory for m_vif
      static void signal_handler(int sig);
@@ -35,13 +35,14 @@
 #include "include/proxy/worker.hpp"
 #include "include/proxy/routing.hpp"
 #include "include/proxy/sender.hpp"
-#include "include/proxy/igmp_sender.hpp"
-#include "include/proxy/mld_sender.hpp"
+#include "include/proxy/sender_service.hpp"
 #include "include/proxy/receiver.hpp"
 #include "include/proxy/timing.hpp"
 #include "include/proxy/check_source.hpp"
+#include "include/utils/mc_timers_values.hpp"
 
 #include <vector>
+#include <set>
 using namespace std;
 
 /**
@@ -54,6 +55,21 @@ using namespace std;
  */
 #define PROXY_INSTANCE_DEL_IMMEDIATELY 0
 
+/**
+ * @brief Due Group Specific Queries are sent as one batch if the job queue is empty or this number is reached.
+ */
+#define PROXY_INSTANCE_MAX_GSQ_BATCH 64
+
+/**
+ * @brief Default maximum deviation of a General Query from the Query Interval.
+ */
+#define PROXY_INSTANCE_DEFAULT_GQ_JITTER (MC_TV_QUERY_RESPONSE_INTERVAL*1000/2) //msec
+
+/**
+ * @brief Number of Query Intervals an aged upstream source is remembered for a join of its group.
+ */
+#define PROXY_INSTANCE_LAST_SOURCES_LIFETIME 8
+
 /**
  * @brief Data structure to save multicast sources/groups and there states.
  */
@@ -191,15 +207,41 @@ typedef map< int, g_state_map > state_table_map;
  */
 typedef pair< int, g_state_map > state_tabel_pair;
 
+//--------------------------------------------------
+/**
+ * @brief Data structure to save the reporting hosts of a group and there robustness counters.
+ * @param first address of the host
+ * @param second robustness counter, decremented by every General Query of the downstream
+ */
+typedef map<addr_storage, int> host_map;
+
+/**
+ * @brief Data structure to save the reporting hosts of all groups of a downstream.
+ * @param first group address
+ * @param second reporting hosts of the group
+ */
+typedef map<addr_storage, host_map> g_host_map;
+
 /**
  * @brief Represent a multicast Proxy
  */
 class proxy_instance: public worker{
 private:
+    //shards of a large instance, every shard owns the groups of a hash partition
+    int m_shard; //index of this shard, the first shard owns the virtual interfaces and sends the General Queries
+    std::vector<proxy_instance*> m_shards; //all shards of the instance, empty if it is not sharded
+
     //upstream inforamtion
-    int m_upstream; //if_index
+    int m_upstream; //if_index of the first upstream
     upstream_src_state_map m_upstream_state;
 
+    std::vector<int> m_upstreams; //if_index of all upstreams, the groups are distributed between the running ones
+    std::set<int> m_upstreams_down; //upstreams without a running link
+    std::set<int> m_backup_upstreams; //upstreams that only get groups if all other upstreams are down
+    std::map<int, std::vector<group_prefix> > m_upstream_prefixes; //upstream if_index to its assigned group ranges
+    std::map<addr_storage, int> m_group_upstream; //groups joined by the upstreams to there upstream
+    std::set<addr_storage> m_pending_upstream; //groups without a running upstream, joined when an upstream comes back
+
     //downstream inforamtion
     state_table_map m_state_table;
 
@@ -212,24 +254,111 @@ private:
     check_source m_check_source;
 
     routing* m_routing;
-    sender* m_sender;
+    sender_service* m_sender;
     receiver* m_receiver;
     timing* m_timing;
 
+    gsq_vector m_due_gsq; //Group Specific Queries collected for the next batch
+
+    bool m_raw_membership; //the upstream groups are joined with generated reports
+    std::set<int> m_gq_response_pending; //upstreams with a scheduled answer to a General Query
+
+    std::map<int, int> m_other_querier; //downstream if_index to running reminders of the other querier present timer
 
-    void worker_thread();
+    int m_gq_jitter; //msec, maximum deviation of a General Query from the Query Interval
+    std::map<int, bool> m_gq_timer; //downstreams with a running General Query timer, true after the first query
+
+    std::map<int, g_host_map> m_hosts; //downstream if_index to the reporting hosts of its groups
+    std::set<int> m_fast_leave; //downstreams that delete a group as soon as its last known host leaves
+
+    bool m_remember_sources; //keep aged upstream sources in m_last_sources
+    upstream_src_state_map m_last_sources; //aged upstream sources of the groups, restored when a group is joined again
+
+    std::set<addr_storage> m_static_upstream; //groups the upstream joins permanently
+    std::map<int, std::set<addr_storage> > m_static_groups; //downstream if_index to its permanently joined groups
+
+
+    void prepare();
+    void handle_msg(proxy_msg& m);
+    void finish();
 
     // registrate/unregistrate to reciever, router, and to the network
     void registrate_if(int if_index);
     void unregistrate_if(int if_index);
 
     //##-- igmp automat --##
-    //send general query to all downstream
-    bool send_gq_to_all();
+    //start the General Query timer of a downstream, the first query is staggered by the interface index
+    void schedule_first_gq(int if_index);
+
+    //return the position of a downstream in the General Query schedule [0,1)
+    double get_gq_phase(int if_index);
+
+    //decrement the counters of the joined groups of a downstream after its General Query
+    void age_groups(int if_index);
+
+    //send all collected Group Specific Queries
+    bool send_due_gsq();
 
     //processed joins and leaves
     void handle_igmp(struct receiver_msg* r);
 
+    //join or refresh a group of a host on a downstream, collect groups the upstream has to join
+    void join_group(int if_index, const addr_storage& host_addr, const addr_storage& g_addr, vector<addr_storage>& upstream_joins);
+
+    //return true for multicast groups of the node or link local scope
+    bool is_link_local_group(const addr_storage& g_addr);
+
+    //install the routes of the known upstream sources of a joined group directly, before the first packet arrives
+    void install_known_routes(const addr_storage& g_addr);
+
+    //join the collected groups on there assigned upstreams with one sender job per upstream,
+    //without a running upstream the groups stay pending
+    void join_upstream(const vector<addr_storage>& g_addrs);
+
+    //leave the groups on the upstreams they were joined
+    void leave_upstream(const vector<addr_storage>& g_addrs);
+
+    //return true for all upstreams, also for upstreams without a running link
+    bool is_upstream(int if_index);
+
+    //return the upstream of a group: the longest assigned prefix of a running upstream,
+    //otherwise the running upstream with the highest random weight of the group, -1 if no upstream is running
+    int get_upstream(const addr_storage& g_addr);
+
+    //FNV-1a hash of the group address
+    static unsigned int hash_group(const addr_storage& g_addr);
+
+    //return true if the group is part of the range
+    bool is_in_prefix(const addr_storage& g_addr, const group_prefix& prefix);
+
+    //move the joined groups to there new upstream after the running upstreams changed,
+    //the routes of groups without a running upstream are deleted and the pending groups are joined again
+    void rebalance_upstreams();
+
+    //a host leaves a group, the group is deleted immediately in fast leave mode or queried otherwise
+    void leave_group(int if_index, const addr_storage& host_addr, const addr_storage& g_addr);
+
+    //delete a group of a downstream, refresh the upstream and the routing
+    void del_group(int if_index, const addr_storage& g_addr);
+
+    //start the Group Specific Queries of a group, they are only sent if this proxy is the querier
+    void query_group(int if_index, const addr_storage& g_addr);
+
+    //return true if a downstream joins the group permanently
+    bool is_static_group(int if_index, const addr_storage& g_addr);
+
+    //join the configured groups of an interface permanently
+    void join_static_groups(int if_index);
+
+    //querier election on the downstreams, the lowest address wins
+    void handle_downstream_query(struct receiver_msg* r);
+
+    //return true if no other querier is present on a downstream
+    bool is_querier(int if_index);
+
+    //get the address of the own queries on an interface, on error return false
+    bool get_own_addr(int if_index, addr_storage& addr);
+
     //processed clock events
     void handle_clock(struct clock_msg* c);
 
@@ -239,7 +368,7 @@ private:
     //add and del interfaces
     void handle_config(struct config_msg* c);
 
-    //need for aggregate states
+    //need for aggregate states, the static upstream groups are always joined
     bool is_group_joined(int without_if_index, const addr_storage& g_addr);
 
     //handel multicast routes
@@ -277,8 +406,31 @@ public:
      * @param downstream_index  interface index of the downstream
      * @param downstram_vif virtual interface index of the downstream
      * @param receiver* pointer to the modul @ref mod_receiver 
+     * @param raw_membership join the upstream groups with generated reports instead of socket joins
+     * @param gq_jitter maximum random deviation of a General Query from the Query Interval in msec
+     * @param remember_sources remember aged upstream sources and install there routes when the group is joined again
+     * @param shard index of this shard in shards
+     * @param shards all shards of a sharded instance, they are initialised with the same interfaces and share the groups by hash
+     */
+    bool init(int addr_family, int version, int upstream_index, int upstream_vif, int downstream_index, int downstram_vif,receiver* r, bool raw_membership=false, int gq_jitter=PROXY_INSTANCE_DEFAULT_GQ_JITTER, bool remember_sources=false, int shard=0, const std::vector<proxy_instance*>& shards=std::vector<proxy_instance*>());
+
+    /**
+     * @brief Get the index of this shard of the instance.
+     */
+    int get_shard();
+
+    /**
+     * @brief Get the number of shards of the instance, 1 if it is not sharded.
+     */
+    int get_shard_count();
+
+    /**
+     * @brief Get the shard that owns a group.
+     * @param g_addr multicast group address
+     * @param shard_count number of shards
+     * @return index of the shard
      */
-    bool init(int addr_family, int version, int upstream_index, int upstream_vif, int downstream_index, int downstram_vif,receiver* r);
+    static int get_group_shard(const addr_storage& g_addr, int shard_count);
 };
 
 #endif // PROXY_INSTANCE_HPP
@@ -33,9 +33,10 @@
 #include "include/proxy/worker.hpp"
 #include "include/utils/mroute_socket.hpp"
 #include "include/utils/addr_storage.hpp"
-#include "include/utils/if_prop.hpp"
+#include "include/utils/if_cache.hpp"
 
 #include <map>
+#include <vector>
 #include "boost/thread.hpp"
 #include "boost/thread/mutex.hpp"
 
@@ -47,20 +48,20 @@ class proxy_instance;
 #define RECEIVER_RECV_TIMEOUT 100 //msec
 
 //--------------------------------------------------
-//             if_index, proxy_instance
+//             if_index, shards of the proxy_instance
 /**
- * @brief Data structure to save the interface index with the incidental Proxy Instance.
+ * @brief Data structure to save the interface index with the shards of the incidental Proxy Instance.
  * @param first interface index
- * @param second pointer to the incidental Proxy Instance
+ * @param second pointers to the shards of the incidental Proxy Instance, indexed by shard
  */
-typedef std::map<int, proxy_instance*> if_poxy_instance_map;
+typedef std::map<int, std::vector<proxy_instance*> > if_poxy_instance_map;
 
 /**
  * @brief Pair for #if_poxy_instance_map.
  * @param first interface index
- * @param second pointer to the incidental Proxy Instance
+ * @param second pointers to the shards of the incidental Proxy Instance, indexed by shard
  */
-typedef std::pair<int, proxy_instance*> if_proxy_instance_pair;
+typedef std::pair<int, std::vector<proxy_instance*> > if_proxy_instance_pair;
 
 //--------------------------------------------------
 //     vif number, if_index        !!! reversed !!!
@@ -89,8 +90,6 @@ private:
      boost::thread* m_worker_thread;
      static void worker_thread(void* arg);
 
-     bool init_if_prop();
-
      boost::mutex m_data_lock;
      vif_map m_vif_map;
 
@@ -101,11 +100,6 @@ protected:
       */
      if_poxy_instance_map m_if_proxy_map;
 
-     /**
-      * @brief Collect interface properties. Used to generate multicast messages.
-      */
-     if_prop m_if_property;
-
      /**
       * @brief Abstracted multicast socket to receive multicast messages.
       */
@@ -142,10 +136,24 @@ protected:
      /**
       * @brief Get the proxy instance pointer to the interface index. Search in #m_if_proxy_map.
       * @param if_index interface index
-      * @return pointer of the proxy instance or NULL if not found
+      * @return pointer of the proxy instance (its first shard) or NULL if not found
       */
      proxy_instance* get_proxy_instance(int if_index);
 
+     /**
+      * @brief Send a message to the shard of the proxy instance that owns the group.
+      * @param if_index interface index
+      * @param g_addr group of the message, a General Query (unspecified address) is sent to all shards
+      * @param m message to send
+      */
+     void send_to_shard(int if_index, const addr_storage& g_addr, proxy_msg& m);
+
+     /**
+      * @brief Split the records of a report between the shards of the proxy instance and send them.
+      * @param r_msg report message with records, it is released
+      */
+     void send_records_to_shards(struct receiver_msg* r_msg);
+
      //return on error 0
      /**
       * @brief Get the interface index to a virtual interface index. Search in a private map #vif_map
@@ -185,14 +193,21 @@ public:
       * @brief Delete an registerd interface
       * @param if_index interface index of the interface
       * @param vif virtual interface index of the interface
+      * @param p proxy_instance* who register the interface
       */
-     void del_interface(int if_index, int vif);
+     void del_interface(int if_index, int vif, proxy_instance* p);
 
      /**
       * @brief Check whether the receiver is running.
       */
      bool is_running();
 
+     /**
+      * @brief Receive and analyse one packet of the multicast routing socket,
+      *        in the single threaded mode it is called by the event loop if the socket is readable.
+      */
+     void receive_packet();
+
      /**
       * @brief Start the receiver.
       */
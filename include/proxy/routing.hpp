@@ -29,7 +29,8 @@
 #define ROUTING_HPP
 
 #include "include/utils/mroute_socket.hpp"
-#include "include/utils/if_prop.hpp"
+#include "include/utils/if_cache.hpp"
+#include "include/utils/mroute_netlink.hpp"
 #include "include/proxy/message_queue.hpp"
 #include "include/proxy/message_format.hpp"
 #include "include/proxy/worker.hpp"
@@ -42,6 +43,21 @@
  */
 #define ROUTING_MSG_QUEUE_SIZE 1000
 
+//--------------------------------------------------
+/**
+ * @brief Data structure to save the intended forwarding rules.
+ * @param first source and group address
+ * @param second input vif and output vifs
+ */
+typedef map<pair<addr_storage, addr_storage>, pair<int, list<int> > > route_map;
+
+/**
+ * @brief Pair for #route_map.
+ * @param first source and group address
+ * @param second input vif and output vifs
+ */
+typedef pair<pair<addr_storage, addr_storage>, pair<int, list<int> > > route_pair;
+
 /**
  * @brief Set and delete virtual interfaces and forwarding rules in the Linux kernel.
  */
@@ -51,12 +67,18 @@ private:
      int m_version; //for AF_INET (1,2,3) to use IGMPv1/2/3, for AF_INET6 (1,2) to use MLDv1/2
 
      mroute_socket* m_mrt_sock;
-     if_prop m_if_prop; //return interface properties
 
-     void worker_thread();
+     mroute_netlink m_mrt_netlink; //dump the kernel forwarding routes and program batches
+     bool m_batch_routes; //program IPv4 forwarding rules with rtnetlink batches instead of setsockopt
+     struct mr_cache_table m_kernel_routes; //last dump, reused by every reconcile
+     route_map m_routes; //intended forwarding routes
+     map<int, int> m_vif_if_index; //vif to if_index
 
-     //init
-     bool init_if_prop();
+     void handle_msg(proxy_msg& m);
+     void finish();
+
+     //address of the used address family in the interface cache or NULL
+     const struct if_cache_addr* get_if_addr(const if_cache_snapshot& snapshot, int if_index, const struct if_cache_entry** entry);
 
      //routing
      /**
@@ -67,6 +89,12 @@ private:
      bool add_route(routing_msg* msg);
      bool del_route(routing_msg* msg);
 
+     //compare the kernel forwarding routes with m_routes and repair the differences
+     bool reconcile();
+
+     //send the batched forwarding rules and retry the failed ones with setsockopt
+     void flush_routes();
+
      //GOF singleton
      routing();
      routing(const routing&);
@@ -83,9 +111,33 @@ public:
       * @brief initialize the Routing module.
       * @param addr_family AF_INET or AF_INET6
       * @param version used group membership version
+      * @param batch_routes program the forwarding rules with batched rtnetlink messages (only AF_INET),
+      *        setsockopt is used as fallback
+      * @return Return true on success.
+      */
+     bool init(int addr_family, int version, mroute_socket* mrt_sock, bool batch_routes = false);
+
+     /**
+      * @brief Read the counters of a multicast forwarding rule directly from the kernel.
+      *        It does not use the job queue and can be called from any thread.
+      * @param src_addr source address of the forwarding rule
+      * @param g_addr multicast group address of the forwarding rule
+      * @param pkt_cnt forwarded packets
+      * @return Return true on success, false if the forwarding rule does not exist.
+      */
+     bool get_route_pkt_cnt(const addr_storage& src_addr, const addr_storage& g_addr, unsigned long& pkt_cnt);
+
+     /**
+      * @brief Install a multicast forwarding rule directly in the kernel, before the first packet of the source arrives.
+      *        It does not use the job queue and can be called from any thread. An ADD_ROUTE message has to
+      *        follow to save the intended forwarding rule.
+      * @param vif virtual interface index of the incoming interface
+      * @param g_addr multicast group address of the forwarding rule
+      * @param src_addr source address of the forwarding rule
+      * @param output_vif virtual interface indexes of the outgoing interfaces
       * @return Return true on success.
       */
-     bool init(int addr_family, int version, mroute_socket* mrt_sock);
+     bool add_route_now(int vif, const addr_storage& g_addr, const addr_storage& src_addr, const list<int>& output_vif);
 
 };
 
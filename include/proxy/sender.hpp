@@ -30,7 +30,29 @@
 
 #include "include/utils/mroute_socket.hpp"
 #include "include/utils/addr_storage.hpp"
-#include "include/utils/if_prop.hpp"
+
+#include <vector>
+#include <set>
+#include <map>
+
+/**
+ * @brief Largest packet of a generated Membership Report including the IP header.
+ */
+#define SENDER_MTU 1500 //bytes
+
+/**
+ * @brief Data structure to save the groups joined with generated Membership Reports.
+ * @param first interface index
+ * @param second joined multicast groups
+ */
+typedef std::map<int, std::set<addr_storage> > membership_map;
+
+/**
+ * @brief Data structure to save due Group Specific Queries.
+ * @param first interface index
+ * @param second multicast group
+ */
+typedef std::vector<std::pair<int, addr_storage> > gsq_vector;
 
 /**
  * @brief Abstract basic sender class.
@@ -54,14 +76,27 @@ protected:
      mroute_socket m_sock;
 
      /**
-      * @brief Collect interface properties. Used to generate multicast messages.
+      * @brief Groups of the interfaces in the raw membership mode.
       */
-     if_prop m_if_prop; //return interface properties
+     membership_map m_membership;
 
      /**
-      * @brief initialize the interface properties class.
+      * @brief Kind of a generated Membership Report.
+      */
+     enum report_type{
+          JOIN_REPORT          /** state change, the groups are joined */,
+          LEAVE_REPORT         /** state change, the groups are left */,
+          CURRENT_STATE_REPORT /** answer to a query */
+     };
+
+     /**
+      * @brief Build Membership Reports for a list of groups and send them on the raw socket.
+      * @param if_index used interface
+      * @param g_addrs used multicast groups
+      * @param type kind of the reports
+      * @return Return true if all reports are sent.
       */
-     bool init_if_prop();
+     virtual bool send_raw_reports(int if_index, const std::vector<addr_storage>& g_addrs, report_type type)=0;
 public:
 
      /**
@@ -69,6 +104,11 @@ public:
       */
      sender();
 
+     /**
+      * @brief Release all resources.
+      */
+     virtual ~sender();
+
      /**
       * @brief initialise the sender
       * @param addr_family used IP version (AF_INET or AF_INET6)
@@ -92,21 +132,95 @@ public:
       */
      virtual bool send_group_specific_query(int if_index, const addr_storage& g_addr)=0;
 
+     /**
+      * @brief Send a General Query to each interface of a list, as one batch if supported.
+      * @param if_indexes used interfaces
+      * @return Return true if all queries are sent.
+      */
+     virtual bool send_general_queries(const std::vector<int>& if_indexes);
+
+     /**
+      * @brief Send a list of Group Specific Queries, as one batch if supported.
+      * @param queries interfaces and multicast groups to query
+      * @return Return true if all queries are sent.
+      */
+     virtual bool send_group_specific_queries(const gsq_vector& queries);
+
      /**
       * @brief Send a Membership Report to a multicast group and a specific interface.
+      *        In the raw membership mode the group is added to the membership of the interface
+      *        and a generated report is sent, otherwise the socket joins the group.
       * @param if_index used interface
       * @param g_addr used multicast group
       * @return Return true on success.
       */
-     virtual bool send_report(int if_index, const addr_storage& g_addr)=0;
+     virtual bool send_report(int if_index, const addr_storage& g_addr);
 
      /**
       * @brief Send a leave Message to a multicast group and a specific interface.
+      *        In the raw membership mode the group is removed from the membership of the interface
+      *        and a generated leave is sent, otherwise the socket leaves the group.
       * @param if_index used interface
       * @param g_addr used multicast group
       * @return Return true on success.
       */
-     virtual bool send_leave(int if_index, const addr_storage& g_addr)=0;
+     virtual bool send_leave(int if_index, const addr_storage& g_addr);
+
+     /**
+      * @brief Send Membership Reports to a list of multicast groups on a specific interface.
+      * @param if_index used interface
+      * @param g_addrs used multicast groups
+      * @return Return true if all reports are sent.
+      */
+     virtual bool send_reports(int if_index, const std::vector<addr_storage>& g_addrs);
+
+     /**
+      * @brief Send leave Messages to a list of multicast groups on a specific interface.
+      * @param if_index used interface
+      * @param g_addrs used multicast groups
+      * @return Return true if all leave messages are sent.
+      */
+     virtual bool send_leaves(int if_index, const std::vector<addr_storage>& g_addrs);
+
+     /**
+      * @brief Enable or disable the raw membership mode of an interface. In this mode the groups
+      *        are not joined by the kernel, the sender keeps them and generates the Membership Reports
+      *        itself, so the number of groups is not limited by the kernel per socket limits.
+      *        Disabling the mode leaves all groups of the interface.
+      * @param if_index used interface
+      * @param enable true to enable the mode
+      * @return Return true on success.
+      */
+     bool set_raw_membership(int if_index, bool enable);
+
+     /**
+      * @brief Return true if the interface is in the raw membership mode.
+      */
+     bool is_raw_membership(int if_index) const;
+
+     /**
+      * @brief Answer a General Query with the current state of all groups of an interface in the raw membership mode.
+      * @param if_index used interface
+      * @return Return true on success.
+      */
+     bool send_current_state(int if_index);
+
+     /**
+      * @brief Answer a Group Specific Query with the current state of a group, if the group is joined in the raw membership mode.
+      * @param if_index used interface
+      * @param g_addr queried multicast group
+      * @return Return true on success.
+      */
+     bool send_current_state(int if_index, const addr_storage& g_addr);
+
+     /**
+      * @brief Report the current state of the joined groups of a list as few Membership Reports
+      *        in the raw membership mode, groups that are not joined are skipped.
+      * @param if_index used interface
+      * @param g_addrs multicast groups to report
+      * @return Return true on success.
+      */
+     bool send_current_state(int if_index, const std::vector<addr_storage>& g_addrs);
 
 };
 
@@ -0,0 +1,139 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * mcproxy is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * mcproxy is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with mcproxy; see the file COPYING.LESSER.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+/**
+ * @addtogroup mod_sender Sender
+ * @{
+ */
+
+#ifndef SENDER_SERVICE_HPP
+#define SENDER_SERVICE_HPP
+
+#include "include/proxy/sender.hpp"
+#include "include/proxy/message_queue.hpp"
+#include "include/proxy/message_format.hpp"
+#include "include/proxy/worker.hpp"
+#include "include/proxy/timing.hpp"
+
+#include <vector>
+#include <set>
+#include <map>
+
+/**
+ * @brief Maximum size of the job queue.
+ */
+#define SENDER_SERVICE_MSG_QUEUE_SIZE 1000
+
+/**
+ * @brief Collected queries are sent as one batch if the job queue is empty or this number is reached.
+ */
+#define SENDER_SERVICE_MAX_BATCH MROUTE_SOCKET_MAX_BATCH
+
+/**
+ * @brief Default time to collect the membership changes of an interface in the raw membership mode.
+ */
+#define SENDER_SERVICE_DEFAULT_REPORT_WINDOW 20 //msec
+
+/**
+ * @brief Data structure to save the proxy instances that joined a group on an interface.
+ * @param first multicast group
+ * @param second proxy instances
+ */
+typedef std::map<addr_storage, std::set<proxy_instance*> > group_owner_map;
+
+/**
+ * @brief Data structure to save the collected membership changes of an interface.
+ * @param first multicast group
+ * @param second true to join and false to leave the group
+ */
+typedef std::map<addr_storage, bool> due_report_map;
+
+/**
+ * @brief Shares one sender between all proxy instances. The proxy instances submit their queries
+ *        and memberships as jobs, only the worker thread uses the raw socket. The queries of all
+ *        proxy instances are collected and sent in batches, a group is joined as long as one
+ *        proxy instance needs it. In the raw membership mode the membership changes are collected
+ *        for a short window and sent as few Membership Reports with many records.
+ */
+class sender_service: public worker{
+private:
+     int m_addr_family; //AF_INET or AF_INET6
+     int m_version; //for AF_INET (1,2,3) to use IGMPv1/2/3, for AF_INET6 (1,2) to use MLDv1/2
+
+     sender* m_sender;
+     timing* m_timing;
+
+     std::map<int, group_owner_map> m_group_owner; //if_index to joined groups
+     std::map<int, std::set<proxy_instance*> > m_raw_owner; //if_index to proxy instances in the raw membership mode
+
+     std::vector<int> m_due_gq; //collected General Queries
+     gsq_vector m_due_gsq; //collected Group Specific Queries
+
+     int m_report_window; //msec, 0 sends the Membership Reports immediately
+     std::map<int, due_report_map> m_due_reports; //if_index to collected membership changes
+     std::map<int, std::set<addr_storage> > m_due_current_state; //if_index to collected groups of repeated reports
+     bool m_report_flush_scheduled; //the timer of the report window runs
+
+     void handle_msg(proxy_msg& m);
+     void finish();
+
+     void join_groups(struct sender_msg* msg);
+     void leave_groups(struct sender_msg* msg);
+     void send_current_state(struct sender_msg* msg);
+     void set_raw_membership(struct sender_msg* msg);
+
+     //send all collected queries
+     void flush_queries();
+
+     //collect membership changes of an interface in the raw membership mode
+     void add_due_reports(int if_index, const std::vector<addr_storage>& g_addrs, bool join);
+
+     //start the report window if it does not run
+     void schedule_reports();
+
+     //send all collected membership changes and repeated reports
+     void flush_reports();
+
+     //GOF singleton
+     sender_service();
+     sender_service(const sender_service&);
+     sender_service& operator=(const sender_service&);
+     ~sender_service();
+public:
+
+     /**
+      * @brief Get an instance of the shared sender (GOF singleton).
+      */
+     static sender_service* getInstance();
+
+     /**
+      * @brief initialize the shared sender.
+      * @param addr_family AF_INET or AF_INET6
+      * @param version used group membership version
+      * @param report_window time in msec to collect the membership changes of an interface
+      *        in the raw membership mode, 0 sends them immediately
+      * @return Return true on success.
+      */
+     bool init(int addr_family, int version, int report_window = SENDER_SERVICE_DEFAULT_REPORT_WINDOW);
+};
+
+#endif // SENDER_SERVICE_HPP
+/** @} */
@@ -0,0 +1,123 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * mcproxy is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * mcproxy is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with mcproxy; see the file COPYING.LESSER.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+/**
+ * @addtogroup mod_communication Communication
+ * @{
+ */
+
+#ifndef THREAD_PROP_HPP
+#define THREAD_PROP_HPP
+
+#include <sched.h>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Maximum length of a thread name without the terminating null byte (limit of the Linux kernel).
+ */
+#define THREAD_PROP_MAX_NAME_LEN 15
+
+/**
+ * @brief Name, CPU affinity and scheduling of the mcproxy threads, configured per role.
+ *        The settings are made before the first thread starts and read by every thread
+ *        when it starts, so they are not locked.
+ */
+class thread_prop{
+public:
+     /**
+      * @brief Roles of the mcproxy threads.
+      */
+     enum role {
+          MAIN = 0          /** main thread with the interface monitoring, in the single threaded mode all modules */,
+          RECEIVER          /** receiver of the membership messages */,
+          ROUTING           /** module routing */,
+          SENDER            /** module sender */,
+          TIMING            /** module timing */,
+          PROXY_INSTANCE    /** proxy instances and the threads of the worker pool */,
+          ROLE_COUNT        /** number of roles */
+     };
+
+     /**
+      * @brief Convert a role name of the config file (main, receiver, routing, sender, timing or instance).
+      * @param str role name
+      * @param[out] r role
+      * @return Return true if the role name is known.
+      */
+     static bool parse_role(const std::string& str, role& r);
+
+     /**
+      * @brief Convert a role to its name of the config file.
+      */
+     static const char* role_to_string(role r);
+
+     /**
+      * @brief Pin the threads of a role to CPUs, every CPU must be usable by the process.
+      * @param r role of the threads
+      * @param cpus CPU numbers
+      * @return Return true on success.
+      */
+     static bool set_cpus(role r, const std::vector<int>& cpus);
+
+     /**
+      * @brief Set a real-time scheduling policy for the threads of a role.
+      * @param r role of the threads
+      * @param policy SCHED_FIFO or SCHED_RR
+      * @param priority static priority of the policy
+      * @return Return true on success.
+      */
+     static bool set_priority(role r, int policy, int priority);
+
+     /**
+      * @brief Lock all current and future pages of the process into memory (mlockall).
+      * @return Return true on success.
+      */
+     static bool lock_memory();
+
+     /**
+      * @brief Apply the name and the settings of a role to the calling thread.
+      *        Without settings of a role, the thread gets the CPUs of the process start
+      *        and the default policy, so it does not inherit them from its creator.
+      * @param r role of the thread
+      * @param name thread name, cut to #THREAD_PROP_MAX_NAME_LEN characters
+      */
+     static void apply(role r, const std::string& name);
+
+     /**
+      * @brief Return readable settings of all roles.
+      */
+     static std::string to_string();
+
+private:
+     static bool m_configured; //any role has settings
+     static bool m_has_cpus[ROLE_COUNT];
+     static cpu_set_t m_cpus[ROLE_COUNT];
+     static int m_policy[ROLE_COUNT];
+     static int m_priority[ROLE_COUNT];
+
+     //CPUs of the process start
+     static bool get_process_cpus(cpu_set_t& cpus);
+
+     thread_prop();
+};
+
+#endif // THREAD_PROP_HPP
+/** @} */
@@ -21,7 +21,7 @@
 
 /**
  * @defgroup mod_timer Timer
- * @brief The module Timer organizes the temporal behavior of the Proxy-Instances.
+ * @brief The module Timer organizes the temporal behavior of the Proxy-Instances and the shared sender.
  * @{
  */
 
@@ -38,7 +38,7 @@
  */
 #define  TIME_POLL_INTERVAL 500 //msec
 
-class proxy_instance;
+class worker;
 
 /**
  * @brief Organizes reminder.
@@ -46,9 +46,9 @@ class proxy_instance;
 class timing{
 private:
      struct timehandling {
-          timehandling(struct timeval time, proxy_instance* pr_i, proxy_msg pr_msg);
+          timehandling(struct timeval time, worker* pr_i, proxy_msg pr_msg);
           struct timeval m_time;
-          proxy_instance* m_pr_i;
+          worker* m_pr_i;
           proxy_msg m_pr_msg;
      };
 
@@ -73,17 +73,28 @@ public:
      /**
       * @brief Add a new reminder with an predefined time.
       * @param msec predefined time in millisecond
-      * @param proxy_instance* pointer to the owner of the reminder
+      * @param pr_i pointer to the owner of the reminder, a proxy instance or another worker
       * @param pr_msg message of the reminder
       *
       */
-     void add_time(int msec, proxy_instance* pr_i, proxy_msg& pr_msg);
+     void add_time(int msec, worker* pr_i, proxy_msg& pr_msg);
 
      /**
-      * @brief Delete all reminder from a specific proxy instance.
-      * @param proxy_instance* pointer to the specific proxy instance
+      * @brief Delete all reminder from a specific proxy instance or worker.
+      * @param pr_i pointer to the specific proxy instance or worker
       */
-     void stop_all_time(proxy_instance* pr_i);
+     void stop_all_time(worker* pr_i);
+
+     /**
+      * @brief Send all expired reminder to there owner.
+      */
+     void check_time();
+
+     /**
+      * @brief Return the time until the next reminder expires.
+      * @return time in millisecond, 0 if a reminder is expired and -1 if no reminder is set
+      */
+     int get_next_timeout();
 
      /**
       * @brief Start the module Timer.
@@ -29,8 +29,13 @@
 
 #include "include/proxy/message_queue.hpp"
 #include "include/proxy/message_format.hpp"
+#include "include/proxy/worker_pool.hpp"
+#include "include/proxy/thread_prop.hpp"
 #include "boost/thread.hpp"
 
+#include <deque>
+#include <utility>
+
 /**
  * @brief Wraps the job queue to a basic worker like an simple actor pattern.
  */
@@ -41,13 +46,62 @@ private:
 
      static void worker_thread_starter(worker* w);
 
+     //single threaded event loop mode, the jobs of all workers are processed by the thread that sends them
+     static bool m_single_thread;
+     static bool m_dispatching;
+     static std::deque<std::pair<worker*, proxy_msg> > m_loop_queue;
+     unsigned int m_loop_pending; //jobs of this worker in m_loop_queue
+
+     //process the jobs in m_loop_queue until it is empty
+     static void dispatch_loop_queue();
+
+     //run by a worker pool, the jobs wait in m_pool_queue instead of m_job_queue
+     friend class worker_pool;
+     worker_pool* m_pool;
+     boost::mutex m_pool_lock;
+     boost::condition_variable m_pool_cond;
+     std::deque<proxy_msg> m_pool_queue;
+     bool m_pool_scheduled; //in a run queue of the pool or processed by a pool thread
+     bool m_pool_finished; //finish() is done or the worker is not started
+
      void close();
 protected:
 
      /**
-      * @brief Worker thread to process the jobs.
+      * @brief Worker thread to process the jobs, calls prepare(), handle_msg() for every job and finish().
+      */
+     virtual void worker_thread();
+
+     /**
+      * @brief Called once before the first job is processed.
+      */
+     virtual void prepare();
+
+     /**
+      * @brief Process one job.
+      * @param msg the job
+      */
+     virtual void handle_msg(proxy_msg& msg)=0;
+
+     /**
+      * @brief Called once after the job that stopped the worker.
+      */
+     virtual void finish();
+
+     /**
+      * @brief Return true if no more jobs are waiting for this worker.
       */
-     virtual void worker_thread()=0;
+     bool is_job_queue_empty();
+
+     /**
+      * @brief Role of the worker thread, selects its CPU affinity and scheduling (see #thread_prop).
+      */
+     thread_prop::role m_thread_role;
+
+     /**
+      * @brief Name of the worker thread.
+      */
+     std::string m_thread_name;
 
      /**
       * @brief The threads runs as long as m_running is true.
@@ -73,6 +127,13 @@ public:
       */
      void add_msg(proxy_msg& msg);
 
+     /**
+      * @brief Run the worker by the threads of a worker pool instead of an own thread.
+      *        Has to be set before the worker starts.
+      * @param pool the worker pool
+      */
+     void set_worker_pool(worker_pool* pool);
+
      /**
       * @brief Start the worker.
       */
@@ -87,6 +148,19 @@ public:
       * @brief Blocked until the worker thread stopped.
       */
      void join();
+
+     /**
+      * @brief Run all workers without own threads. A job is processed at once by the thread that adds it,
+      *        jobs added during the processing of a job are queued and processed after it.
+      *        Has to be set before the first worker starts.
+      * @param single_thread true to enable the single threaded mode
+      */
+     static void set_single_thread(bool single_thread);
+
+     /**
+      * @brief Return true if the workers run in the single threaded mode.
+      */
+     static bool is_single_thread();
 };
 
 #endif // WORKER_HPP
@@ -0,0 +1,112 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * mcproxy is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * mcproxy is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with mcproxy; see the file COPYING.LESSER.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+/**
+ * @addtogroup mod_communication Communication
+ * @{
+ */
+
+#ifndef WORKER_POOL_HPP
+#define WORKER_POOL_HPP
+
+#include "boost/thread.hpp"
+
+#include <deque>
+#include <vector>
+
+class worker;
+
+/**
+ * @brief Maximum number of jobs a pool thread processes of one worker before it schedules the next worker.
+ */
+#define WORKER_POOL_MAX_BATCH 32
+
+/**
+ * @brief Fixed number of threads that run the workers of the pool like actors.
+ *        A worker with waiting jobs is scheduled on one run queue and processed by one thread at a time,
+ *        so its jobs keep their order. Every thread has its own run queue, an idle thread steals
+ *        workers from the run queues of the other threads.
+ */
+class worker_pool{
+private:
+     struct run_queue{
+          boost::mutex lock;
+          std::deque<worker*> workers;
+     };
+
+     bool m_running;
+     std::vector<boost::thread*> m_threads;
+     std::vector<run_queue*> m_run_queues; //one per thread
+
+     boost::mutex m_idle_lock;
+     boost::condition_variable m_idle_cond;
+     unsigned int m_idle; //sleeping threads
+     unsigned int m_next_queue; //run queue for workers scheduled from outside of the pool
+
+     static void worker_thread_starter(worker_pool* p, int index);
+     void worker_thread(int index);
+
+     //take a worker of the own run queue or steal one of another run queue, NULL if all are empty
+     worker* get_runnable(int index);
+
+     //process up to WORKER_POOL_MAX_BATCH jobs of a scheduled worker
+     void run(worker* w, int index);
+
+     worker_pool(const worker_pool&);
+     worker_pool& operator=(const worker_pool&);
+public:
+     /**
+      * @brief Create a worker pool.
+      * @param threads number of threads, 0 uses the number of CPU cores
+      */
+     worker_pool(int threads);
+
+     /**
+      * @brief Stop the threads and release all resources.
+      */
+     ~worker_pool();
+
+     /**
+      * @brief Return the number of threads.
+      */
+     int get_thread_count();
+
+     /**
+      * @brief Start the threads.
+      */
+     void start();
+
+     /**
+      * @brief Stop the threads and wait for them, the workers should be stopped before.
+      */
+     void stop();
+
+     /**
+      * @brief Add a worker with waiting jobs to a run queue, called by worker::add_msg().
+      *        Inside the pool it is the run queue of the calling thread, outside of the pool the
+      *        run queues are used in turn.
+      * @param w worker to schedule
+      */
+     void schedule(worker* w);
+};
+
+#endif // WORKER_POOL_HPP
+/** @} */
@@ -0,0 +1,167 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * mcproxy is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * mcproxy is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with mcproxy; see the file COPYING.LESSER.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+
+#ifndef IF_CACHE_HPP
+#define IF_CACHE_HPP
+
+#include "include/utils/addr_storage.hpp"
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+#include <string>
+#include <vector>
+#include <map>
+using namespace std;
+
+/**
+ * @brief Address of a network interface.
+ */
+struct if_cache_addr{
+     /**
+      * @brief Interface address.
+      */
+     addr_storage addr;
+
+     /**
+      * @brief Netmask of the address.
+      */
+     addr_storage netmask;
+
+     /**
+      * @brief Peer address of a point to point interface, otherwise the address family is INIT_ADDR_FAMILY.
+      */
+     addr_storage dstaddr;
+};
+
+/**
+ * @brief Properties of a network interface.
+ */
+struct if_cache_entry{
+     /**
+      * @brief Create an empty entry.
+      */
+     if_cache_entry(): if_index(0), flags(0) {}
+
+     /**
+      * @brief Interface index.
+      */
+     int if_index;
+
+     /**
+      * @brief Interface name.
+      */
+     string name;
+
+     /**
+      * @brief Interface flags (IFF_UP, IFF_RUNNING, IFF_POINTOPOINT, ...).
+      */
+     unsigned int flags;
+
+     /**
+      * @brief IPv4 addresses.
+      */
+     vector<struct if_cache_addr> ipv4;
+
+     /**
+      * @brief IPv6 addresses.
+      */
+     vector<struct if_cache_addr> ipv6;
+
+     /**
+      * @brief Return the addresses of an address family.
+      */
+     const vector<struct if_cache_addr>& get_addrs(int addr_family) const {
+          return (addr_family == AF_INET6)? ipv6 : ipv4;
+     }
+};
+
+/**
+ * @brief Data structure to save the interface properties.
+ * @param first interface index
+ * @param second interface properties
+ */
+typedef map<int, struct if_cache_entry> if_cache_map;
+
+/**
+ * @brief Pair for #if_cache_map.
+ * @param first interface index
+ * @param second interface properties
+ */
+typedef pair<int, struct if_cache_entry> if_cache_pair;
+
+/**
+ * @brief Immutable snapshot of all interface properties. A snapshot stays valid as long as it is referenced.
+ */
+typedef boost::shared_ptr<const if_cache_map> if_cache_snapshot;
+
+/**
+ * @brief Process wide interface properties indexed by interface index (GOF singleton).
+ *        A refresh builds a new snapshot and publishes it atomically, readers take the
+ *        current snapshot without a mutex.
+ */
+class if_cache{
+private:
+     if_cache_snapshot m_snapshot;
+     boost::mutex m_refresh_lock; //serialize the writers
+
+     //GOF singleton
+     if_cache();
+     if_cache(const if_cache&);
+     if_cache& operator=(const if_cache&);
+public:
+     /**
+      * @brief Get the instance of the interface cache.
+      */
+     static if_cache* getInstance();
+
+     /**
+      * @brief Enumerate all interfaces with getifaddrs() and publish a new snapshot.
+      *        It is called at startup and after interface events.
+      * @return Return true on success.
+      */
+     bool refresh();
+
+     /**
+      * @brief Get the current snapshot, it is never NULL.
+      */
+     if_cache_snapshot get_snapshot() const;
+
+     /**
+      * @brief Search an interface in a snapshot.
+      * @return Return the interface properties or NULL if the interface does not exist.
+      */
+     static const struct if_cache_entry* find(const if_cache_snapshot& snapshot, int if_index);
+
+     /**
+      * @brief Get the name of an interface from the current snapshot.
+      * @return Return the interface name or an empty string if the interface does not exist.
+      */
+     string get_name(int if_index) const;
+
+     /**
+      * @brief Print the current snapshot.
+      */
+     static void test_if_cache();
+};
+
+#endif // IF_CACHE_HPP
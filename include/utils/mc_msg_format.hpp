@@ -0,0 +1,117 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * mcproxy is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * mcproxy is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with mcproxy; see the file COPYING.LESSER.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+
+#ifndef MC_MSG_FORMAT_HPP
+#define MC_MSG_FORMAT_HPP
+
+#include <sys/types.h>
+#include <netinet/in.h>
+
+//-- igmp (RFC 3376) --
+#define MC_MSG_IGMPV3_MEMBERSHIP_REPORT           0x22
+#define MC_MSG_IGMPV3_QUERY_MIN_SIZE              12 //bytes, an IGMPv1/2 query has 8 bytes
+
+//-- mld (RFC 3810) --
+#define MC_MSG_MLDV2_LISTENER_REPORT              143
+#define MC_MSG_MLDV2_QUERY_MIN_SIZE               28 //bytes, an MLDv1 query has 24 bytes
+
+//-- group record types (RFC 3376 Section 4.2.12, RFC 3810 Section 5.2.12) --
+#define MC_MSG_MODE_IS_INCLUDE                    1
+#define MC_MSG_MODE_IS_EXCLUDE                    2
+#define MC_MSG_CHANGE_TO_INCLUDE_MODE             3
+#define MC_MSG_CHANGE_TO_EXCLUDE_MODE             4
+#define MC_MSG_ALLOW_NEW_SOURCES                  5
+#define MC_MSG_BLOCK_OLD_SOURCES                  6
+
+/**
+ * @brief IGMPv3 Membership Query without source addresses (RFC 3376 Section 4.1),
+ *        the first 8 bytes are an IGMPv2 query.
+ */
+struct igmpv3_query{
+     u_int8_t type;
+     u_int8_t max_resp_code;
+     u_int16_t checksum;
+     struct in_addr group;
+     u_int8_t s_qrv; //suppress router-side processing flag and querier's robustness variable
+     u_int8_t qqic; //querier's query interval code
+     u_int16_t num_of_srcs;
+};
+
+/**
+ * @brief Header of an IGMPv3 Membership Report (RFC 3376 Section 4.2).
+ */
+struct igmpv3_report_hdr{
+     u_int8_t type;
+     u_int8_t reserved1;
+     u_int16_t checksum;
+     u_int16_t reserved2;
+     u_int16_t num_of_mc_records;
+};
+
+/**
+ * @brief Group record of an IGMPv3 Membership Report, followed by the source addresses.
+ */
+struct igmpv3_mc_record{
+     u_int8_t type;
+     u_int8_t aux_data_len;
+     u_int16_t num_of_srcs;
+     struct in_addr mc_addr;
+};
+
+/**
+ * @brief MLDv2 Multicast Listener Query without source addresses (RFC 3810 Section 5.1),
+ *        the first 24 bytes are an MLDv1 query.
+ */
+struct mldv2_query{
+     u_int8_t type;
+     u_int8_t code;
+     u_int16_t checksum;
+     u_int16_t max_resp_code;
+     u_int16_t reserved;
+     struct in6_addr mc_addr;
+     u_int8_t s_qrv; //suppress router-side processing flag and querier's robustness variable
+     u_int8_t qqic; //querier's query interval code
+     u_int16_t num_of_srcs;
+};
+
+/**
+ * @brief Header of an MLDv2 Listener Report (RFC 3810 Section 5.2).
+ */
+struct mldv2_report_hdr{
+     u_int8_t type;
+     u_int8_t reserved1;
+     u_int16_t checksum;
+     u_int16_t reserved2;
+     u_int16_t num_of_mc_records;
+};
+
+/**
+ * @brief Multicast address record of an MLDv2 Listener Report, followed by the source addresses.
+ */
+struct mldv2_mc_record{
+     u_int8_t type;
+     u_int8_t aux_data_len;
+     u_int16_t num_of_srcs;
+     struct in6_addr mc_addr;
+};
+
+#endif // MC_MSG_FORMAT_HPP
@@ -26,6 +26,7 @@
 #include "include/utils/addr_storage.hpp"
 #include <time.h>
 #include <string>
+#include <vector>
 using namespace std;
 
 ///@author Sebastian Woelke
@@ -116,6 +117,12 @@ protected:
       * @brief Mc_socket mustnt be copied because its contain an unique socket.
       */
      mc_socket(const mc_socket &copy);
+
+     /**
+      * @brief Join or leave a multicast group with one setsockopt.
+      * @param optname MCAST_JOIN_GROUP or MCAST_LEAVE_GROUP
+      */
+     bool change_group(int optname, const addr_storage& g_addr, int if_index);
 public:
      /**
       * @brief Create a multicast socket.
@@ -186,6 +193,16 @@ public:
       */
      bool send_packet(const char* addr, int port, const unsigned char* data, unsigned int data_size);
 
+     /**
+      * @brief Send data to a prebuilt destination address, without name resolution.
+      * @param addr destination address and port of the packet
+      * @param addr_len size of the destination address
+      * @param data data to send
+      * @param data_size size of the data
+      * @return Return true on success.
+      */
+     bool send_packet(const struct sockaddr* addr, socklen_t addr_len, const unsigned char* data, unsigned int data_size);
+
      /**
       * @brief Receive a datagram
       * @param[out] buf read N bytes into buf from socket
@@ -210,6 +227,11 @@ public:
       */
      bool set_receive_timeout(long msec);
 
+     /**
+      * @brief Get the socket descriptor, e.g. to wait for received messages with epoll.
+      */
+     int get_socket() const;
+
      /**
       * @brief Choose a specific network interface
       * @return Return true on success.
@@ -236,10 +258,44 @@ public:
       */
      bool leave_group(const char* addr, int if_index);
 
+     /**
+      * @brief Join a multicast group on a specific network interface without name resolution.
+      * @param g_addr group to join
+      * @param if_index interface index
+      * @return Return true on success.
+      */
+     bool join_group(const addr_storage& g_addr, int if_index);
+
+     /**
+      * @brief Leave a multicast group on a specific network interface without name resolution.
+      * @param g_addr group to leave
+      * @param if_index interface index
+      * @return Return true on success.
+      */
+     bool leave_group(const addr_storage& g_addr, int if_index);
+
+     /**
+      * @brief Join a list of multicast groups on a specific network interface, one setsockopt per group.
+      *        A failed group is logged, the remaining groups are still joined.
+      * @param g_addrs groups to join
+      * @param if_index interface index
+      * @return Return true if all groups are joined.
+      */
+     bool join_groups(const std::vector<addr_storage>& g_addrs, int if_index);
+
+     /**
+      * @brief Leave a list of multicast groups on a specific network interface, one setsockopt per group.
+      *        A failed group is logged, the remaining groups are still left.
+      * @param g_addrs groups to leave
+      * @param if_index interface index
+      * @return Return true if all groups are left.
+      */
+     bool leave_groups(const std::vector<addr_storage>& g_addrs, int if_index);
+
      /**
       * @brief Check for valid socket descriptor.
       */
-     bool is_udp_valid() {
+     bool is_udp_valid() const {
           return m_sock > 0;
      }
 
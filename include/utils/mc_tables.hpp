@@ -42,6 +42,11 @@ using namespace std;
 #define MR_CACHE_PATH_V6 "/proc/net/ip6_mr_cache"
 #define SNMP6_PATH "/proc/net/dev_snmp6"
 
+/**
+ * @brief Initial size of the read buffer used by the fast table parser, it grows on demand and is reused.
+ */
+#define MC_TABLES_READ_BUF_SIZE 65536
+
 typedef vector<addr_storage> MGroup_value;
 typedef map<string, MGroup_value > MGroup_map;
 typedef pair<string, MGroup_value > MGroup_pair;
@@ -81,6 +86,51 @@ struct mr_cache{
      vector<int> o_if;
 };
 
+/**
+ * @brief Binary IPv4 or IPv6 address used by the fast table parser (network byte order).
+ */
+union mr_table_addr{
+     struct in_addr v4;
+     struct in6_addr v6;
+};
+
+/**
+ * @brief Column oriented snapshot of the Linux kernel table ipX_mr_vif, filled by the fast parser.
+ *        The vectors only grow, valid rows are [0, size).
+ */
+struct mr_vif_table{
+     int addr_family;
+     unsigned int size;
+     vector<int> vifi;
+     vector<string> ifname;
+     vector<unsigned long> bytes_in;
+     vector<unsigned long> pkts_in;
+     vector<unsigned long> bytes_out;
+     vector<unsigned long> pkts_out;
+     vector<unsigned int> flags;
+     vector<struct in_addr> lcl_addr; //only for AF_INET
+     vector<struct in_addr> remote; //only for AF_INET
+};
+
+/**
+ * @brief Column oriented snapshot of the Linux kernel table ipX_mr_cache, filled by the fast parser.
+ *        The vectors only grow, valid rows are [0, size). The output interfaces of row i are
+ *        o_if[o_if_begin[i]] to o_if[o_if_begin[i+1]-1].
+ */
+struct mr_cache_table{
+     int addr_family;
+     unsigned int size;
+     vector<union mr_table_addr> group;
+     vector<union mr_table_addr> origin;
+     vector<int> i_if;
+     vector<unsigned long> pkts;
+     vector<unsigned long> bytes;
+     vector<unsigned long> wrong;
+     vector<unsigned int> o_if_begin;
+     vector<int> o_if;
+     vector<int> o_ttl;
+};
+
 /**
  * @brief Represent a raw in the Linux kernel table snmp6
  */
@@ -133,6 +183,19 @@ private:
 
      vector<struct igmp_dev> m_igmp_table;
 
+     //--fast parser--
+     vector<char> m_read_buf;
+     unsigned int m_read_buf_len;
+     struct mr_vif_table m_vif_table;
+     struct mr_cache_table m_route_table;
+
+     //read a whole file with read() into m_read_buf
+     bool read_file(const char* path);
+     unsigned int count_lines();
+     void reserve_vif_table(unsigned int rows);
+     void reserve_route_table(unsigned int rows);
+     bool refresh_routes(const string& path);
+
      //--general--
      string int2str(int x);
      addr_storage hexCharAddr_To_ipFormart(string& ipAddr, int addrFamily);
@@ -248,6 +311,44 @@ public:
       */
      void print_all_route_infos();
 
+     //#####################
+     //##-- fast parser --##
+     //#####################
+     /**
+      * @brief Refresh the virtual interface snapshot with the fast parser. The file is read at once into
+      *        a reusable buffer and decoded in place, no per line allocations are made.
+      * @param path alternative table file, NULL for the Linux kernel table of the address family
+      * @return Return true on success.
+      */
+     bool refresh_vif_table(const char* path = NULL);
+
+     /**
+      * @brief Get the snapshot filled by refresh_vif_table().
+      */
+     const struct mr_vif_table& get_vif_table() const;
+
+     /**
+      * @brief Refresh the multicast forwarding route snapshot with the fast parser. The file is read at once into
+      *        a reusable buffer and decoded in place, no per line allocations are made.
+      * @param path alternative table file, NULL for the Linux kernel table of the address family
+      * @return Return true on success.
+      */
+     bool refresh_route_table(const char* path = NULL);
+
+     /**
+      * @brief Get the snapshot filled by refresh_route_table().
+      */
+     const struct mr_cache_table& get_route_table() const;
+
+     /**
+      * @brief Search a multicast forwarding route in the snapshot filled by refresh_route_table().
+      * @param vif input virtual interface of the route
+      * @param src_addr source address of the route
+      * @param g_addr multicast group address of the route
+      * @return Return the row of the route or -1 if not found.
+      */
+     int find_route(int vif, const addr_storage& src_addr, const addr_storage& g_addr) const;
+
      //###############
      //##-- snmp6 --##
      //###############
@@ -345,6 +446,12 @@ public:
       */
      static void test_mr_cache(int addrFamily);
 
+     /**
+      * @brief Compare the fast parser with the stream based parser on generated ipX_mr_cache
+      *        files with 10k and 100k rows and print the needed time.
+      */
+     static void test_route_table_bench(int addrFamily);
+
      /**
       * @brief Test the snmp6 table for an ip version (AF_INET or AF_INET6).
       */
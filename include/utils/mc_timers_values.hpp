@@ -27,7 +27,7 @@
 #define MC_TV_ROBUSTNESS_VARIABLE                 2//2
 #define MC_TV_QUERY_INTERVAL                      125 //sec
 #define MC_TV_QUERY_RESPONSE_INTERVAL             10 //sec
-#define MC_TV_OTHER_QUERIER_PRESENT_INTERVAL      (MC_TV_ROBUSTNESS_VARIABLE*MC_TV_QUERY_RESPONSE_INTERVAL) //sec
+#define MC_TV_OTHER_QUERIER_PRESENT_INTERVAL      (MC_TV_ROBUSTNESS_VARIABLE*MC_TV_QUERY_INTERVAL + MC_TV_QUERY_RESPONSE_INTERVAL/2) //sec
 #define MC_TV_STARTUP_QUERY_INTERVAL              (MC_TV_QUERY_INTERVAL/4)
 #define MC_TV_STARTUP_QUERY_COUNT                 MC_TV_ROBUSTNESS_VARIABLE
 #define MC_TV_UNSOLICITED_REPORT_INTERVAL         10 //sec
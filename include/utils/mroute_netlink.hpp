@@ -0,0 +1,214 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * mcproxy is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * mcproxy is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with mcproxy; see the file COPYING.LESSER.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+
+#ifndef MROUTE_NETLINK_HPP
+#define MROUTE_NETLINK_HPP
+
+#include "include/utils/netlink_socket.hpp"
+#include "include/utils/mc_tables.hpp"
+#include "include/utils/addr_storage.hpp"
+#include "include/utils/mroute_socket.hpp"
+
+#include <vector>
+#include <deque>
+using namespace std;
+
+/**
+ * @brief Receive timeout of a route dump.
+ */
+#define MROUTE_NETLINK_TIMEOUT 1000 //msec
+
+/**
+ * @brief Maximum size of a batch of route messages sent with one sendmsg().
+ */
+#define MROUTE_NETLINK_BATCH_SIZE 16384 //byte
+
+/**
+ * @brief Receive buffer of the socket, it has to hold the acks of several batches.
+ */
+#define MROUTE_NETLINK_RCVBUF_SIZE (1024 * 1024) //byte
+
+/**
+ * @brief A route operation of a batch that is not acknowledged yet or failed.
+ */
+struct mroute_netlink_op{
+     /**
+      * @brief Create an operation.
+      */
+     mroute_netlink_op(bool add, int vif, const addr_storage& src_addr, const addr_storage& g_addr):
+          add(add), vif(vif), src_addr(src_addr), g_addr(g_addr), seq(0), error(0) {}
+
+     /**
+      * @brief True for RTM_NEWROUTE, false for RTM_DELROUTE.
+      */
+     bool add;
+
+     /**
+      * @brief Virtual interface index of the input interface.
+      */
+     int vif;
+
+     /**
+      * @brief Source address of the forwarding rule.
+      */
+     addr_storage src_addr;
+
+     /**
+      * @brief Multicast group address of the forwarding rule.
+      */
+     addr_storage g_addr;
+
+     /**
+      * @brief Sequence number of the netlink message.
+      */
+     unsigned int seq;
+
+     /**
+      * @brief errno reported by the kernel, -1 if the message could not be sent.
+      */
+     int error;
+};
+
+/**
+ * @brief Read the multicast forwarding cache of the Linux kernel via rtnetlink (RTNL_FAMILY_IPMR and RTNL_FAMILY_IP6MR)
+ *        and program IPv4 forwarding rules in batches (the kernel has no RTM_NEWROUTE handler for RTNL_FAMILY_IP6MR).
+ */
+class mroute_netlink{
+private:
+     int m_addr_family;
+     netlink_socket m_sock;
+     vector<char> m_buf;
+
+     vector<char> m_batch;
+     unsigned int m_batch_len;
+
+     //operations in sequence order, the first m_sent are sent and wait for their ack
+     //(the kernel processes the messages of a batch in order, so the acks arrive in order)
+     deque<struct mroute_netlink_op> m_ops;
+     unsigned int m_sent;
+     vector<struct mroute_netlink_op> m_failed;
+
+     bool add_route_row(struct mr_cache_table& table, struct nlmsghdr* nlh);
+
+     //append a RTM_NEWROUTE or RTM_DELROUTE message to the batch
+     bool add_route_msg(bool add, int vif, int if_index, const addr_storage& src_addr, const addr_storage& g_addr, const unsigned int* output_vif, unsigned int output_vif_size);
+
+     //process an acknowledgement of a batched operation
+     void handle_ack(struct nlmsghdr* nlh);
+
+     //number of routes with the input interface if_index
+     static unsigned int count_routes(const struct mr_cache_table& table, int if_index);
+
+     //set the link of an interface up or down (SIOCSIFFLAGS)
+     static bool set_link(const char* if_name, bool up);
+public:
+     /**
+      * @brief Create a mroute_netlink.
+      */
+     mroute_netlink();
+
+     /**
+      * @brief Open the netlink socket.
+      * @param addr_family AF_INET or AF_INET6
+      * @return Return true on success.
+      */
+     bool init(int addr_family);
+
+     /**
+      * @brief Dump all resolved multicast forwarding routes of the default table with one RTM_GETROUTE request.
+      *        Unlike the tables filled by mc_tables, i_if and o_if contain interface indexes and not
+      *        virtual interface indexes, o_ttl contains the ttl threshold of the output interface.
+      * @param table snapshot to fill, its vectors are reused
+      * @return Return true on success.
+      */
+     bool dump_routes(struct mr_cache_table& table);
+
+     /**
+      * @brief Queue a forwarding rule in the batch, the batch is sent if it is full.
+      * @param vif virtual interface index of the input interface
+      * @param if_index interface index of the input interface
+      * @param src_addr source address of the forwarding rule
+      * @param g_addr multicast group address of the forwarding rule
+      * @param output_vif virtual interface indexes of the output interfaces
+      * @param output_vif_size number of output interfaces
+      * @return Return true on success.
+      */
+     bool add_route(int vif, int if_index, const addr_storage& src_addr, const addr_storage& g_addr, const unsigned int* output_vif, unsigned int output_vif_size);
+
+     /**
+      * @brief Queue the deletion of a forwarding rule in the batch, the batch is sent if it is full.
+      * @param vif virtual interface index of the input interface
+      * @param if_index interface index of the input interface
+      * @param src_addr source address of the forwarding rule
+      * @param g_addr multicast group address of the forwarding rule
+      * @return Return true on success.
+      */
+     bool del_route(int vif, int if_index, const addr_storage& src_addr, const addr_storage& g_addr);
+
+     /**
+      * @brief Send all queued operations with one sendmsg() and collect the acks that already arrived.
+      * @return Return true on success.
+      */
+     bool flush();
+
+     /**
+      * @brief Collect the acks of sent operations.
+      * @param wait_all wait until all operations are acknowledged or the receive timeout expired
+      * @return Return true if no operation is pending anymore.
+      */
+     bool receive_acks(bool wait_all);
+
+     /**
+      * @brief Return the number of queued and sent operations without ack.
+      */
+     unsigned int pending() const;
+
+     /**
+      * @brief Take the failed operations, the internal list is cleared.
+      */
+     void swap_failed(vector<struct mroute_netlink_op>& failed);
+
+     /**
+      * @brief Dump and print the multicast forwarding routes.
+      */
+     static void test_dump_routes(int addr_family);
+
+     /**
+      * @brief Compare setsockopt(MRT_ADD_MFC/MRT_DEL_MFC) with batched netlink messages.
+      *        The virtual interfaces of mroute_socket::test_add_vifs() have to exist.
+      * @param m IPv4 multicast routing socket
+      * @param count number of forwarding rules
+      */
+     static void test_route_batch_bench(mroute_socket* m, int count);
+
+     /**
+      * @brief Measure the upstream failover of a running mcproxy. The link of the primary upstream is set down
+      *        until no route has it as input interface anymore, then it is set up until its routes are back.
+      *        mcproxy has to forward sources of joined groups from the primary upstream and needs another running upstream.
+      * @param addr_family AF_INET or AF_INET6
+      * @param if_name primary upstream
+      * @param timeout maximum time of the failover and of the failback in msec
+      */
+     static void test_failover(int addr_family, const char* if_name, int timeout);
+};
+
+#endif // MROUTE_NETLINK_HPP
@@ -25,6 +25,7 @@
 
 #include "include/utils/mc_socket.hpp"
 #include <sys/types.h>
+#include <vector>
 
 #define MROUTE_RATE_LIMIT_ENDLESS 0
 #define MROUTE_TTL_THRESHOLD 1
@@ -32,6 +33,46 @@
 
 #define ADD_SIGNED_NUM_U16(r,a) (r)+= (a); (r)+= ((r)>>16)
 
+/**
+ * @brief Maximal number of packets passed to one sendmmsg call.
+ */
+#define MROUTE_SOCKET_MAX_BATCH 64
+
+/**
+ * @brief A packet of a batch send with its own egress interface.
+ */
+struct mroute_socket_packet{
+     /**
+      * @brief Egress interface index.
+      */
+     int if_index;
+
+     /**
+      * @brief Prebuilt destination address.
+      */
+     const struct sockaddr* dst;
+
+     /**
+      * @brief Size of the destination address.
+      */
+     socklen_t dst_len;
+
+     /**
+      * @brief Packet data.
+      */
+     const unsigned char* data;
+
+     /**
+      * @brief Size of the packet data.
+      */
+     unsigned int data_size;
+
+     /**
+      * @brief Source address (struct in_addr or struct in6_addr) or NULL to let the kernel choose it.
+      */
+     const void* src;
+};
+
 /**
  * @brief Wrapper for a multicast socket with additional functions to manipulate Linux kernel tables.
  */
@@ -40,6 +81,11 @@ class mroute_socket: public mc_socket
 private:
      mroute_socket(const mroute_socket &copy);
 
+     //reused buffers of send_packets
+     std::vector<struct mmsghdr> m_mmsg;
+     std::vector<struct iovec> m_iov;
+     std::vector<char> m_cmsg;
+
      //not used
      bool create_udp_ipv4_socket(){
           return false;
@@ -91,6 +137,16 @@ public:
       */
      u_int16_t calc_checksum(const unsigned char* buf, int buf_size);
 
+     /**
+      * @brief Update an internet checksum after a part of the packet changed (RFC 1624, Eqn. 3).
+      * @param cksum checksum of the packet before the change
+      * @param old_data changed part of the packet before the change, 16 bit aligned to the packet start
+      * @param new_data changed part of the packet after the change
+      * @param size size of the changed part, an even number
+      * @return Return the checksum of the changed packet.
+      */
+     static u_int16_t update_checksum(u_int16_t cksum, const unsigned char* old_data, const unsigned char* new_data, int size);
+
      /**
       * @brief Calculate the ICMPv6 header checksum by sending an ICMPv6 packet.
       *        Per default the ICMP6 checksum (RFC 3542 Section 3.1) will be calculate.
@@ -100,8 +156,8 @@ public:
      bool set_default_icmp6_checksum_calc(bool enable);
 
      /**
-      * @brief Add an extension header to a sending packet.
-      * @param buf extension header
+      * @brief Add an extension header to a sending packet. For IPv4 the buffer contains IP options.
+      * @param buf extension header or IPv4 options
       * @param buf_size size of the extension header
       * @return Return true on success.
       */
@@ -172,6 +228,28 @@ public:
       */
      bool del_mroute(int input_vifNum, const char* source_addr, const char* group_addr);
 
+     /**
+      * @brief Read the counters of a single multicast route from the kernel (SIOCGETSGCNT or SIOCGETSGCNT_IN6).
+      *        The socket is only read, so this can be called from any thread.
+      * @param source_addr source address of the route
+      * @param group_addr multicast group address of the route
+      * @param pkt_cnt forwarded packets, can be NULL
+      * @param byte_cnt forwarded bytes, can be NULL
+      * @param wrong_if packets arrived on a wrong interface, can be NULL
+      * @return Return true on success, false if the route does not exist or on error.
+      */
+     bool get_mroute_stats(const addr_storage& source_addr, const addr_storage& group_addr, unsigned long* pkt_cnt, unsigned long* byte_cnt, unsigned long* wrong_if) const;
+
+     /**
+      * @brief Send a batch of packets with sendmmsg(). The egress interface of each packet is chosen
+      *        with an IP_PKTINFO/IPV6_PKTINFO control message, the multicast interface of the socket is not changed.
+      *        A packet that fails is logged and skipped, the remaining packets are still sent.
+      * @param packets packets to send
+      * @param count number of packets
+      * @return Return true if all packets are sent.
+      */
+     bool send_packets(const struct mroute_socket_packet* packets, unsigned int count);
+
      /**
       * @brief simple test outputs
       */
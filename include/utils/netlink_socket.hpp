@@ -0,0 +1,144 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * mcproxy is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * mcproxy is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with mcproxy; see the file COPYING.LESSER.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+
+#ifndef NETLINK_SOCKET_HPP
+#define NETLINK_SOCKET_HPP
+
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <vector>
+using namespace std;
+
+/**
+ * @brief Size of the receive buffer for netlink messages (the kernel uses up to 32KB per dump datagram).
+ */
+#define NETLINK_SOCKET_RECV_BUF_SIZE 65536
+
+/**
+ * @brief Wrapper for a rtnetlink socket.
+ */
+class netlink_socket{
+private:
+     int m_sock;
+     unsigned int m_seq;
+     unsigned int m_pid;
+
+     netlink_socket(const netlink_socket& copy);
+public:
+     /**
+      * @brief Create a netlink_socket.
+      */
+     netlink_socket();
+
+     /**
+      * @brief Close the socket.
+      */
+     virtual ~netlink_socket();
+
+     /**
+      * @brief Create a NETLINK_ROUTE socket.
+      * @param groups multicast groups to subscribe (RTMGRP_*), 0 for a request/response socket
+      * @return Return true on success.
+      */
+     bool create_rtnl_socket(unsigned int groups);
+
+     /**
+      * @brief Close the socket.
+      */
+     void close_socket();
+
+     /**
+      * @brief Check for a valid socket descriptor.
+      */
+     bool is_valid() const {
+          return m_sock >= 0;
+     }
+
+     /**
+      * @brief Get the socket descriptor, e.g. to wait with poll().
+      */
+     int get_socket() const;
+
+     /**
+      * @brief Get the port id the kernel assigned to this socket.
+      */
+     unsigned int get_pid() const;
+
+     /**
+      * @brief Get a new sequence number for a request.
+      */
+     unsigned int next_seq(){
+          return ++m_seq;
+     }
+
+     /**
+      * @brief Send one or more netlink messages with a single sendmsg().
+      * @param buf consecutive netlink messages, each aligned to NLMSG_ALIGNTO
+      * @param size size of all messages
+      * @return Return true on success.
+      */
+     bool send(const void* buf, unsigned int size);
+
+     /**
+      * @brief Receive one datagram, it can contain several netlink messages.
+      * @param buf receive buffer, it will be resized to NETLINK_SOCKET_RECV_BUF_SIZE if smaller
+      * @param dont_wait return immediately if no datagram is pending
+      * @return Return the size of the datagram, 0 if nothing is pending or -1 on error.
+      */
+     int receive(vector<char>& buf, bool dont_wait);
+
+     /**
+      * @brief Set a receive timeout.
+      * @param msec timeout in millisecond
+      * @return Return true on success.
+      */
+     bool set_receive_timeout(long msec);
+
+     /**
+      * @brief Enlarge the socket receive buffer, e.g. to hold the acks of a large batch.
+      * @param size buffer size in byte
+      * @return Return true on success.
+      */
+     bool set_receive_buffer(int size);
+
+     /**
+      * @brief Append an attribute to a netlink message.
+      * @param nlh netlink message
+      * @param max_size size of the buffer behind nlh
+      * @param type attribute type
+      * @param data attribute payload
+      * @param size size of the payload
+      * @return Return a pointer to the attribute or NULL if the buffer is to small.
+      */
+     static struct rtattr* add_attr(struct nlmsghdr* nlh, unsigned int max_size, int type, const void* data, unsigned int size);
+
+     /**
+      * @brief Split the attributes of a netlink message into a table indexed by attribute type.
+      * @param tb table with max + 1 entries
+      * @param max highest attribute type of interest
+      * @param rta first attribute
+      * @param len size of all attributes
+      */
+     static void parse_attr(struct rtattr* tb[], int max, struct rtattr* rta, int len);
+};
+
+#endif // NETLINK_SOCKET_HPP
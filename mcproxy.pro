@@ -15,7 +15,10 @@ SOURCES += src/main.cpp \
            src/utils/mc_tables.cpp \
            src/utils/addr_storage.cpp \
            src/utils/mroute_socket.cpp \
+           src/utils/mroute_netlink.cpp \
+           src/utils/netlink_socket.cpp \
            src/utils/if_prop.cpp \
+           src/utils/if_cache.cpp \
                 #proxy
            src/proxy/proxy.cpp \
            src/proxy/sender.cpp \
@@ -24,9 +27,12 @@ SOURCES += src/main.cpp \
            src/proxy/igmp_receiver.cpp \
            src/proxy/mld_sender.cpp \
            src/proxy/igmp_sender.cpp \
+           src/proxy/sender_service.cpp \
            src/proxy/proxy_instance.cpp \
            src/proxy/routing.cpp \
            src/proxy/worker.cpp \
+           src/proxy/worker_pool.cpp \
+           src/proxy/thread_prop.cpp \
            src/proxy/timing.cpp \
            src/proxy/check_if.cpp \
            src/proxy/check_source.cpp
@@ -37,8 +43,12 @@ HEADERS += include/hamcast_logging.h \
            include/utils/mc_tables.hpp \
            include/utils/addr_storage.hpp \
            include/utils/mc_timers_values.hpp \
+           include/utils/mc_msg_format.hpp \
            include/utils/mroute_socket.hpp \
+           include/utils/mroute_netlink.hpp \
+           include/utils/netlink_socket.hpp \
            include/utils/if_prop.hpp \
+           include/utils/if_cache.hpp \
                #proxy
            include/proxy/proxy.hpp \
            include/proxy/sender.hpp \
@@ -47,11 +57,14 @@ HEADERS += include/hamcast_logging.h \
            include/proxy/igmp_receiver.hpp \
            include/proxy/mld_sender.hpp \
            include/proxy/igmp_sender.hpp \
+           include/proxy/sender_service.hpp \
            include/proxy/proxy_instance.hpp \
            include/proxy/message_queue.hpp \
            include/proxy/message_format.hpp \
            include/proxy/routing.hpp \
            include/proxy/worker.hpp \
+           include/proxy/worker_pool.hpp \
+           include/proxy/thread_prop.hpp \
            include/proxy/timing.hpp \
 	      include/proxy/check_if.hpp \
            include/proxy/check_source.hpp
@@ -24,6 +24,8 @@
 #include "include/utils/mc_socket.hpp"
 #include "include/utils/mroute_socket.hpp"
 #include "include/utils/mc_tables.hpp"
+#include "include/utils/mroute_netlink.hpp"
+#include "include/utils/if_cache.hpp"
 #include "include/utils/addr_storage.hpp"
 #include "include/proxy/proxy.hpp"
 #include "include/proxy/timing.hpp"
@@ -65,6 +67,11 @@ void test_log(){
 }
 
 void test_mctables(){
+     //needs a running mcproxy, the following tests need the multicast routing sockets for themselves
+     cout << "##-- upstream failover ipv4 --##" << endl;
+     mroute_netlink::test_failover(AF_INET, MROUTE_SOCKET_IF_STR_ONE, 5000);
+     cout << endl;
+
      mroute_socket m4;
      mroute_socket m6;
      if(!m4.create_raw_ipv4_socket()){
@@ -87,7 +94,10 @@ void test_mctables(){
           return;
      }
 
-     cout << "##-- joined groups ipv4 -- ##" << endl;
+     cout << "##-- interface cache -- ##" << endl;
+     if_cache::test_if_cache();
+
+     cout << endl << "##-- joined groups ipv4 -- ##" << endl;
      mc_tables::test_joined_groups(AF_INET);
 
      cout << endl << "##-- print vifs ipv4 --##" << endl;
@@ -97,6 +107,8 @@ void test_mctables(){
      cout << endl << "##-- print cache ipv4 --##" << endl;
      mroute_socket::test_add_route(&m4);
      mc_tables::test_mr_cache(AF_INET);
+     mroute_netlink::test_dump_routes(AF_INET);
+     mroute_netlink::test_route_batch_bench(&m4, 10000);
      mroute_socket::test_del_route(&m4);
      mroute_socket::test_del_vifs(&m4);
 
@@ -110,9 +122,14 @@ void test_mctables(){
      cout << endl << "##-- print cache ipv6 --##" << endl;
      mroute_socket::test_add_route(&m6);
      mc_tables::test_mr_cache(AF_INET6);
+     mroute_netlink::test_dump_routes(AF_INET6);
 
      mroute_socket::test_del_route(&m6);
      mroute_socket::test_del_vifs(&m6);
+
+     cout << endl << "##-- route table parser benchmark --##" << endl;
+     mc_tables::test_route_table_bench(AF_INET);
+     mc_tables::test_route_table_bench(AF_INET6);
 }
 
 void test_mcproxy(int arg_count, char* args[]){
@@ -23,6 +23,10 @@
 #include "include/hamcast_logging.h"
 #include "include/proxy/check_if.hpp"
 #include <net/if.h>
+#include <poll.h>
+#include <errno.h>
+#include <cstring>
+#include <algorithm>
 #include <iostream>
 
 using namespace std;
@@ -39,23 +43,21 @@ std::vector<int> check_if::init(vector<int>& check_lst, int addr_family){
     this->m_check_lst = check_lst;
     this->m_addr_family = addr_family;
 
+    //subscribe before the first snapshot, so no change gets lost
+    unsigned int groups = RTMGRP_LINK | ((m_addr_family == AF_INET)? RTMGRP_IPV4_IFADDR : RTMGRP_IPV6_IFADDR);
+    if(!m_nl_sock.create_rtnl_socket(groups)){
+        HC_LOG_WARN("failed to subscribe to interface events, poll the interfaces");
+    }
+
     vector<int> result;
-    m_if_property_a.refresh_network_interfaces();
-    m_current_prop = &m_if_property_a;
+    if_cache::getInstance()->refresh();
+    if_cache_snapshot snapshot = if_cache::getInstance()->get_snapshot();
 
     for(vector<int>::iterator i= m_check_lst.begin(); i != m_check_lst.end(); i++){
-        char cstr[IF_NAMESIZE];
-        string if_name(if_indextoname(*i,cstr));
-
-        struct ifaddrs* prop;
-        if(m_addr_family == AF_INET){
-            prop = m_current_prop->get_ip4_if(if_name);
-        }else if(m_addr_family == AF_INET6){
-            list<struct ifaddrs*>* ipv6_if_list = m_current_prop->get_ip6_if(if_name);
-            prop = *(ipv6_if_list->begin());
-        }
+        bool running = is_running(snapshot, *i);
+        m_running[*i] = running;
 
-        if(!(prop->ifa_flags & IFF_RUNNING)){ //down
+        if(!running){ //down
             result.push_back(*i);
         }
     }
@@ -63,55 +65,184 @@ std::vector<int> check_if::init(vector<int>& check_lst, int addr_family){
     return result;
 }
 
+bool check_if::is_running(const if_cache_snapshot& snapshot, int if_index){
+    HC_LOG_TRACE("");
+
+    const struct if_cache_entry* entry = if_cache::find(snapshot, if_index);
+    if(entry == NULL){ //removed
+        return false;
+    }
+
+    if(m_addr_family != AF_INET && m_addr_family != AF_INET6){
+        HC_LOG_ERROR("wrong addr_family: " << m_addr_family);
+        return false;
+    }
+
+    return !entry->get_addrs(m_addr_family).empty() && (entry->flags & IFF_RUNNING);
+}
+
 bool check_if::check(){
     HC_LOG_TRACE("");
 
     m_swap_to_up.clear();
     m_swap_to_down.clear();
+    m_addr_changed.clear();
+
+    return resync();
+}
 
-    if_prop* if_property_old = m_current_prop;
+bool check_if::resync(){
+    HC_LOG_TRACE("");
 
-    if(m_current_prop == &m_if_property_a){
-        m_current_prop = &m_if_property_b;
-    }else if(m_current_prop == &m_if_property_b){
-        m_current_prop = &m_if_property_a;
-    }else{
-        HC_LOG_ERROR("unknown pointer");
+    if(!if_cache::getInstance()->refresh()){
         return false;
     }
+    if_cache_snapshot snapshot = if_cache::getInstance()->get_snapshot();
 
-    m_current_prop->refresh_network_interfaces();
+    for(map<int, bool>::iterator i= m_running.begin(); i != m_running.end(); i++){
+        bool running = is_running(snapshot, i->first);
 
-    for(vector<int>::iterator i= m_check_lst.begin(); i != m_check_lst.end(); i++){
-        char cstr[IF_NAMESIZE];
-        string if_name(if_indextoname(*i,cstr));
+        if(running != i->second){ //IFF_RUNNING changed
+            if(running){ //up
+                m_swap_to_up.push_back(i->first);
+            }else{ //down
+                m_swap_to_down.push_back(i->first);
+            }
+            i->second = running;
+        }
+    }
+
+    return true;
+}
+
+bool check_if::check(int timeout_msec){
+    HC_LOG_TRACE("");
+
+    if(!m_nl_sock.is_valid()){
+        usleep(timeout_msec * 1000);
+        return check();
+    }
 
-        struct ifaddrs* prop_new = m_current_prop->get_ip4_if(if_name);
-        struct ifaddrs* prop_old = if_property_old->get_ip4_if(if_name);
+    m_swap_to_up.clear();
+    m_swap_to_down.clear();
+    m_addr_changed.clear();
 
-        if(m_addr_family == AF_INET){
-             prop_new = m_current_prop->get_ip4_if(if_name);
-             prop_old = if_property_old->get_ip4_if(if_name);
-        }else if(m_addr_family == AF_INET6){
-            list<struct ifaddrs*>* ipv6_if_list_new = m_current_prop->get_ip6_if(if_name);
-            list<struct ifaddrs*>* ipv6_if_list_old = if_property_old->get_ip6_if(if_name);
+    struct pollfd pfd;
+    pfd.fd = m_nl_sock.get_socket();
+    pfd.events = POLLIN;
+    pfd.revents = 0;
 
-            prop_new = *(ipv6_if_list_new->begin());
-            prop_old = *(ipv6_if_list_old->begin());
+    int rc = poll(&pfd, 1, timeout_msec);
+    if(rc < 0){
+        if(errno == EINTR){ //e.g. the signal to stop the proxy
+            return true;
         }
+        HC_LOG_ERROR("failed to wait for interface events! Error: " << strerror(errno) << " errno: " << errno);
+        return false;
+    }else if(rc == 0){ //timeout
+        return true;
+    }
 
-        if(((prop_new->ifa_flags ^ prop_old->ifa_flags) & IFF_RUNNING)){ //IFF_RUNNING changed
-            if(prop_new->ifa_flags & IFF_RUNNING){ //up
-                m_swap_to_up.push_back(*i);
+    map<int, bool> prev_running; //state before this check of all changed interfaces
+    vector<int> flapped; //interfaces that went down in the meantime
+    bool lost_events = false;
+    bool received = false;
+
+    for(;;){
+        int len = m_nl_sock.receive(m_buf, true);
+        if(len == 0){
+            break;
+        }else if(len < 0){ //e.g. ENOBUFS, the receive buffer overran
+            lost_events = true;
+            break;
+        }
+        received = true;
+
+        for(struct nlmsghdr* nlh = (struct nlmsghdr*)&m_buf[0]; NLMSG_OK(nlh, (unsigned int)len); nlh = NLMSG_NEXT(nlh, len)){
+            handle_event(nlh, prev_running, flapped);
+        }
+    }
+
+    //report only the net change, a short down and up has to re-register the interface
+    for(map<int, bool>::iterator i = prev_running.begin(); i != prev_running.end(); i++){
+        bool running = m_running[i->first];
+
+        if(running != i->second){
+            if(running){ //up
+                m_swap_to_up.push_back(i->first);
             }else{ //down
-                m_swap_to_down.push_back(*i);
+                m_swap_to_down.push_back(i->first);
             }
+        }else if(running && find(flapped.begin(), flapped.end(), i->first) != flapped.end()){
+            m_swap_to_down.push_back(i->first);
+            m_swap_to_up.push_back(i->first);
         }
     }
 
+    if(lost_events){
+        HC_LOG_WARN("lost interface events, poll all interfaces");
+        m_addr_changed = m_check_lst;
+        return resync();
+    }
+
+    //one refresh for all events of this wakeup
+    if(received && !if_cache::getInstance()->refresh()){
+        return false;
+    }
+
     return true;
 }
 
+void check_if::handle_event(struct nlmsghdr* nlh, map<int, bool>& prev_running, vector<int>& flapped){
+    HC_LOG_TRACE("");
+
+    if(nlh->nlmsg_type == RTM_NEWLINK || nlh->nlmsg_type == RTM_DELLINK){
+        struct ifinfomsg* ifi = (struct ifinfomsg*)NLMSG_DATA(nlh);
+
+        map<int, bool>::iterator it = m_running.find(ifi->ifi_index);
+        if(it == m_running.end()){ //not monitored
+            return;
+        }
+
+        bool running = (nlh->nlmsg_type == RTM_NEWLINK) && (ifi->ifi_flags & IFF_RUNNING);
+        if(prev_running.find(it->first) == prev_running.end()){
+            prev_running[it->first] = it->second;
+        }
+        if(it->second && !running){
+            flapped.push_back(it->first);
+        }
+        it->second = running;
+
+        HC_LOG_DEBUG("link event if_index: " << ifi->ifi_index << " running: " << running);
+    }else if(nlh->nlmsg_type == RTM_NEWADDR || nlh->nlmsg_type == RTM_DELADDR){
+        struct ifaddrmsg* ifa = (struct ifaddrmsg*)NLMSG_DATA(nlh);
+
+        if(ifa->ifa_family != m_addr_family || m_running.find(ifa->ifa_index) == m_running.end()){
+            return;
+        }
+
+        if(find(m_addr_changed.begin(), m_addr_changed.end(), (int)ifa->ifa_index) == m_addr_changed.end()){
+            m_addr_changed.push_back(ifa->ifa_index);
+        }
+
+        HC_LOG_DEBUG("address event if_index: " << ifa->ifa_index);
+    }
+}
+
+bool check_if::is_event_driven() const{
+    HC_LOG_TRACE("");
+    return m_nl_sock.is_valid();
+}
+
+int check_if::get_event_socket() const{
+    HC_LOG_TRACE("");
+
+    if(!m_nl_sock.is_valid()){
+        return -1;
+    }
+    return m_nl_sock.get_socket();
+}
+
 std::vector<int> check_if::swap_to_up(){
     HC_LOG_TRACE("");
     return m_swap_to_up;
@@ -123,22 +254,26 @@ std::vector<int> check_if::swap_to_down(){
     return m_swap_to_down;
 }
 
+std::vector<int> check_if::addr_changed(){
+    HC_LOG_TRACE("");
+    return m_addr_changed;
+}
+
 void check_if::test_check_if(){
     HC_LOG_TRACE("");
 
     check_if c;
-    if_prop prop;
     vector<int> if_list_tmp;
-    char cstr[IF_NAMESIZE];
     int sleeptime= 0;
 
     //fill if_list_tmp
-    prop.refresh_network_interfaces();
-    if_prop_map* if_prop_map_p = prop.get_if_props();
+    if_cache* cache = if_cache::getInstance();
+    cache->refresh();
+    if_cache_snapshot snapshot = cache->get_snapshot();
     cout << "available interfaces under test:" << endl;
-    for(if_prop_map::iterator i= if_prop_map_p->begin(); i != if_prop_map_p->end(); i++){
-        cout << i->first <<" ";
-        if_list_tmp.push_back(if_nametoindex(i->first.c_str()));
+    for(if_cache_map::const_iterator i= snapshot->begin(); i != snapshot->end(); i++){
+        cout << i->second.name <<" ";
+        if_list_tmp.push_back(i->first);
     }
     cout << endl;
 
@@ -146,19 +281,20 @@ void check_if::test_check_if(){
     if_list_tmp = c.init(if_list_tmp, AF_INET);
     cout << "this interfaces are down:" << endl;
     for(vector<int>::iterator i= if_list_tmp.begin(); i != if_list_tmp.end(); i++){
-        cout << if_indextoname(*i,cstr) << " ";
+        cout << cache->get_name(*i) << " ";
     }
     cout << endl;
 
+    cout << "event driven: " << (c.is_event_driven()? "yes" : "no") << endl;
+
     while(sleeptime< 1000){
-        usleep(1000000);
         cout << "sleeptime: " << sleeptime << endl;
-        c.check();
+        c.check(1000);
         if_list_tmp = c.swap_to_down();
         if(if_list_tmp.size() >0){
             cout << "this interfaces switch to down: " << endl;
             for(vector<int>::iterator i= if_list_tmp.begin(); i < if_list_tmp.end(); i++){
-                cout << if_indextoname(*i,cstr) << " ";
+                cout << cache->get_name(*i) << " ";
             }
             cout << endl;
         }
@@ -167,7 +303,16 @@ void check_if::test_check_if(){
         if(if_list_tmp.size() >0){
             cout << "this interfaces switch to up: " << endl;
             for(vector<int>::iterator i= if_list_tmp.begin(); i < if_list_tmp.end(); i++){
-                cout << if_indextoname(*i,cstr) << " ";
+                cout << cache->get_name(*i) << " ";
+            }
+            cout << endl;
+        }
+
+        if_list_tmp = c.addr_changed();
+        if(if_list_tmp.size() >0){
+            cout << "this interfaces changed their addresses: " << endl;
+            for(vector<int>::iterator i= if_list_tmp.begin(); i < if_list_tmp.end(); i++){
+                cout << cache->get_name(*i) << " ";
             }
             cout << endl;
         }
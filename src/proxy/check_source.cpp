@@ -22,28 +22,58 @@
 
 #include "include/hamcast_logging.h"
 #include "include/proxy/check_source.hpp"
+#include "include/proxy/routing.hpp"
 
-bool check_source::init(int addr_family){
+check_source::check_source():
+     m_addr_family(-1), m_mode(PROC_TABLE), m_current_check(NULL), m_routing(NULL), m_check_round(0)
+{
+     HC_LOG_TRACE("");
+}
+
+bool check_source::init(int addr_family, check_mode mode){
      HC_LOG_TRACE("");
 
      this->m_addr_family = addr_family;
-     m_check_src_a.init_tables(m_addr_family);
-     m_check_src_b.init_tables(m_addr_family);
-     if(!m_check_src_a.refresh_routes()) return false;
-     m_current_check = &m_check_src_a;
+     this->m_mode = mode;
 
-     return true;
+     if(m_mode == SG_COUNTER){
+          m_routing = routing::getInstance();
+          return true;
+     }else if(m_mode == PROC_TABLE){
+          m_check_src_a.init_tables(m_addr_family);
+          m_check_src_b.init_tables(m_addr_family);
+          if(!m_check_src_a.refresh_route_table()) return false;
+          m_current_check = &m_check_src_a;
+          return true;
+     }else{
+          HC_LOG_ERROR("unknown check mode: " << mode);
+          return false;
+     }
 }
 
 bool check_source::check(){
      HC_LOG_TRACE("");
 
+     if(m_mode == SG_COUNTER){
+          //forget the forwarding rules which were not asked for in the last round
+          sg_counter_map::iterator it = m_counter_map.begin();
+          while(it != m_counter_map.end()){
+               if(it->second.check_round != m_check_round){
+                    m_counter_map.erase(it++);
+               }else{
+                    ++it;
+               }
+          }
+          m_check_round++;
+          return true;
+     }
+
      if(m_current_check == &m_check_src_a){
           m_current_check = &m_check_src_b;
      }else{
           m_current_check = &m_check_src_a;
      }
-     if(!m_current_check->refresh_routes()) return false;
+     if(!m_current_check->refresh_route_table()) return false;
 
      return true;
 
@@ -52,21 +82,55 @@ bool check_source::check(){
 bool check_source::is_src_unused(int vif, addr_storage src_addr, addr_storage g_addr){
      HC_LOG_TRACE("");
 
-     int current_n_packets= -1;
-     int old_n_packets = -1;
-     mc_tables* old_mc_table= (m_current_check == &m_check_src_a)? &m_check_src_b : &m_check_src_a;
+     if(m_mode == SG_COUNTER){
+          return is_src_unused_sg_counter(src_addr, g_addr);
+     }else{
+          return is_src_unused_proc_table(vif, src_addr, g_addr);
+     }
+}
 
-     for(unsigned int i=0; (i < m_current_check->get_routes_count()) && (current_n_packets < 0); i++){
-          if(m_current_check->get_route(i).i_if == vif && m_current_check->get_route(i).group == g_addr && m_current_check->get_route(i).origin == src_addr){
-               current_n_packets=  m_current_check->get_route(i).pkts;
+bool check_source::is_src_unused_sg_counter(const addr_storage& src_addr, const addr_storage& g_addr){
+     HC_LOG_TRACE("");
 
-          }
+     pair<addr_storage, addr_storage> key(src_addr, g_addr);
+     unsigned long current_n_packets;
+
+     if(!m_routing->get_route_pkt_cnt(src_addr, g_addr, current_n_packets)){
+          HC_LOG_ERROR("can't find route! source address: " << src_addr << " group address: " << g_addr);
+          m_counter_map.erase(key);
+          return true;
      }
 
-     for(unsigned int i=0; (i < old_mc_table->get_routes_count()) && (old_n_packets < 0); i++){
-          if(old_mc_table->get_route(i).i_if == vif && old_mc_table->get_route(i).group == g_addr && old_mc_table->get_route(i).origin == src_addr){
-               old_n_packets=  old_mc_table->get_route(i).pkts;
-          }
+     struct sg_counter c;
+     c.pkts = current_n_packets;
+     c.check_round = m_check_round;
+
+     sg_counter_map::iterator it = m_counter_map.find(key);
+     if(it == m_counter_map.end()){
+          m_counter_map.insert(sg_counter_pair(key, c));
+          return current_n_packets == 0;
+     }else{
+          bool unused = (it->second.pkts == current_n_packets);
+          it->second = c;
+          return unused;
+     }
+}
+
+bool check_source::is_src_unused_proc_table(int vif, const addr_storage& src_addr, const addr_storage& g_addr){
+     HC_LOG_TRACE("");
+
+     long current_n_packets= -1;
+     long old_n_packets = -1;
+     mc_tables* old_mc_table= (m_current_check == &m_check_src_a)? &m_check_src_b : &m_check_src_a;
+
+     int row = m_current_check->find_route(vif, src_addr, g_addr);
+     if(row >= 0){
+          current_n_packets = m_current_check->get_route_table().pkts[row];
+     }
+
+     row = old_mc_table->find_route(vif, src_addr, g_addr);
+     if(row >= 0){
+          old_n_packets = old_mc_table->get_route_table().pkts[row];
      }
 
      if(current_n_packets < 0){
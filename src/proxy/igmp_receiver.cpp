@@ -22,6 +22,7 @@
 
 #include "include/hamcast_logging.h"
 #include "include/proxy/igmp_receiver.hpp"
+#include "include/utils/mc_msg_format.hpp"
 #include "include/proxy/proxy_instance.hpp"
 
 #include <net/if.h>
@@ -37,9 +38,7 @@ igmp_receiver::igmp_receiver(){
 
 int igmp_receiver::get_iov_min_size(){
      HC_LOG_TRACE("");
-     int size_ip = sizeof(struct ip) + sizeof(struct igmp) + IGMP_RECEIVER_IPV4_ROUTER_ALERT_OPT_SIZE;
-     int size_kernel = sizeof(struct igmpmsg);
-     return (size_ip < size_kernel)? size_kernel : size_ip;
+     return IGMP_RECEIVER_MAX_PACKET_SIZE;
 }
 
 int igmp_receiver::get_ctrl_min_size(){
@@ -85,13 +84,100 @@ void igmp_receiver::analyse_packet(struct msghdr* msg, int info_size){
                proxy_msg m;
                m.type = proxy_msg::RECEIVER_MSG;
                m.msg = new struct receiver_msg(receiver_msg::CACHE_MISS, if_index, src_addr, g_addr);
-               pr_i->add_msg(m);
+               send_to_shard(if_index, g_addr, m);
                break;
           }
           default:
                HC_LOG_WARN("unknown kernel message");
           }
-     }else if(ip_hdr->ip_p == IPPROTO_IGMP && ntohs(ip_hdr->ip_len)==get_iov_min_size()){
+     }else if(ip_hdr->ip_p == IPPROTO_IGMP && igmp_hdr->igmp_type == IGMP_MEMBERSHIP_QUERY && info_size >= (int)(ip_hdr->ip_hl*4 + sizeof(struct igmp))){
+          HC_LOG_DEBUG("\tquery");
+
+          src_addr = ip_hdr->ip_src;
+          HC_LOG_DEBUG("\tsrc: " << src_addr);
+
+          g_addr = igmp_hdr->igmp_group;
+          HC_LOG_DEBUG("\tgroup: " << g_addr);
+
+          //the receive buffer may truncate IGMPv3 queries, the version follows from the ip length (RFC 3376 Section 7.1)
+          int igmp_len = ntohs(ip_hdr->ip_len) - ip_hdr->ip_hl*4;
+          int code = igmp_hdr->igmp_code;
+          int max_resp_time; //msec
+          if(code == 0){ //IGMPv1
+               max_resp_time = IGMP_RECEIVER_V1_MAX_RESP_TIME;
+          }else if(igmp_len >= MC_MSG_IGMPV3_QUERY_MIN_SIZE && code >= 128){ //floating point value (RFC 3376 Section 4.1.1)
+               max_resp_time = (((code & 0x0f) | 0x10) << (((code >> 4) & 0x07) + 3)) * 100;
+          }else{
+               max_resp_time = code * 100;
+          }
+          HC_LOG_DEBUG("\tmax_resp_time: " << max_resp_time);
+
+          if((if_index = this->map_ip2if_index(src_addr)) == 0) return;
+          HC_LOG_DEBUG("\tif_index: " << if_index);
+
+          if((pr_i= this->get_proxy_instance(if_index))== NULL) return;
+
+          proxy_msg m;
+          m.type = proxy_msg::RECEIVER_MSG;
+          m.msg = new struct receiver_msg(receiver_msg::QUERY, if_index, src_addr, g_addr, max_resp_time);
+          send_to_shard(if_index, g_addr, m);
+     }else if(ip_hdr->ip_p == IPPROTO_IGMP && igmp_hdr->igmp_type == MC_MSG_IGMPV3_MEMBERSHIP_REPORT){
+          HC_LOG_DEBUG("\tIGMPv3 report");
+
+          src_addr = ip_hdr->ip_src;
+          HC_LOG_DEBUG("\tsrc: " << src_addr);
+
+          if((if_index = this->map_ip2if_index(src_addr)) == 0) return;
+          HC_LOG_DEBUG("\tif_index: " << if_index);
+
+          if((pr_i= this->get_proxy_instance(if_index))== NULL) return;
+
+          //parse only what was received and what the ip header announces
+          int end = ntohs(ip_hdr->ip_len);
+          if(end > info_size) end = info_size;
+          unsigned char* buf = (unsigned char*)msg->msg_iov->iov_base;
+
+          int pos = ip_hdr->ip_hl*4;
+          if(pos + (int)sizeof(struct igmpv3_report_hdr) > end){
+               HC_LOG_DEBUG("IGMPv3 report to short");
+               return;
+          }
+          struct igmpv3_report_hdr* report = (struct igmpv3_report_hdr*)(buf + pos);
+          int num_of_records = ntohs(report->num_of_mc_records);
+          pos += sizeof(struct igmpv3_report_hdr);
+
+          struct receiver_msg* r_msg = new struct receiver_msg(receiver_msg::RECORDS, if_index, src_addr, addr_storage());
+          for(int i = 0; i < num_of_records; i++){
+               if(pos + (int)sizeof(struct igmpv3_mc_record) > end){
+                    HC_LOG_DEBUG("IGMPv3 report truncated at record: " << i);
+                    break;
+               }
+               struct igmpv3_mc_record* rec = (struct igmpv3_mc_record*)(buf + pos);
+               int num_of_srcs = ntohs(rec->num_of_srcs);
+               int rec_size = sizeof(struct igmpv3_mc_record) + num_of_srcs*sizeof(struct in_addr) + rec->aux_data_len*4;
+               if(pos + rec_size > end){
+                    HC_LOG_DEBUG("IGMPv3 report truncated at record: " << i);
+                    break;
+               }
+
+               r_msg->records.push_back(group_record(rec->type, addr_storage(rec->mc_addr)));
+               group_record& g_rec = r_msg->records.back();
+               struct in_addr* srcs = (struct in_addr*)(buf + pos + sizeof(struct igmpv3_mc_record));
+               for(int j = 0; j < num_of_srcs; j++){
+                    g_rec.src_addrs.push_back(addr_storage(srcs[j]));
+               }
+               HC_LOG_DEBUG("\trecord type: " << g_rec.type << " group: " << g_rec.g_addr << " sources: " << num_of_srcs);
+
+               pos += rec_size;
+          }
+
+          if(r_msg->records.empty()){
+               delete r_msg;
+               return;
+          }
+
+          send_records_to_shards(r_msg);
+     }else if(ip_hdr->ip_p == IPPROTO_IGMP && info_size >= (int)(ip_hdr->ip_hl*4 + sizeof(struct igmp))){
           //test_output::printPaket_IPv4_IgmpInfos(buf);
           if(igmp_hdr->igmp_type == IGMP_V2_MEMBERSHIP_REPORT){
                HC_LOG_DEBUG("\tjoin");
@@ -109,8 +195,8 @@ void igmp_receiver::analyse_packet(struct msghdr* msg, int info_size){
 
                proxy_msg m;
                m.type = proxy_msg::RECEIVER_MSG;
-               m.msg = new struct receiver_msg(receiver_msg::JOIN, if_index, g_addr);
-               pr_i->add_msg(m);
+               m.msg = new struct receiver_msg(receiver_msg::JOIN, if_index, src_addr, g_addr);
+               send_to_shard(if_index, g_addr, m);
           }else if(igmp_hdr->igmp_type == IGMP_V2_LEAVE_GROUP){
                HC_LOG_DEBUG("\tleave");
 
@@ -127,8 +213,8 @@ void igmp_receiver::analyse_packet(struct msghdr* msg, int info_size){
 
                proxy_msg m;
                m.type = proxy_msg::RECEIVER_MSG;
-               m.msg = new struct receiver_msg(receiver_msg::LEAVE, if_index, g_addr);
-               pr_i->add_msg(m);
+               m.msg = new struct receiver_msg(receiver_msg::LEAVE, if_index, src_addr, g_addr);
+               send_to_shard(if_index, g_addr, m);
           }else{
                HC_LOG_DEBUG("unknown IGMP-packet");
                HC_LOG_DEBUG("type: " << igmp_hdr->igmp_type);
@@ -141,32 +227,28 @@ void igmp_receiver::analyse_packet(struct msghdr* msg, int info_size){
 int igmp_receiver::map_ip2if_index(const addr_storage& src_addr){
      HC_LOG_TRACE("");
 
-     char cstr[IF_NAMESIZE];
      addr_storage tmp_mask;
-
-     addr_storage own_addr;
-     struct ifaddrs* item;
-
      addr_storage comp_addr;
 
      if(src_addr.get_addr_family() == AF_INET){
+          if_cache_snapshot snapshot = if_cache::getInstance()->get_snapshot();
+
           if_poxy_instance_map::iterator it;
           for(it= m_if_proxy_map.begin(); it != m_if_proxy_map.end(); it++){
-               //maks own ip
-               string if_name(if_indextoname(it->first, cstr));
-
-               item = m_if_property.get_ip4_if(if_name);
-               if(item == NULL) return 0;
+               const struct if_cache_entry* entry = if_cache::find(snapshot, it->first);
+               if(entry == NULL) continue;
 
-               own_addr = *(item->ifa_addr);
-               tmp_mask = *(item->ifa_netmask);
+               //maks own ips
+               for(unsigned int i = 0; i < entry->ipv4.size(); i++){
+                    comp_addr = entry->ipv4[i].addr;
+                    tmp_mask = entry->ipv4[i].netmask;
 
-               comp_addr = own_addr.mask(tmp_mask);
+                    comp_addr.mask(tmp_mask);
 
-               if(comp_addr == tmp_mask.mask(src_addr)){
-                    return it->first;
+                    if(comp_addr == tmp_mask.mask(src_addr)){
+                         return it->first;
+                    }
                }
-
           }
      }else{
           HC_LOG_ERROR("cannot map IPv6 addr to interface index:" << src_addr);
@@ -27,8 +27,11 @@
 #include <netinet/igmp.h>
 #include <netinet/ip.h>
 #include <net/if.h>
+#include <cstring>
 
-igmp_sender::igmp_sender(){
+igmp_sender::igmp_sender():
+    m_query_size(-1)
+{
     HC_LOG_TRACE("");
 
 }
@@ -38,6 +41,11 @@ bool igmp_sender::init(int addr_family, int version){
 
     if(addr_family == AF_INET){
         if(!sender::init(addr_family,version)) return false;
+        if(!init_templates()) return false;
+
+        //reports and queries carry the router alert option (RFC 2113)
+        unsigned char router_alert[] = {IPOPT_RA, 4, 0, 0};
+        if(!m_sock.add_extension_header(router_alert, sizeof(router_alert))) return false;
     }else{
         return false;
     }
@@ -45,42 +53,225 @@ bool igmp_sender::init(int addr_family, int version){
     return true;
 }
 
-bool igmp_sender::send_general_query(int if_index){
+bool igmp_sender::init_templates(){
     HC_LOG_TRACE("");
 
-    int size = get_msg_min_size();
-    if(size <0) return false;
-    unsigned char buf[size];
+    memset(&m_gq_dst, 0, sizeof(m_gq_dst));
+    m_gq_dst.sin_family = AF_INET;
+    m_gq_dst.sin_addr <<= addr_storage(IPV4_ALL_HOST_ADDR);
+
+    memset(&m_gsq_dst, 0, sizeof(m_gsq_dst));
+    m_gsq_dst.sin_family = AF_INET;
+
+    m_all_routers_dst = m_gsq_dst;
+    m_all_routers_dst.sin_addr <<= addr_storage(IPV4_ALL_IGMP_ROUTERS_ADDR);
+
+    m_igmpv3_dst = m_gsq_dst;
+    m_igmpv3_dst.sin_addr <<= addr_storage(IPV4_IGMPV3_ADDR);
 
-    if(!m_sock.choose_if(if_index)) return false;
-    if(!create_mc_query(GENERAL_QUERY, buf)) return false;
+    m_query_size = get_msg_min_size();
+    if(m_query_size < 0){ //the sends report the error
+        return true;
+    }
+
+    addr_storage unspecified(m_addr_family); //0.0.0.0
+    if(!create_mc_query(GENERAL_QUERY, (unsigned char*)&m_gq)) return false;
+    if(!create_mc_query(GROUP_SPECIFIC_QUERY, (unsigned char*)&m_gsq, &unspecified)) return false;
 
-    return m_sock.send_packet(IPV4_ALL_HOST_ADDR,0,buf,sizeof(buf));
+    return true;
+}
+
+void igmp_sender::fill_gsq(const addr_storage& g_addr, struct igmpv3_query* query, struct sockaddr_in* dst){
+    HC_LOG_TRACE("");
+
+    //patch the group into the template and update the checksum incrementally
+    *query = m_gsq;
+    query->group <<= g_addr;
+    query->checksum = mroute_socket::update_checksum(m_gsq.checksum, (unsigned char*)&m_gsq.group, (unsigned char*)&query->group, sizeof(query->group));
+
+    *dst = m_gsq_dst;
+    dst->sin_addr = query->group;
+}
+
+bool igmp_sender::send_general_query(int if_index){
+    HC_LOG_TRACE("");
+
+    if(m_query_size < 0){
+        HC_LOG_ERROR("IPv4 version: " << m_version << " not supported");
+        return false;
+    }
+
+    struct mroute_socket_packet p = {if_index, (struct sockaddr*)&m_gq_dst, sizeof(m_gq_dst), (unsigned char*)&m_gq, (unsigned int)m_query_size, NULL};
+    return m_sock.send_packets(&p, 1);
 }
 
 bool igmp_sender::send_group_specific_query(int if_index, const addr_storage& g_addr){
     HC_LOG_TRACE("");
 
-    int size = get_msg_min_size();
-    if(size <0) return false;
-    unsigned char buf[size];
+    if(m_query_size < 0){
+        HC_LOG_ERROR("IPv4 version: " << m_version << " not supported");
+        return false;
+    }
 
-    if(!m_sock.choose_if(if_index)) return false;
-    if(!create_mc_query(GROUP_SPECIFIC_QUERY, buf, &g_addr)) return false;
+    struct igmpv3_query query;
+    struct sockaddr_in dst;
+    fill_gsq(g_addr, &query, &dst);
 
-    return m_sock.send_packet(g_addr.to_string().c_str(),0,buf,sizeof(buf));
+    struct mroute_socket_packet p = {if_index, (struct sockaddr*)&dst, sizeof(dst), (unsigned char*)&query, (unsigned int)m_query_size, NULL};
+    return m_sock.send_packets(&p, 1);
 }
 
-bool igmp_sender::send_report(int if_index, const addr_storage& g_addr){
+bool igmp_sender::send_general_queries(const std::vector<int>& if_indexes){
     HC_LOG_TRACE("");
 
-    return m_sock.join_group(g_addr.to_string().c_str(),if_index);
+    if(m_query_size < 0){
+        HC_LOG_ERROR("IPv4 version: " << m_version << " not supported");
+        return false;
+    }
+
+    if(if_indexes.empty()) return true;
+
+    //all queries share the packet and the destination, only the egress interface differs
+    m_packets.resize(if_indexes.size());
+    for(unsigned int i = 0; i < if_indexes.size(); i++){
+        struct mroute_socket_packet& p = m_packets[i];
+        p.if_index = if_indexes[i];
+        p.dst = (struct sockaddr*)&m_gq_dst;
+        p.dst_len = sizeof(m_gq_dst);
+        p.data = (unsigned char*)&m_gq;
+        p.data_size = m_query_size;
+        p.src = NULL;
+    }
+
+    return m_sock.send_packets(&m_packets[0], m_packets.size());
 }
 
-bool igmp_sender::send_leave(int if_index, const addr_storage& g_addr){
+bool igmp_sender::send_group_specific_queries(const gsq_vector& queries){
     HC_LOG_TRACE("");
 
-    return m_sock.leave_group(g_addr.to_string().c_str(),if_index);
+    if(m_query_size < 0){
+        HC_LOG_ERROR("IPv4 version: " << m_version << " not supported");
+        return false;
+    }
+
+    if(queries.empty()) return true;
+
+    m_packets.resize(queries.size());
+    m_gsq_buf.resize(queries.size());
+    m_gsq_dst_buf.resize(queries.size());
+    for(unsigned int i = 0; i < queries.size(); i++){
+        fill_gsq(queries[i].second, &m_gsq_buf[i], &m_gsq_dst_buf[i]);
+
+        struct mroute_socket_packet& p = m_packets[i];
+        p.if_index = queries[i].first;
+        p.dst = (struct sockaddr*)&m_gsq_dst_buf[i];
+        p.dst_len = sizeof(struct sockaddr_in);
+        p.data = (unsigned char*)&m_gsq_buf[i];
+        p.data_size = m_query_size;
+        p.src = NULL;
+    }
+
+    return m_sock.send_packets(&m_packets[0], m_packets.size());
+}
+
+bool igmp_sender::send_raw_reports(int if_index, const std::vector<addr_storage>& g_addrs, report_type type){
+    HC_LOG_TRACE("");
+
+    if(g_addrs.empty()) return true;
+
+    if(m_version == 1 || m_version == 2){
+        if(type == LEAVE_REPORT && m_version == 1){ //IGMPv1 has no leave message
+            return true;
+        }
+
+        u_int8_t igmp_type;
+        if(type == LEAVE_REPORT){
+            igmp_type = IGMP_V2_LEAVE_GROUP;
+        }else{
+            igmp_type = (m_version == 1)? IGMP_V1_MEMBERSHIP_REPORT : IGMP_V2_MEMBERSHIP_REPORT;
+        }
+
+        //one report per group
+        m_report_buf.resize(g_addrs.size() * sizeof(struct igmp));
+        m_report_dst_buf.resize(g_addrs.size());
+        m_packets.resize(g_addrs.size());
+        for(unsigned int i = 0; i < g_addrs.size(); i++){
+            struct igmp* report = (struct igmp*)&m_report_buf[i * sizeof(struct igmp)];
+            report->igmp_type = igmp_type;
+            report->igmp_code = 0;
+            report->igmp_cksum = 0;
+            report->igmp_group <<= g_addrs[i];
+            report->igmp_cksum = m_sock.calc_checksum((unsigned char*)report, sizeof(struct igmp));
+
+            if(type == LEAVE_REPORT){
+                m_report_dst_buf[i] = m_all_routers_dst;
+            }else{
+                m_report_dst_buf[i] = m_gsq_dst;
+                m_report_dst_buf[i].sin_addr = report->igmp_group;
+            }
+
+            struct mroute_socket_packet& p = m_packets[i];
+            p.if_index = if_index;
+            p.dst = (struct sockaddr*)&m_report_dst_buf[i];
+            p.dst_len = sizeof(struct sockaddr_in);
+            p.data = (unsigned char*)report;
+            p.data_size = sizeof(struct igmp);
+            p.src = NULL;
+        }
+    }else if(m_version == 3){
+        u_int8_t record_type;
+        if(type == JOIN_REPORT){
+            record_type = MC_MSG_CHANGE_TO_EXCLUDE_MODE;
+        }else if(type == LEAVE_REPORT){
+            record_type = MC_MSG_CHANGE_TO_INCLUDE_MODE;
+        }else{
+            record_type = MC_MSG_MODE_IS_EXCLUDE;
+        }
+
+        //20 bytes ip header and 4 bytes router alert option
+        const unsigned int max_records = (SENDER_MTU - 24 - sizeof(struct igmpv3_report_hdr)) / sizeof(struct igmpv3_mc_record);
+        const unsigned int packet_count = (g_addrs.size() + max_records - 1) / max_records;
+        const unsigned int packet_size = sizeof(struct igmpv3_report_hdr) + max_records * sizeof(struct igmpv3_mc_record);
+
+        m_report_buf.resize(packet_count * packet_size);
+        m_packets.resize(packet_count);
+        for(unsigned int i = 0; i < packet_count; i++){
+            unsigned int first = i * max_records;
+            unsigned int records = (g_addrs.size() - first < max_records)? g_addrs.size() - first : max_records;
+
+            unsigned char* buf = &m_report_buf[i * packet_size];
+            struct igmpv3_report_hdr* hdr = (struct igmpv3_report_hdr*)buf;
+            hdr->type = MC_MSG_IGMPV3_MEMBERSHIP_REPORT;
+            hdr->reserved1 = 0;
+            hdr->checksum = 0;
+            hdr->reserved2 = 0;
+            hdr->num_of_mc_records = htons(records);
+
+            struct igmpv3_mc_record* record = (struct igmpv3_mc_record*)(hdr + 1);
+            for(unsigned int j = 0; j < records; j++){
+                record[j].type = record_type;
+                record[j].aux_data_len = 0;
+                record[j].num_of_srcs = 0;
+                record[j].mc_addr <<= g_addrs[first + j];
+            }
+
+            unsigned int size = sizeof(struct igmpv3_report_hdr) + records * sizeof(struct igmpv3_mc_record);
+            hdr->checksum = m_sock.calc_checksum(buf, size);
+
+            struct mroute_socket_packet& p = m_packets[i];
+            p.if_index = if_index;
+            p.dst = (struct sockaddr*)&m_igmpv3_dst;
+            p.dst_len = sizeof(m_igmpv3_dst);
+            p.data = buf;
+            p.data_size = size;
+            p.src = NULL;
+        }
+    }else{
+        HC_LOG_ERROR("IPv4 version: " << m_version << " not supported");
+        return false;
+    }
+
+    return m_sock.send_packets(&m_packets[0], m_packets.size());
 }
 
 int igmp_sender::get_msg_min_size(){
@@ -88,6 +279,8 @@ int igmp_sender::get_msg_min_size(){
 
     if(m_version == 2){
         return sizeof(struct igmp);
+    }else if(m_version == 3){
+        return MC_MSG_IGMPV3_QUERY_MIN_SIZE;
     }else{
         HC_LOG_ERROR("IPv4 version: " << m_version << " not supported");
         return -1;
@@ -98,29 +291,35 @@ int igmp_sender::get_msg_min_size(){
 bool igmp_sender::create_mc_query(msg_type type, unsigned char* buf,const addr_storage* g_addr){
     HC_LOG_TRACE("");
 
-    if(m_version == 2){
-        struct igmp* igmp_Hdr = (struct igmp*)(buf);
+    if(m_version == 2 || m_version == 3){
+        struct igmpv3_query* igmp_Hdr = (struct igmpv3_query*)(buf);
+        memset(igmp_Hdr, 0, sizeof(struct igmpv3_query));
 
-        igmp_Hdr->igmp_type = IGMP_MEMBERSHIP_QUERY;
-        igmp_Hdr->igmp_cksum = 0;
+        igmp_Hdr->type = IGMP_MEMBERSHIP_QUERY;
 
         if(type==GENERAL_QUERY){
-            igmp_Hdr->igmp_code = MC_TV_QUERY_RESPONSE_INTERVAL*MC_TV_MAX_RESPONSE_TIME_UNIT;
-            igmp_Hdr->igmp_group <<= addr_storage(m_addr_family); //0.0.0.0
+            igmp_Hdr->max_resp_code = MC_TV_QUERY_RESPONSE_INTERVAL*MC_TV_MAX_RESPONSE_TIME_UNIT;
+            igmp_Hdr->group <<= addr_storage(m_addr_family); //0.0.0.0
         }else if(type== GROUP_SPECIFIC_QUERY){
             if(!g_addr){
                 HC_LOG_ERROR("g_addr is NULL");
                 return false;
             }
 
-            igmp_Hdr->igmp_code = MC_TV_LAST_MEMBER_QUERY_INTEVAL*MC_TV_MAX_RESPONSE_TIME_UNIT;
-            igmp_Hdr->igmp_group <<= *g_addr;
+            igmp_Hdr->max_resp_code = MC_TV_LAST_MEMBER_QUERY_INTEVAL*MC_TV_MAX_RESPONSE_TIME_UNIT;
+            igmp_Hdr->group <<= *g_addr;
         }else{
             HC_LOG_ERROR("wrong type: " << type);
             return false;
         }
 
-        igmp_Hdr->igmp_cksum = m_sock.calc_checksum((unsigned char*)igmp_Hdr,sizeof(struct igmp));
+        //the used times are below 128 and need no floating point code
+        if(m_version == 3){
+            igmp_Hdr->s_qrv = MC_TV_ROBUSTNESS_VARIABLE;
+            igmp_Hdr->qqic = MC_TV_QUERY_INTERVAL;
+        }
+
+        igmp_Hdr->checksum = m_sock.calc_checksum(buf, m_query_size);
 
         return true;
     }else{
@@ -22,6 +22,7 @@
 
 #include "include/hamcast_logging.h"
 #include "include/proxy/mld_receiver.hpp"
+#include "include/utils/mc_msg_format.hpp"
 #include "include/proxy/proxy_instance.hpp"
 
 #include <linux/mroute6.h>
@@ -49,9 +50,7 @@ bool mld_receiver::init(int addr_family, int version, mroute_socket* mrt_sock){
 
 int mld_receiver::get_iov_min_size(){
      HC_LOG_TRACE("");
-     int size_ip = sizeof(struct mld_hdr);
-     int size_kernel = sizeof(struct mrt6msg);
-     return (size_ip < size_kernel)? size_kernel : size_ip;
+     return MLD_RECEIVER_MAX_PACKET_SIZE;
 }
 
 int mld_receiver::get_ctrl_min_size(){
@@ -85,12 +84,38 @@ void mld_receiver::analyse_packet(struct msghdr* msg, int info_size){
                proxy_msg m;
                m.type = proxy_msg::RECEIVER_MSG;
                m.msg = new struct receiver_msg(receiver_msg::CACHE_MISS, if_index, src_addr, g_addr);
-               pr_i->add_msg(m);
+               send_to_shard(if_index, g_addr, m);
                break;
           }
           default:
                HC_LOG_WARN("unknown kernel message");
           }
+     }else if(hdr->mld_type == MLD_LISTENER_QUERY && info_size >= (int)sizeof(struct mld_hdr)){
+          struct in6_pktinfo* packet_info = NULL;
+
+          for (struct cmsghdr* cmsgptr = CMSG_FIRSTHDR(msg); cmsgptr != NULL; cmsgptr = CMSG_NXTHDR(msg, cmsgptr)) {
+               if (cmsgptr->cmsg_len > 0 &&cmsgptr->cmsg_level == IPPROTO_IPV6 && cmsgptr->cmsg_type == IPV6_PKTINFO ) {
+                    packet_info = (struct in6_pktinfo*)CMSG_DATA(cmsgptr);
+               }
+          }
+          if(packet_info == NULL) return;
+
+          if((pr_i = this->get_proxy_instance(packet_info->ipi6_ifindex))== NULL) return;
+          g_addr = hdr->mld_addr;
+
+          int code = ntohs(hdr->mld_maxdelay);
+          int max_resp_time; //msec
+          if(info_size >= MC_MSG_MLDV2_QUERY_MIN_SIZE && code >= 32768){ //floating point value (RFC 3810 Section 5.1.3)
+               max_resp_time = ((code & 0x0fff) | 0x1000) << (((code >> 12) & 0x07) + 3);
+          }else{
+               max_resp_time = code;
+          }
+
+          //the querier address is needed for the querier election
+          proxy_msg m;
+          m.type = proxy_msg::RECEIVER_MSG;
+          m.msg = new struct receiver_msg(receiver_msg::QUERY, packet_info->ipi6_ifindex, get_src_addr(msg), g_addr, max_resp_time);
+          send_to_shard(packet_info->ipi6_ifindex, g_addr, m);
      }else if(hdr->mld_type == MLD_LISTENER_REPORT || hdr->mld_type == MLD_LISTENER_REDUCTION){ //join
           struct in6_pktinfo* packet_info = NULL;
 
@@ -108,15 +133,78 @@ void mld_receiver::analyse_packet(struct msghdr* msg, int info_size){
           m.type = proxy_msg::RECEIVER_MSG;
 
           if(hdr->mld_type == MLD_LISTENER_REPORT){
-               m.msg = new struct receiver_msg(receiver_msg::JOIN, packet_info->ipi6_ifindex, g_addr);
+               m.msg = new struct receiver_msg(receiver_msg::JOIN, packet_info->ipi6_ifindex, get_src_addr(msg), g_addr);
           }else if(hdr->mld_type == MLD_LISTENER_REDUCTION){
-               m.msg = new struct receiver_msg(receiver_msg::LEAVE, packet_info->ipi6_ifindex, g_addr);
+               m.msg = new struct receiver_msg(receiver_msg::LEAVE, packet_info->ipi6_ifindex, get_src_addr(msg), g_addr);
           }else{
                HC_LOG_ERROR("wrong mld type");
           }
 
-          pr_i->add_msg(m);
+          send_to_shard(packet_info->ipi6_ifindex, g_addr, m);
+     }else if(hdr->mld_type == MC_MSG_MLDV2_LISTENER_REPORT){
+          struct in6_pktinfo* packet_info = NULL;
+
+          for (struct cmsghdr* cmsgptr = CMSG_FIRSTHDR(msg); cmsgptr != NULL; cmsgptr = CMSG_NXTHDR(msg, cmsgptr)) {
+               if (cmsgptr->cmsg_len > 0 &&cmsgptr->cmsg_level == IPPROTO_IPV6 && cmsgptr->cmsg_type == IPV6_PKTINFO ) {
+                    packet_info = (struct in6_pktinfo*)CMSG_DATA(cmsgptr);
+               }
+          }
+          if(packet_info == NULL) return;
+
+          if((pr_i = this->get_proxy_instance(packet_info->ipi6_ifindex))== NULL) return;
+
+          //the raw socket delivers the ICMPv6 message without the ip header
+          unsigned char* buf = (unsigned char*)msg->msg_iov->iov_base;
+          int pos = 0;
+          if(pos + (int)sizeof(struct mldv2_report_hdr) > info_size){
+               HC_LOG_DEBUG("MLDv2 report to short");
+               return;
+          }
+          struct mldv2_report_hdr* report = (struct mldv2_report_hdr*)buf;
+          int num_of_records = ntohs(report->num_of_mc_records);
+          pos += sizeof(struct mldv2_report_hdr);
+
+          struct receiver_msg* r_msg = new struct receiver_msg(receiver_msg::RECORDS, packet_info->ipi6_ifindex, get_src_addr(msg), addr_storage());
+          for(int i = 0; i < num_of_records; i++){
+               if(pos + (int)sizeof(struct mldv2_mc_record) > info_size){
+                    HC_LOG_DEBUG("MLDv2 report truncated at record: " << i);
+                    break;
+               }
+               struct mldv2_mc_record* rec = (struct mldv2_mc_record*)(buf + pos);
+               int num_of_srcs = ntohs(rec->num_of_srcs);
+               int rec_size = sizeof(struct mldv2_mc_record) + num_of_srcs*sizeof(struct in6_addr) + rec->aux_data_len*4;
+               if(pos + rec_size > info_size){
+                    HC_LOG_DEBUG("MLDv2 report truncated at record: " << i);
+                    break;
+               }
+
+               r_msg->records.push_back(group_record(rec->type, addr_storage(rec->mc_addr)));
+               group_record& g_rec = r_msg->records.back();
+               struct in6_addr* srcs = (struct in6_addr*)(buf + pos + sizeof(struct mldv2_mc_record));
+               for(int j = 0; j < num_of_srcs; j++){
+                    g_rec.src_addrs.push_back(addr_storage(srcs[j]));
+               }
+               HC_LOG_DEBUG("\trecord type: " << g_rec.type << " group: " << g_rec.g_addr << " sources: " << num_of_srcs);
+
+               pos += rec_size;
+          }
+
+          if(r_msg->records.empty()){
+               delete r_msg;
+               return;
+          }
+
+          send_records_to_shards(r_msg);
      }else{
           HC_LOG_DEBUG("unknown MLD-packet: " << (int)(hdr->mld_type));
      }
 }
+
+//called for every MLD message, it does not trace
+addr_storage mld_receiver::get_src_addr(struct msghdr* msg){
+     if(msg->msg_name != NULL && msg->msg_namelen >= sizeof(struct sockaddr_in6)){
+          return addr_storage(*(struct sockaddr*)msg->msg_name);
+     }else{
+          return addr_storage(AF_INET6);
+     }
+}
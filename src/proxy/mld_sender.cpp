@@ -23,12 +23,16 @@
 #include "include/hamcast_logging.h"
 #include "include/proxy/mld_sender.hpp"
 #include "include/utils/mc_timers_values.hpp"
+#include "include/utils/if_cache.hpp"
 
 #include <net/if.h>
 #include <netinet/icmp6.h>
 #include <netinet/ip6.h>
+#include <cstring>
 
-mld_sender::mld_sender(){
+mld_sender::mld_sender():
+     m_query_size(-1)
+{
      HC_LOG_TRACE("");
 
 }
@@ -40,6 +44,7 @@ bool mld_sender::init(int addr_family, int version){
           if(!sender::init(addr_family,version)) return false;
           if(!m_sock.set_default_icmp6_checksum_calc(true)) return false;
           if(!add_hbh_opt_header()) return false;
+          if(!init_templates()) return false;
      }else{
           return false;
      }
@@ -47,32 +52,124 @@ bool mld_sender::init(int addr_family, int version){
      return true;
 }
 
-bool mld_sender::send_general_query(int if_index){
+bool mld_sender::init_templates(){
      HC_LOG_TRACE("");
 
-     int size = get_msg_min_size();
-     if(size <0) return false;
+     memset(&m_gq_dst, 0, sizeof(m_gq_dst));
+     m_gq_dst.sin6_family = AF_INET6;
+     m_gq_dst.sin6_addr <<= addr_storage(IPV6_ALL_NODES_ADDR);
+
+     memset(&m_gsq_dst, 0, sizeof(m_gsq_dst));
+     m_gsq_dst.sin6_family = AF_INET6;
+
+     m_all_routers_dst = m_gsq_dst;
+     m_all_routers_dst.sin6_addr <<= addr_storage(IPV6_ALL_LINK_LOCAL_ROUTER);
 
-     if(!m_sock.choose_if(if_index)) return false;
+     m_mldv2_dst = m_gsq_dst;
+     m_mldv2_dst.sin6_addr <<= addr_storage(IPV6_ALL_MLDv2_CAPABLE_ROUTERS);
+
+     m_query_size = get_msg_min_size();
+     if(m_query_size < 0){ //the sends report the error
+          return true;
+     }
+
+     addr_storage unspecified(m_addr_family); //::
+     if(!create_mc_query(GENERAL_QUERY, (unsigned char*)&m_gq)) return false;
+     if(!create_mc_query(MC_ADDR_SPECIFIC_QUERY, (unsigned char*)&m_gsq, &unspecified)) return false;
+
+     return true;
+}
+
+void mld_sender::fill_gsq(const addr_storage& g_addr, struct mldv2_query* query, struct sockaddr_in6* dst){
+     HC_LOG_TRACE("");
+
+     //the kernel calculates the ICMPv6 checksum
+     *query = m_gsq;
+     query->mc_addr <<= g_addr;
+
+     *dst = m_gsq_dst;
+     dst->sin6_addr = query->mc_addr;
+}
+
+bool mld_sender::send_general_query(int if_index){
+     HC_LOG_TRACE("");
 
-     unsigned char buf[size];
-     if(!create_mc_query(GENERAL_QUERY, buf)) return false;
+     if(m_query_size < 0){
+          HC_LOG_ERROR("IPv6 version: " << m_version << " not supported");
+          return false;
+     }
 
-     return m_sock.send_packet(IPV6_ALL_NODES_ADDR,0,buf,sizeof(buf));
+     struct mroute_socket_packet p = {if_index, (struct sockaddr*)&m_gq_dst, sizeof(m_gq_dst), (unsigned char*)&m_gq, (unsigned int)m_query_size, NULL};
+     return m_sock.send_packets(&p, 1);
 }
 
 bool mld_sender::send_group_specific_query(int if_index, const addr_storage& g_addr){
      HC_LOG_TRACE("");
 
-     int size = get_msg_min_size();
-     if(size <0) return false;
+     if(m_query_size < 0){
+          HC_LOG_ERROR("IPv6 version: " << m_version << " not supported");
+          return false;
+     }
 
-     if(!m_sock.choose_if(if_index)) return false;
+     struct mldv2_query query;
+     struct sockaddr_in6 dst;
+     fill_gsq(g_addr, &query, &dst);
 
-     unsigned char buf[size];
-     if(!create_mc_query(MC_ADDR_SPECIFIC_QUERY, buf, &g_addr)) return false;
+     struct mroute_socket_packet p = {if_index, (struct sockaddr*)&dst, sizeof(dst), (unsigned char*)&query, (unsigned int)m_query_size, NULL};
+     return m_sock.send_packets(&p, 1);
+}
 
-     return m_sock.send_packet(g_addr.to_string().c_str(),0,buf,sizeof(buf));
+bool mld_sender::send_general_queries(const std::vector<int>& if_indexes){
+     HC_LOG_TRACE("");
+
+     if(m_query_size < 0){
+          HC_LOG_ERROR("IPv6 version: " << m_version << " not supported");
+          return false;
+     }
+
+     if(if_indexes.empty()) return true;
+
+     //all queries share the packet and the destination, only the egress interface differs
+     m_packets.resize(if_indexes.size());
+     for(unsigned int i = 0; i < if_indexes.size(); i++){
+          struct mroute_socket_packet& p = m_packets[i];
+          p.if_index = if_indexes[i];
+          p.dst = (struct sockaddr*)&m_gq_dst;
+          p.dst_len = sizeof(m_gq_dst);
+          p.data = (unsigned char*)&m_gq;
+          p.data_size = m_query_size;
+          p.src = NULL;
+     }
+
+     return m_sock.send_packets(&m_packets[0], m_packets.size());
+}
+
+bool mld_sender::send_group_specific_queries(const gsq_vector& queries){
+     HC_LOG_TRACE("");
+
+     if(m_query_size < 0){
+          HC_LOG_ERROR("IPv6 version: " << m_version << " not supported");
+          return false;
+     }
+
+     if(queries.empty()) return true;
+
+     m_packets.resize(queries.size());
+     m_gsq_buf.resize(queries.size());
+     m_gsq_dst_buf.resize(queries.size());
+     for(unsigned int i = 0; i < queries.size(); i++){
+          fill_gsq(queries[i].second, &m_gsq_buf[i], &m_gsq_dst_buf[i]);
+
+          struct mroute_socket_packet& p = m_packets[i];
+          p.if_index = queries[i].first;
+          p.dst = (struct sockaddr*)&m_gsq_dst_buf[i];
+          p.dst_len = sizeof(struct sockaddr_in6);
+          p.data = (unsigned char*)&m_gsq_buf[i];
+          p.data_size = m_query_size;
+          p.src = NULL;
+     }
+
+     return m_sock.send_packets(&m_packets[0], m_packets.size());
 }
 
 int mld_sender::get_msg_min_size(){
@@ -80,51 +177,153 @@ int mld_sender::get_msg_min_size(){
 
      if(m_version == 1){
           return sizeof(struct mld_hdr);
+     }else if(m_version == 2){
+          return MC_MSG_MLDV2_QUERY_MIN_SIZE;
      }else{
           HC_LOG_ERROR("IPv6 version: " << m_version << " not supported");
           return -1;
      }
 }
 
-bool mld_sender::send_report(int if_index, const addr_storage& g_addr){
+bool mld_sender::get_link_local_addr(int if_index, struct in6_addr* addr){
      HC_LOG_TRACE("");
 
-     return m_sock.join_group(g_addr.to_string().c_str(),if_index);
+     if_cache_snapshot snapshot = if_cache::getInstance()->get_snapshot();
+     const struct if_cache_entry* entry = if_cache::find(snapshot, if_index);
+     if(entry != NULL){
+          for(unsigned int i = 0; i < entry->ipv6.size(); i++){
+               struct in6_addr tmp;
+               tmp <<= entry->ipv6[i].addr;
+               if(IN6_IS_ADDR_LINKLOCAL(&tmp)){
+                    *addr = tmp;
+                    return true;
+               }
+          }
+     }
+
+     HC_LOG_WARN("no link-local address found on if_index: " << if_index);
+     return false;
 }
 
-bool mld_sender::send_leave(int if_index, const addr_storage& g_addr){
+bool mld_sender::send_raw_reports(int if_index, const std::vector<addr_storage>& g_addrs, report_type type){
      HC_LOG_TRACE("");
 
-     return m_sock.leave_group(g_addr.to_string().c_str(),if_index);
+     if(g_addrs.empty()) return true;
+
+     struct in6_addr src;
+     const void* p_src = get_link_local_addr(if_index, &src)? &src : NULL;
+
+     if(m_version == 1){
+          //one report per group, the kernel calculates the ICMPv6 checksum
+          m_report_buf.resize(g_addrs.size() * sizeof(struct mld_hdr));
+          m_report_dst_buf.resize(g_addrs.size());
+          m_packets.resize(g_addrs.size());
+          for(unsigned int i = 0; i < g_addrs.size(); i++){
+               struct mld_hdr* report = (struct mld_hdr*)&m_report_buf[i * sizeof(struct mld_hdr)];
+               memset(report, 0, sizeof(struct mld_hdr));
+               report->mld_type = (type == LEAVE_REPORT)? MLD_LISTENER_REDUCTION : MLD_LISTENER_REPORT;
+               report->mld_addr <<= g_addrs[i];
+
+               if(type == LEAVE_REPORT){
+                    m_report_dst_buf[i] = m_all_routers_dst;
+               }else{
+                    m_report_dst_buf[i] = m_gsq_dst;
+                    m_report_dst_buf[i].sin6_addr = report->mld_addr;
+               }
+
+               struct mroute_socket_packet& p = m_packets[i];
+               p.if_index = if_index;
+               p.dst = (struct sockaddr*)&m_report_dst_buf[i];
+               p.dst_len = sizeof(struct sockaddr_in6);
+               p.data = (unsigned char*)report;
+               p.data_size = sizeof(struct mld_hdr);
+               p.src = p_src;
+          }
+     }else if(m_version == 2){
+          u_int8_t record_type;
+          if(type == JOIN_REPORT){
+               record_type = MC_MSG_CHANGE_TO_EXCLUDE_MODE;
+          }else if(type == LEAVE_REPORT){
+               record_type = MC_MSG_CHANGE_TO_INCLUDE_MODE;
+          }else{
+               record_type = MC_MSG_MODE_IS_EXCLUDE;
+          }
+
+          //40 bytes ip header and 8 bytes hop-by-hop option header
+          const unsigned int max_records = (SENDER_MTU - 48 - sizeof(struct mldv2_report_hdr)) / sizeof(struct mldv2_mc_record);
+          const unsigned int packet_count = (g_addrs.size() + max_records - 1) / max_records;
+          const unsigned int packet_size = sizeof(struct mldv2_report_hdr) + max_records * sizeof(struct mldv2_mc_record);
+
+          m_report_buf.resize(packet_count * packet_size);
+          m_packets.resize(packet_count);
+          for(unsigned int i = 0; i < packet_count; i++){
+               unsigned int first = i * max_records;
+               unsigned int records = (g_addrs.size() - first < max_records)? g_addrs.size() - first : max_records;
+
+               unsigned char* buf = &m_report_buf[i * packet_size];
+               struct mldv2_report_hdr* hdr = (struct mldv2_report_hdr*)buf;
+               hdr->type = MC_MSG_MLDV2_LISTENER_REPORT;
+               hdr->reserved1 = 0;
+               hdr->checksum = MC_MASSAGES_AUTO_FILL;
+               hdr->reserved2 = 0;
+               hdr->num_of_mc_records = htons(records);
+
+               struct mldv2_mc_record* record = (struct mldv2_mc_record*)(hdr + 1);
+               for(unsigned int j = 0; j < records; j++){
+                    record[j].type = record_type;
+                    record[j].aux_data_len = 0;
+                    record[j].num_of_srcs = 0;
+                    record[j].mc_addr <<= g_addrs[first + j];
+               }
+
+               struct mroute_socket_packet& p = m_packets[i];
+               p.if_index = if_index;
+               p.dst = (struct sockaddr*)&m_mldv2_dst;
+               p.dst_len = sizeof(m_mldv2_dst);
+               p.data = buf;
+               p.data_size = sizeof(struct mldv2_report_hdr) + records * sizeof(struct mldv2_mc_record);
+               p.src = p_src;
+          }
+     }else{
+          HC_LOG_ERROR("IPv6 version: " << m_version << " not supported");
+          return false;
+     }
+
+     return m_sock.send_packets(&m_packets[0], m_packets.size());
 }
 
 bool mld_sender::create_mc_query(msg_type type, unsigned char* buf, const addr_storage* g_addr){
      HC_LOG_TRACE("");
 
-     if(m_version == 1){
-          struct mld_hdr* mld_Hdr = (struct mld_hdr*)buf;
+     if(m_version == 1 || m_version == 2){
+          struct mldv2_query* mld_Hdr = (struct mldv2_query*)buf;
+          memset(mld_Hdr, 0, sizeof(struct mldv2_query));
 
-          mld_Hdr->mld_type = MLD_LISTENER_QUERY;
-          mld_Hdr->mld_code = 0;
-          mld_Hdr->mld_cksum = MC_MASSAGES_AUTO_FILL;
-          mld_Hdr->mld_reserved = 0;
+          mld_Hdr->type = MLD_LISTENER_QUERY;
+          mld_Hdr->checksum = MC_MASSAGES_AUTO_FILL;
 
           if(type==GENERAL_QUERY){
-               mld_Hdr->mld_maxdelay = htons(MC_TV_QUERY_RESPONSE_INTERVAL * MC_TV_MAX_RESPONSE_DELAY_UNIT);
-               mld_Hdr->mld_addr <<= addr_storage(m_addr_family); //0.0.0.0
+               mld_Hdr->max_resp_code = htons(MC_TV_QUERY_RESPONSE_INTERVAL * MC_TV_MAX_RESPONSE_DELAY_UNIT);
+               mld_Hdr->mc_addr <<= addr_storage(m_addr_family); //::
           }else if(type== MC_ADDR_SPECIFIC_QUERY){
                if(!g_addr){
                     HC_LOG_ERROR("g_addr is NULL");
                     return false;
                }
 
-               mld_Hdr->mld_maxdelay = htons(MC_TV_LAST_LISTENER_QUERY_INTERVAL * MC_TV_MAX_RESPONSE_DELAY_UNIT);
-               mld_Hdr->mld_addr <<= *g_addr;
+               mld_Hdr->max_resp_code = htons(MC_TV_LAST_LISTENER_QUERY_INTERVAL * MC_TV_MAX_RESPONSE_DELAY_UNIT);
+               mld_Hdr->mc_addr <<= *g_addr;
           }else{
                HC_LOG_ERROR("wrong type: " << type);
                return false;
           }
 
+          //the used times are below 32768 and 128 and need no floating point code
+          if(m_version == 2){
+               mld_Hdr->s_qrv = MC_TV_ROBUSTNESS_VARIABLE;
+               mld_Hdr->qqic = MC_TV_QUERY_INTERVAL;
+          }
+
           return true;
      }else{
           HC_LOG_ERROR("wrong verson: "<< m_version);
@@ -23,19 +23,28 @@
 #include "include/hamcast_logging.h"
 #include "include/proxy/proxy.hpp"
 #include "include/proxy/routing.hpp"
+#include "include/proxy/sender_service.hpp"
 #include "include/proxy/igmp_receiver.hpp"
 #include "include/proxy/mld_receiver.hpp"
 #include "include/proxy/timing.hpp"
 #include "include/proxy/check_if.hpp"
+#include "include/proxy/thread_prop.hpp"
 
 #include <linux/mroute.h>
 #include <linux/mroute6.h>
 #include <sstream>
+#include <ctime>
+#include <cstdlib>
 #include <net/if.h>
+#include <arpa/inet.h>
 #include <fstream>
 #include <string>
 #include <iostream>
 #include <signal.h>
+#include <sys/epoll.h>
+#include <sys/time.h>
+#include <errno.h>
+#include <string.h>
 
 #include <unistd.h>
 
@@ -44,7 +53,7 @@ using namespace std;
 bool proxy::m_running= false;
 
 proxy::proxy():
-     m_verbose_lvl(0),m_print_status(false), m_rest_rp_filter(false), m_config_path(PROXY_DEFAULT_CONIG_PATH) ,m_addr_family(AF_INET), m_version(1)
+     m_verbose_lvl(0),m_print_status(false), m_rest_rp_filter(false), m_batch_routes(false), m_raw_membership(false), m_report_window(SENDER_SERVICE_DEFAULT_REPORT_WINDOW), m_gq_jitter(PROXY_INSTANCE_DEFAULT_GQ_JITTER), m_remember_sources(false), m_single_thread(false), m_pool_threads(-1), m_worker_pool(NULL), m_lock_memory(false), m_config_path(PROXY_DEFAULT_CONIG_PATH) ,m_addr_family(AF_INET), m_version(1)
 {
      HC_LOG_TRACE("");
 
@@ -84,6 +93,7 @@ bool proxy::load_config(string path){
                int tmp_upstream_if=-1;
                int tmp_downstream_if=-1;
                down_vector tmp_down_vector;
+               vector<int> tmp_up_vector;
 
                state =0;
                if(!strline.eof()){
@@ -129,6 +139,160 @@ bool proxy::load_config(string path){
                                              return false;
                                         }
                                    }
+                              }else if(comp_str.compare("static") == 0 && state==0) {
+                                   //the first argument is an upstream or a downstream, the rest of the line are groups or prefixes
+                                   int tmp_if = -1;
+                                   while(!strline.eof()){
+                                        strline >> comp_str;
+                                        if(comp_str.empty() || comp_str.at(0) == '#') break;
+
+                                        if(tmp_if < 0){
+                                             tmp_if = if_nametoindex(comp_str.c_str());
+                                             if(tmp_if <= 0){
+                                                  HC_LOG_ERROR("static group interface not found: " << comp_str << " <line " << linecount << ">");
+                                                  return false;
+                                             }
+                                        }else if(!parse_static_groups(comp_str, m_static_groups[tmp_if])){
+                                             HC_LOG_ERROR("wrong static group: " << comp_str << " <line " << linecount << ">");
+                                             return false;
+                                        }
+                                   }
+                                   if(tmp_if < 0 || m_static_groups[tmp_if].empty()){
+                                        HC_LOG_ERROR("no static group defined" << " <line " << linecount << ">");
+                                        return false;
+                                   }
+                                   break;
+                              }else if(comp_str.compare("upstream") == 0 && state==0) {
+                                   //the first argument is an upstream, the rest of the line are its group ranges
+                                   int tmp_if = -1;
+                                   while(!strline.eof()){
+                                        strline >> comp_str;
+                                        if(comp_str.empty() || comp_str.at(0) == '#') break;
+
+                                        group_prefix tmp_prefix;
+                                        if(tmp_if < 0){
+                                             tmp_if = if_nametoindex(comp_str.c_str());
+                                             if(tmp_if <= 0){
+                                                  HC_LOG_ERROR("upstream interface not found: " << comp_str << " <line " << linecount << ">");
+                                                  return false;
+                                             }
+                                        }else if(parse_group_prefix(comp_str, tmp_prefix)){
+                                             m_upstream_prefixes[tmp_if].push_back(tmp_prefix);
+                                        }else{
+                                             HC_LOG_ERROR("wrong group range: " << comp_str << " <line " << linecount << ">");
+                                             return false;
+                                        }
+                                   }
+                                   if(tmp_if < 0 || m_upstream_prefixes[tmp_if].empty()){
+                                        HC_LOG_ERROR("no group range defined" << " <line " << linecount << ">");
+                                        return false;
+                                   }
+                                   break;
+                              }else if(comp_str.compare("backup") == 0 && state==0) {
+                                   //the rest of the line are upstreams used on a failure of the others
+                                   bool found = false;
+                                   while(!strline.eof()){
+                                        strline >> comp_str;
+                                        if(comp_str.empty() || comp_str.at(0) == '#') break;
+
+                                        int tmp_if = if_nametoindex(comp_str.c_str());
+                                        if(tmp_if > 0){
+                                             m_backup_upstreams.insert(tmp_if);
+                                             found = true;
+                                        }else{
+                                             HC_LOG_ERROR("backup interface not found: " << comp_str << " <line " << linecount << ">");
+                                             return false;
+                                        }
+                                   }
+                                   if(!found){
+                                        HC_LOG_ERROR("no backup interface defined" << " <line " << linecount << ">");
+                                        return false;
+                                   }
+                                   break;
+                              }else if(comp_str.compare("shards") == 0 && state==0) {
+                                   //the first upstream of an instance and the number of its shards
+                                   string if_str;
+                                   int tmp_count = 0;
+                                   strline >> if_str >> tmp_count;
+
+                                   int tmp_if = if_nametoindex(if_str.c_str());
+                                   if(tmp_if <= 0){
+                                        HC_LOG_ERROR("shards interface not found: " << if_str << " <line " << linecount << ">");
+                                        return false;
+                                   }
+                                   if(tmp_count < 1 || tmp_count > PROXY_MAX_SHARDS){
+                                        HC_LOG_ERROR("number of shards must be between 1 and " << PROXY_MAX_SHARDS << " <line " << linecount << ">");
+                                        return false;
+                                   }
+                                   m_shards[tmp_if] = tmp_count;
+                                   break;
+                              }else if(comp_str.compare("cpu") == 0 && state==0) {
+                                   //the role of the threads and there CPUs
+                                   string role_str;
+                                   string cpu_str;
+                                   strline >> role_str >> cpu_str;
+
+                                   thread_prop::role tmp_role;
+                                   if(!thread_prop::parse_role(role_str, tmp_role)){
+                                        HC_LOG_ERROR("unknown thread role: " << role_str << " <line " << linecount << ">");
+                                        return false;
+                                   }
+                                   vector<int> tmp_cpus;
+                                   if(!parse_cpu_list(cpu_str, tmp_cpus) || !thread_prop::set_cpus(tmp_role, tmp_cpus)){
+                                        HC_LOG_ERROR("wrong CPU list: " << cpu_str << " <line " << linecount << ">");
+                                        return false;
+                                   }
+                                   break;
+                              }else if(comp_str.compare("priority") == 0 && state==0) {
+                                   //the role of the threads, there real-time policy and priority
+                                   string role_str;
+                                   string policy_str;
+                                   int tmp_priority = -1;
+                                   strline >> role_str >> policy_str >> tmp_priority;
+
+                                   thread_prop::role tmp_role;
+                                   if(!thread_prop::parse_role(role_str, tmp_role)){
+                                        HC_LOG_ERROR("unknown thread role: " << role_str << " <line " << linecount << ">");
+                                        return false;
+                                   }
+                                   int tmp_policy;
+                                   if(policy_str.compare("fifo") == 0){
+                                        tmp_policy = SCHED_FIFO;
+                                   }else if(policy_str.compare("rr") == 0){
+                                        tmp_policy = SCHED_RR;
+                                   }else{
+                                        HC_LOG_ERROR("unknown scheduling policy: " << policy_str << " <line " << linecount << ">");
+                                        return false;
+                                   }
+                                   if(!thread_prop::set_priority(tmp_role, tmp_policy, tmp_priority)){
+                                        HC_LOG_ERROR("wrong priority: " << tmp_priority << " <line " << linecount << ">");
+                                        return false;
+                                   }
+                                   break;
+                              }else if(comp_str.compare("mlockall") == 0 && state==0) {
+                                   m_lock_memory = true;
+                                   break;
+                              }else if(comp_str.compare("fastleave") == 0 && state==0) {
+                                   //the rest of the line are downstreams in fast leave mode
+                                   bool found = false;
+                                   while(!strline.eof()){
+                                        strline >> comp_str;
+                                        if(comp_str.empty() || comp_str.at(0) == '#') break;
+
+                                        int tmp_if = if_nametoindex(comp_str.c_str());
+                                        if(tmp_if > 0){
+                                             m_fast_leave.insert(tmp_if);
+                                             found = true;
+                                        }else{
+                                             HC_LOG_ERROR("fast leave interface not found: " << comp_str << " <line " << linecount << ">");
+                                             return false;
+                                        }
+                                   }
+                                   if(!found){
+                                        HC_LOG_ERROR("no fast leave interface defined" << " <line " << linecount << ">");
+                                        return false;
+                                   }
+                                   break;
                               }else if(state==0){
                                    tmp_upstream_if=if_nametoindex(comp_str.c_str());
 
@@ -142,6 +306,9 @@ bool proxy::load_config(string path){
                               }else if(state==1){
                                    if(comp_str.compare("==>") == 0){
                                         state = 2;
+                                   }else if((tmp_downstream_if = if_nametoindex(comp_str.c_str())) > 0){
+                                        //further upstreams share the groups of the instance
+                                        tmp_up_vector.push_back(tmp_downstream_if);
                                    }else{
                                         HC_LOG_ERROR("syntax error: " << comp_str << " expected: " << " ==>" << " <line " << linecount << ">");
                                         return false;
@@ -170,6 +337,9 @@ bool proxy::load_config(string path){
 
                if(state == 3){
                     m_up_down_map.insert(up_down_pair(tmp_upstream_if,tmp_down_vector));
+                    if(!tmp_up_vector.empty()){
+                         m_more_upstreams[tmp_upstream_if] = tmp_up_vector;
+                    }
                }else if (state == 2){
                     HC_LOG_ERROR("line incomplete: " << cstr << " in line " << linecount << ">");
                     return false;
@@ -178,10 +348,228 @@ bool proxy::load_config(string path){
           }
      }
 
+     //fast leave is a property of downstreams
+     set<int>::iterator it_fast_leave;
+     for(it_fast_leave = m_fast_leave.begin(); it_fast_leave != m_fast_leave.end(); it_fast_leave++){
+          bool is_downstream = false;
+          up_down_map::iterator it_up_down;
+          for(it_up_down = m_up_down_map.begin(); it_up_down != m_up_down_map.end(); it_up_down++){
+               for(unsigned int i=0; i < it_up_down->second.size(); i++){
+                    if(it_up_down->second[i] == *it_fast_leave) is_downstream = true;
+               }
+          }
+          if(!is_downstream){
+               HC_LOG_ERROR("fast leave interface is no downstream: " << *it_fast_leave);
+               return false;
+          }
+     }
+
+     //static groups belong to an upstream or a downstream and to the configured protocol
+     map<int, vector<addr_storage> >::iterator it_static;
+     for(it_static = m_static_groups.begin(); it_static != m_static_groups.end(); it_static++){
+          bool is_used = false;
+          up_down_map::iterator it_up_down;
+          for(it_up_down = m_up_down_map.begin(); it_up_down != m_up_down_map.end(); it_up_down++){
+               if(it_up_down->first == it_static->first) is_used = true;
+               vector<int>& tmp_up_vector = m_more_upstreams[it_up_down->first];
+               for(unsigned int i=0; i < tmp_up_vector.size(); i++){
+                    if(tmp_up_vector[i] == it_static->first) is_used = true;
+               }
+               for(unsigned int i=0; i < it_up_down->second.size(); i++){
+                    if(it_up_down->second[i] == it_static->first) is_used = true;
+               }
+          }
+          if(!is_used){
+               HC_LOG_ERROR("static group interface is no upstream or downstream: " << it_static->first);
+               return false;
+          }
+
+          for(unsigned int i=0; i < it_static->second.size(); i++){
+               if(it_static->second[i].get_addr_family() != m_addr_family){
+                    HC_LOG_ERROR("static group does not match the protocol: " << it_static->second[i]);
+                    return false;
+               }
+          }
+     }
+
+     //group ranges belong to an upstream and to the configured protocol
+     set<int> tmp_upstreams = get_shared_upstreams();
+     map<int, vector<group_prefix> >::iterator it_prefixes;
+     for(it_prefixes = m_upstream_prefixes.begin(); it_prefixes != m_upstream_prefixes.end(); it_prefixes++){
+          if(m_up_down_map.find(it_prefixes->first) == m_up_down_map.end() && tmp_upstreams.find(it_prefixes->first) == tmp_upstreams.end()){
+               HC_LOG_ERROR("group range interface is no upstream: " << it_prefixes->first);
+               return false;
+          }
+
+          for(unsigned int i=0; i < it_prefixes->second.size(); i++){
+               if(it_prefixes->second[i].first.get_addr_family() != m_addr_family){
+                    HC_LOG_ERROR("group range does not match the protocol: " << it_prefixes->second[i].first << "/" << it_prefixes->second[i].second);
+                    return false;
+               }
+          }
+     }
+
+     //shards split an instance, they are named by its first upstream
+     map<int, int>::iterator it_shards;
+     for(it_shards = m_shards.begin(); it_shards != m_shards.end(); it_shards++){
+          if(m_up_down_map.find(it_shards->first) == m_up_down_map.end()){
+               HC_LOG_ERROR("shards interface is no first upstream of an instance: " << it_shards->first);
+               return false;
+          }
+     }
+
+     //a backup is a further upstream of an instance, one upstream of the instance is no backup
+     set<int>::iterator it_backup;
+     for(it_backup = m_backup_upstreams.begin(); it_backup != m_backup_upstreams.end(); it_backup++){
+          if(tmp_upstreams.find(*it_backup) == tmp_upstreams.end()){
+               HC_LOG_ERROR("backup interface is no upstream of an instance with more upstreams: " << *it_backup);
+               return false;
+          }
+     }
+     map<int, vector<int> >::iterator it_more_upstreams;
+     for(it_more_upstreams = m_more_upstreams.begin(); it_more_upstreams != m_more_upstreams.end(); it_more_upstreams++){
+          bool all_backup = (m_backup_upstreams.find(it_more_upstreams->first) != m_backup_upstreams.end());
+          for(unsigned int i=0; i < it_more_upstreams->second.size(); i++){
+               if(m_backup_upstreams.find(it_more_upstreams->second[i]) == m_backup_upstreams.end()) all_backup = false;
+          }
+          if(all_backup){
+               HC_LOG_ERROR("all upstreams of an instance are backups: " << it_more_upstreams->first);
+               return false;
+          }
+     }
+
      HC_LOG_DEBUG("m_addr_family: " << m_addr_family << ";  m_version: " << m_version << "; ");
      return true;
 }
 
+bool proxy::parse_static_groups(const string& str, vector<addr_storage>& g_addrs){
+     HC_LOG_TRACE("str: " << str);
+
+     string addr_str = str;
+     int prefix_len = -1;
+     string::size_type pos = str.find('/');
+     if(pos != string::npos){
+          addr_str = str.substr(0, pos);
+          prefix_len = atoi(str.substr(pos + 1).c_str());
+     }
+
+     int addr_family = (addr_str.find(':') == string::npos)? AF_INET : AF_INET6;
+     unsigned char addr[sizeof(struct in6_addr)];
+     int addr_len = (addr_family == AF_INET)? sizeof(struct in_addr) : sizeof(struct in6_addr);
+     if(inet_pton(addr_family, addr_str.c_str(), addr) < 1){
+          return false;
+     }
+
+     //only the last 32 bits of a prefix are counted
+     int host_bits = (prefix_len < 0)? 0 : addr_len*8 - prefix_len;
+     if(host_bits < 0 || host_bits >= 32 || (1U << host_bits) > PROXY_MAX_STATIC_PREFIX_GROUPS){
+          HC_LOG_ERROR("static prefix to large, at most " << PROXY_MAX_STATIC_PREFIX_GROUPS << " groups: " << str);
+          return false;
+     }
+
+     unsigned int base = (addr[addr_len-4] << 24) | (addr[addr_len-3] << 16) | (addr[addr_len-2] << 8) | addr[addr_len-1];
+     base &= ~((1U << host_bits) - 1);
+     for(unsigned int i = 0; i < (1U << host_bits); i++){
+          unsigned int tmp = base | i;
+          addr[addr_len-4] = tmp >> 24;
+          addr[addr_len-3] = tmp >> 16;
+          addr[addr_len-2] = tmp >> 8;
+          addr[addr_len-1] = tmp;
+
+          addr_storage g_addr;
+          if(addr_family == AF_INET){
+               struct in_addr* tmp_addr = (struct in_addr*)addr;
+               if(!IN_MULTICAST(ntohl(tmp_addr->s_addr))) return false;
+               g_addr = *tmp_addr;
+          }else{
+               struct in6_addr* tmp_addr = (struct in6_addr*)addr;
+               if(!IN6_IS_ADDR_MULTICAST(tmp_addr)) return false;
+               g_addr = *tmp_addr;
+          }
+          g_addrs.push_back(g_addr);
+     }
+
+     return true;
+}
+
+bool proxy::parse_cpu_list(const string& str, vector<int>& cpus){
+     HC_LOG_TRACE("");
+
+     stringstream strlist(str);
+     string item;
+     while(getline(strlist, item, ',')){
+          int first = -1;
+          int last = -1;
+          size_t pos = item.find('-');
+          if(pos == string::npos){
+               first = last = atoi(item.c_str());
+          }else{
+               first = atoi(item.substr(0, pos).c_str());
+               last = atoi(item.substr(pos + 1).c_str());
+          }
+
+          if(item.empty() || item.find_first_not_of("0123456789-") != string::npos || first < 0 || last < first || last >= CPU_SETSIZE){
+               HC_LOG_ERROR("wrong CPU: " << item);
+               return false;
+          }
+          for(int i = first; i <= last; i++){
+               cpus.push_back(i);
+          }
+     }
+
+     return !cpus.empty();
+}
+
+bool proxy::parse_group_prefix(const string& str, group_prefix& prefix){
+     HC_LOG_TRACE("str: " << str);
+
+     string addr_str = str;
+     int prefix_len = -1;
+     string::size_type pos = str.find('/');
+     if(pos != string::npos){
+          addr_str = str.substr(0, pos);
+          prefix_len = atoi(str.substr(pos + 1).c_str());
+     }
+
+     int addr_family = (addr_str.find(':') == string::npos)? AF_INET : AF_INET6;
+     unsigned char addr[sizeof(struct in6_addr)];
+     int addr_len = (addr_family == AF_INET)? sizeof(struct in_addr) : sizeof(struct in6_addr);
+     if(inet_pton(addr_family, addr_str.c_str(), addr) < 1){
+          return false;
+     }
+
+     if(prefix_len < 0){
+          prefix_len = addr_len*8;
+     }else if(prefix_len > addr_len*8){
+          return false;
+     }
+
+     if(addr_family == AF_INET){
+          struct in_addr* tmp_addr = (struct in_addr*)addr;
+          if(!IN_MULTICAST(ntohl(tmp_addr->s_addr))) return false;
+          prefix.first = *tmp_addr;
+     }else{
+          struct in6_addr* tmp_addr = (struct in6_addr*)addr;
+          if(!IN6_IS_ADDR_MULTICAST(tmp_addr)) return false;
+          prefix.first = *tmp_addr;
+     }
+     prefix.second = prefix_len;
+
+     return true;
+}
+
+set<int> proxy::get_shared_upstreams(){
+     HC_LOG_TRACE("");
+
+     set<int> upstreams;
+     map<int, vector<int> >::iterator it_more_upstreams;
+     for(it_more_upstreams = m_more_upstreams.begin(); it_more_upstreams != m_more_upstreams.end(); it_more_upstreams++){
+          upstreams.insert(it_more_upstreams->first);
+          upstreams.insert(it_more_upstreams->second.begin(), it_more_upstreams->second.end());
+     }
+     return upstreams;
+}
+
 vector<int> proxy::all_if_to_list(){
      HC_LOG_TRACE("");
 
@@ -192,6 +580,11 @@ vector<int> proxy::all_if_to_list(){
      for ( it_up_down=m_up_down_map.begin() ; it_up_down != m_up_down_map.end(); it_up_down++ ){
           interface_list.push_back(it_up_down->first);
 
+          map<int, vector<int> >::iterator it_more_upstreams = m_more_upstreams.find(it_up_down->first);
+          if(it_more_upstreams != m_more_upstreams.end()){
+               interface_list.insert(interface_list.end(), it_more_upstreams->second.begin(), it_more_upstreams->second.end());
+          }
+
           down_vector tmp_down_vector =it_up_down->second;
           for(unsigned int i=0; i< tmp_down_vector.size();i++){
                interface_list.push_back(tmp_down_vector[i]);
@@ -291,7 +684,7 @@ string proxy::get_state_table(){
 
      up_down_map::iterator it_up_down;
      stringstream str;
-     char cstr[IF_NAMESIZE];
+     if_cache* cache = if_cache::getInstance();
 
      str << "protocol: " << endl;
 
@@ -320,13 +713,48 @@ string proxy::get_state_table(){
      }
 
      for ( it_up_down=m_up_down_map.begin() ; it_up_down != m_up_down_map.end(); it_up_down++ ){
-          str << if_indextoname(it_up_down->first, cstr) << " ==>" << endl;
+          str << cache->get_name(it_up_down->first) << (m_backup_upstreams.find(it_up_down->first) == m_backup_upstreams.end()? "" : " [backup]");
+          map<int, vector<int> >::iterator it_more_upstreams = m_more_upstreams.find(it_up_down->first);
+          if(it_more_upstreams != m_more_upstreams.end()){
+               for(unsigned int i=0; i< it_more_upstreams->second.size();i++){
+                    str << " " << cache->get_name(it_more_upstreams->second[i]) << (m_backup_upstreams.find(it_more_upstreams->second[i]) == m_backup_upstreams.end()? "" : " [backup]");
+               }
+          }
+          str << " ==>" << (m_static_groups.find(it_up_down->first) == m_static_groups.end()? "" : " [static groups]");
+          map<int, int>::iterator it_shards = m_shards.find(it_up_down->first);
+          if(it_shards != m_shards.end() && it_shards->second > 1){
+               str << " [" << it_shards->second << " shards]";
+          }
+          str << endl;
+
+          //the group ranges of the upstreams
+          set<int> tmp_upstreams;
+          tmp_upstreams.insert(it_up_down->first);
+          if(it_more_upstreams != m_more_upstreams.end()){
+               tmp_upstreams.insert(it_more_upstreams->second.begin(), it_more_upstreams->second.end());
+          }
+          for(set<int>::iterator it_up = tmp_upstreams.begin(); it_up != tmp_upstreams.end(); it_up++){
+               map<int, vector<group_prefix> >::iterator it_prefixes = m_upstream_prefixes.find(*it_up);
+               if(it_prefixes == m_upstream_prefixes.end()) continue;
+
+               str << "\tupstream " << cache->get_name(*it_up) << ":";
+               for(unsigned int i=0; i< it_prefixes->second.size();i++){
+                    str << " " << it_prefixes->second[i].first << "/" << it_prefixes->second[i].second;
+               }
+               str << endl;
+          }
 
           down_vector tmp_down_vector =it_up_down->second;
           for(unsigned int i=0; i< tmp_down_vector.size();i++){
-               str << "\t" << if_indextoname(tmp_down_vector[i], cstr)  << endl;
+               str << "\t" << cache->get_name(tmp_down_vector[i]) << (m_fast_leave.find(tmp_down_vector[i]) == m_fast_leave.end()? "" : " [fast-leave]") << (m_static_groups.find(tmp_down_vector[i]) == m_static_groups.end()? "" : " [static groups]") << endl;
           }
      }
+
+     string thread_str = thread_prop::to_string();
+     if(!thread_str.empty() || m_lock_memory){
+          str << "threads:" << (m_lock_memory? " [mlockall]" : "") << endl;
+          str << thread_str;
+     }
      return str.str();
 }
 
@@ -345,6 +773,13 @@ bool proxy::init(int arg_count, char* args[]){
 
      if(!load_config(m_config_path)) return false;
 
+     //before the first thread starts, the threads get the settings of there role
+     if(m_lock_memory && !thread_prop::lock_memory()) return false;
+     thread_prop::apply(thread_prop::MAIN, "mcproxy");
+
+     //random delays of the generated Membership Reports
+     srand(time(NULL) ^ getpid());
+
      if(!check_double_used_if(NULL)){
           HC_LOG_ERROR("double interfaces found");
           return false;
@@ -359,6 +794,18 @@ bool proxy::init(int arg_count, char* args[]){
 
      if(!init_mrt_socket()) return false;
 
+     //has to be set before the first worker starts
+     worker::set_single_thread(m_single_thread);
+     if(m_pool_threads >= 0){
+          if(m_single_thread){
+               HC_LOG_ERROR("the single threaded mode needs no worker pool");
+               cout << "the options -e and -p exclude each other" << endl;
+               return false;
+          }
+          m_worker_pool = new worker_pool(m_pool_threads);
+          m_worker_pool->start();
+     }
+
      //start receiver
      if(m_addr_family == AF_INET){
           m_receiver = new igmp_receiver();
@@ -371,9 +818,14 @@ bool proxy::init(int arg_count, char* args[]){
      m_receiver->init(m_addr_family,m_version, &m_mrt_sock);
      m_receiver->start();
 
+     //start sender
+     sender_service* s=sender_service::getInstance();
+     if(!s->init(m_addr_family,m_version,m_report_window)) return false;
+     s->start();
+
      //start routing
      routing* r=routing::getInstance();
-     r->init(m_addr_family,m_version,&m_mrt_sock);
+     r->init(m_addr_family,m_version,&m_mrt_sock,m_batch_routes);
      r->start();
 
      //start timing
@@ -387,7 +839,7 @@ bool proxy::init(int arg_count, char* args[]){
 
 void proxy::help_output(){
      HC_LOG_TRACE("");
-     cout <<"Usage: mcproxy [-h] [-f] [-d] [-s] [-v [-v]] [-c <configfile>]" << endl;
+     cout <<"Usage: mcproxy [-h] [-f] [-b] [-r [-w <msec>]] [-j <msec>] [-l] [-e | -p [<threads>]] [-d] [-s] [-v [-v]] [-c <configfile>]" << endl;
      cout << endl;
      cout << "\t-h" << endl;
      cout << "\t\tDisplay this help screen." << endl;
@@ -396,6 +848,40 @@ void proxy::help_output(){
      cout << "\t\tReset the reverse path filter flag, to accept data from" << endl;
      cout << "\t\tforeign Subnets." << endl;
 
+     cout << "\t-b" << endl;
+     cout << "\t\tProgram the IPv4 forwarding rules with batched rtnetlink" << endl;
+     cout << "\t\tmessages instead of one setsockopt per rule." << endl;
+
+     cout << "\t-r" << endl;
+     cout << "\t\tJoin the upstream groups with generated Membership Reports" << endl;
+     cout << "\t\tinstead of socket joins, this is not limited by the kernel" << endl;
+     cout << "\t\tper socket membership limits." << endl;
+
+     cout << "\t-w" << endl;
+     cout << "\t\tCollect the membership changes of the raw membership mode" << endl;
+     cout << "\t\tfor <msec> and send them as few reports with many records" << endl;
+     cout << "\t\t(default " << SENDER_SERVICE_DEFAULT_REPORT_WINDOW << " msec, 0 sends them immediately)." << endl;
+
+     cout << "\t-j" << endl;
+     cout << "\t\tMaximum random deviation of a General Query from the Query" << endl;
+     cout << "\t\tInterval, the queries of the downstreams are staggered and" << endl;
+     cout << "\t\tdrift apart by this jitter (default " << PROXY_INSTANCE_DEFAULT_GQ_JITTER << " msec)." << endl;
+
+     cout << "\t-l" << endl;
+     cout << "\t\tRemember the last seen sources of a group for " << PROXY_INSTANCE_LAST_SOURCES_LIFETIME << " Query" << endl;
+     cout << "\t\tIntervals and install there forwarding rules as soon as the" << endl;
+     cout << "\t\tgroup is joined again." << endl;
+
+     cout << "\t-e" << endl;
+     cout << "\t\tRun the receiver, all proxy instances, the routing and the" << endl;
+     cout << "\t\ttimers in one thread, driven by an event loop. For small" << endl;
+     cout << "\t\tsetups, it saves the thread switches of every packet." << endl;
+
+     cout << "\t-p" << endl;
+     cout << "\t\tRun the proxy instances by a fixed pool of <threads> threads" << endl;
+     cout << "\t\tinstead of one thread per proxy instance, an idle thread takes" << endl;
+     cout << "\t\tthe waiting jobs of the other threads (default number of CPU cores)." << endl;
+
      cout << "\t-d" << endl;
      cout << "\t\tRun in debug mode. Output all log messages on thread[X]" << endl;
      cout << "\t\tfile." << endl;
@@ -419,7 +905,7 @@ bool proxy::prozess_commandline_args(int arg_count, char* args[]){
      if(arg_count == 1){
 
      }else{
-          for (int c; (c = getopt(arg_count, args, "hfdsvc")) != -1;) {
+          for (int c; (c = getopt(arg_count, args, "hfbrwjlepdsvc")) != -1;) {
                switch (c) {
                case 'h':
                     help_output();
@@ -428,6 +914,48 @@ bool proxy::prozess_commandline_args(int arg_count, char* args[]){
                case 'f':
                     m_rest_rp_filter = true;
                     break;
+               case 'b':
+                    m_batch_routes = true;
+                    break;
+               case 'r':
+                    m_raw_membership = true;
+                    break;
+               case 'w':
+                    if(optind < arg_count && args[optind][0] != '-'){
+                         m_report_window = atoi(args[optind]);
+                    }else{
+                         HC_LOG_ERROR("no report window defined");
+                         cout << "no report window defined" << endl;
+                         return false;
+                    }
+                    break;
+               case 'j':
+                    if(optind < arg_count && args[optind][0] != '-'){
+                         m_gq_jitter = atoi(args[optind]);
+                    }else{
+                         HC_LOG_ERROR("no query jitter defined");
+                         cout << "no query jitter defined" << endl;
+                         return false;
+                    }
+                    break;
+               case 'l':
+                    m_remember_sources = true;
+                    break;
+               case 'e':
+                    m_single_thread = true;
+                    break;
+               case 'p':
+                    if(optind < arg_count && args[optind][0] != '-'){
+                         m_pool_threads = atoi(args[optind]);
+                         if(m_pool_threads < 0){
+                              HC_LOG_ERROR("wrong number of pool threads: " << args[optind]);
+                              cout << "wrong number of pool threads: " << args[optind] << endl;
+                              return false;
+                         }
+                    }else{
+                         m_pool_threads = 0; //number of CPU cores
+                    }
+                    break;
                case 'd':
                     logging = true;
                     break;
@@ -487,8 +1015,18 @@ bool proxy::start_proxy_instances(){
      for ( it_up_down=m_up_down_map.begin() ; it_up_down != m_up_down_map.end(); it_up_down++ ){
           down_vector tmp_down_vector =it_up_down->second;
 
-          proxy_instance* p= new proxy_instance();
-          m_proxy_instances.push_back(p);
+          //the shards of an instance follow each other in m_proxy_instances
+          int instance = m_proxy_instances.size();
+          map<int, int>::iterator it_shards = m_shards.find(it_up_down->first);
+          vector<proxy_instance*> tmp_shards;
+          if(it_shards != m_shards.end() && it_shards->second > 1){
+               for(int i=0; i < it_shards->second; i++){
+                    tmp_shards.push_back(new proxy_instance());
+               }
+               m_proxy_instances.insert(m_proxy_instances.end(), tmp_shards.begin(), tmp_shards.end());
+          }else{
+               m_proxy_instances.push_back(new proxy_instance());
+          }
 
           if((it_vif = m_vif_map.find(it_up_down->first)) == m_vif_map.end()){
                HC_LOG_ERROR("failed to find vif form if_index: " << it_up_down->first);
@@ -503,13 +1041,18 @@ bool proxy::start_proxy_instances(){
           downstream_vif = it_vif->second;
 
           //start proxy instance
-          p->init(m_addr_family,m_version,it_up_down->first, upstream_vif, tmp_down_vector[0], downstream_vif, m_receiver);
-          p->start();
+          for(unsigned int i=instance; i < m_proxy_instances.size(); i++){
+               m_proxy_instances[i]->init(m_addr_family,m_version,it_up_down->first, upstream_vif, tmp_down_vector[0], downstream_vif, m_receiver, m_raw_membership, m_gq_jitter, m_remember_sources, i - instance, tmp_shards);
+               if(m_worker_pool != NULL){
+                    m_proxy_instances[i]->set_worker_pool(m_worker_pool);
+               }
+               m_proxy_instances[i]->start();
+          }
 
 
           //add upstream and first downstream
-          m_interface_map.insert(interface_pair(it_up_down->first,m_proxy_instances.size()-1));
-          m_interface_map.insert(interface_pair(tmp_down_vector[0],m_proxy_instances.size()-1));
+          m_interface_map.insert(interface_pair(it_up_down->first,instance));
+          m_interface_map.insert(interface_pair(tmp_down_vector[0],instance));
 
           //add downstream
           for(unsigned int i=1; i <tmp_down_vector.size();i++){
@@ -521,18 +1064,75 @@ bool proxy::start_proxy_instances(){
                }
                downstream_vif = it_vif->second;
                msg.msg = new config_msg(config_msg::ADD_DOWNSTREAM, tmp_down_vector[i], downstream_vif);
-               p->add_msg(msg);
-               m_interface_map.insert(interface_pair(tmp_down_vector[i],m_proxy_instances.size()-1));
+               add_instance_msg(instance, msg);
+               m_interface_map.insert(interface_pair(tmp_down_vector[i],instance));
+          }
+
+          //add the further upstreams and the group ranges of the first one, before the static groups are distributed
+          vector<int> tmp_up_vector(1, it_up_down->first);
+          map<int, vector<int> >::iterator it_more_upstreams = m_more_upstreams.find(it_up_down->first);
+          if(it_more_upstreams != m_more_upstreams.end()){
+               tmp_up_vector.insert(tmp_up_vector.end(), it_more_upstreams->second.begin(), it_more_upstreams->second.end());
+          }
+          for(unsigned int i=0; i <tmp_up_vector.size();i++){
+               map<int, vector<group_prefix> >::iterator it_prefixes = m_upstream_prefixes.find(tmp_up_vector[i]);
+               if(i == 0 && it_prefixes == m_upstream_prefixes.end()) continue;
+
+               msg.type = proxy_msg::CONFIG_MSG;
+               msg.msg = new config_msg(config_msg::ADD_UPSTREAM, tmp_up_vector[i], m_vif_map[tmp_up_vector[i]], (it_prefixes == m_upstream_prefixes.end())? vector<group_prefix>() : it_prefixes->second);
+               add_instance_msg(instance, msg);
+               m_interface_map.insert(interface_pair(tmp_up_vector[i],instance));
+          }
+          for(unsigned int i=0; i <tmp_up_vector.size();i++){
+               if(m_backup_upstreams.find(tmp_up_vector[i]) != m_backup_upstreams.end()){
+                    msg.type = proxy_msg::CONFIG_MSG;
+                    msg.msg = new config_msg(config_msg::SET_BACKUP_UPSTREAM, tmp_up_vector[i], m_vif_map[tmp_up_vector[i]]);
+                    add_instance_msg(instance, msg);
+               }
+          }
+
+          //join the static groups of the upstream and of the downstreams
+          map<int, vector<addr_storage> >::iterator it_static = m_static_groups.find(it_up_down->first);
+          if(it_static != m_static_groups.end()){
+               msg.type = proxy_msg::CONFIG_MSG;
+               msg.msg = new config_msg(config_msg::STATIC_GROUPS, it_up_down->first, upstream_vif, it_static->second);
+               add_instance_msg(instance, msg);
+          }
+          for(unsigned int i=0; i <tmp_down_vector.size();i++){
+               if((it_static = m_static_groups.find(tmp_down_vector[i])) != m_static_groups.end()){
+                    msg.type = proxy_msg::CONFIG_MSG;
+                    msg.msg = new config_msg(config_msg::STATIC_GROUPS, tmp_down_vector[i], m_vif_map[tmp_down_vector[i]], it_static->second);
+                    add_instance_msg(instance, msg);
+               }
+          }
+
+          //set the fast leave mode of the downstreams
+          for(unsigned int i=0; i <tmp_down_vector.size();i++){
+               if(m_fast_leave.find(tmp_down_vector[i]) != m_fast_leave.end()){
+                    msg.type = proxy_msg::CONFIG_MSG;
+                    msg.msg = new config_msg(config_msg::SET_FAST_LEAVE, tmp_down_vector[i], m_vif_map[tmp_down_vector[i]]);
+                    add_instance_msg(instance, msg);
+               }
           }
      }
 
      return true;
 }
 
+void proxy::add_instance_msg(int instance, proxy_msg& msg){
+     HC_LOG_TRACE("");
+
+     //a message for an instance is a message for all its shards
+     int shard_count = m_proxy_instances[instance]->get_shard_count();
+     for(int i=instance; i < instance + shard_count; i++){
+          m_proxy_instances[i]->add_msg(msg);
+     }
+}
+
 bool proxy::init_if_prop(){
      HC_LOG_TRACE("");
 
-     if(!m_if_prop.refresh_network_interfaces()) return false;
+     if(!if_cache::getInstance()->refresh()) return false;
 
      return true;
 }
@@ -540,37 +1140,28 @@ bool proxy::init_if_prop(){
 bool proxy::check_and_set_flags(vector<int>& interface_list){
      HC_LOG_TRACE("");
 
-     char cstr[IF_NAMESIZE];
-     if_prop_map* prop_map = m_if_prop.get_if_props();
-
-     //##debug
-     //m_if_prop.print_if_info();
+     if(m_addr_family != AF_INET && m_addr_family != AF_INET6){
+          HC_LOG_ERROR("wrong addr_family: " << m_addr_family);
+          return false;
+     }
 
-     if_prop_map::iterator iter;
-     struct ifaddrs* ifaddr;
+     if_cache_snapshot snapshot = if_cache::getInstance()->get_snapshot();
 
      for(unsigned int i=0; i< interface_list.size(); i++){
-          string if_name(if_indextoname(interface_list[i],cstr));
-          iter = prop_map->find(if_name);
+          const struct if_cache_entry* entry = if_cache::find(snapshot, interface_list[i]);
 
-          if(iter == prop_map->end()){
-               HC_LOG_ERROR("interface " << if_name << " not found");
+          if(entry == NULL){
+               HC_LOG_ERROR("interface index " << interface_list[i] << " not found");
                return false;
           }
+          const string& if_name = entry->name;
 
-          if(m_addr_family == AF_INET){
-               ifaddr = iter->second.first;
-          }else if(m_addr_family == AF_INET6){
-               list<struct ifaddrs*>* ipv6_if_list = &(iter->second.second);
-               ifaddr = *(ipv6_if_list->begin());
-          }else{
-               HC_LOG_ERROR("wrong addr_family: " << m_addr_family);
+          if(entry->get_addrs(m_addr_family).empty()){
+               HC_LOG_ERROR("wrong interface status: interface " << if_name << " has no address of the used IP version");
                return false;
           }
 
-          //m_if_prop.print_if_addr(ifaddr);
-
-          if(!(ifaddr->ifa_flags & IFF_UP)){
+          if(!(entry->flags & IFF_UP)){
                HC_LOG_ERROR("wrong interface status: interface " << if_name << " is not up");
                return false;
           }
@@ -691,6 +1282,10 @@ bool proxy::start(){
           }
      }
 
+     //a lost upstream moves its groups to the other upstreams of the instance
+     set<int> shared_upstreams = get_shared_upstreams();
+     if_list_tmp.insert(if_list_tmp.end(), shared_upstreams.begin(), shared_upstreams.end());
+
      //init status
      //del all down interfaces
      if_list_tmp = check_interface.init(if_list_tmp, m_addr_family);
@@ -705,20 +1300,73 @@ bool proxy::start(){
                return false;
           }
 
-          msg.msg = new config_msg(config_msg::DEL_DOWNSTREAM,*i, it_vif->second);
-          m_proxy_instances[it_proxy_numb->second]->add_msg(msg);
+          msg.type = proxy_msg::CONFIG_MSG;
+          if(shared_upstreams.find(*i) != shared_upstreams.end()){
+               msg.msg = new config_msg(config_msg::DEL_UPSTREAM,*i, it_vif->second);
+          }else{
+               msg.msg = new config_msg(config_msg::DEL_DOWNSTREAM,*i, it_vif->second);
+          }
+          add_instance_msg(it_proxy_numb->second, msg);
      }
 
 
+     //repair the routes left by a previous run
+     msg.type = proxy_msg::ROUTING_MSG;
+     msg.msg = new routing_msg(routing_msg::RECONCILE);
+     routing::getInstance()->add_msg(msg);
+     time_t last_reconcile = time(NULL);
+
+     //single threaded mode: wait for received packets and interface events
+     int epoll_fd = -1;
+     if(m_single_thread){
+          epoll_fd = epoll_create(PROXY_EVENT_LOOP_MAX_EVENTS);
+          if(epoll_fd < 0){
+               HC_LOG_ERROR("failed to create the event loop! Error: " << strerror(errno) << " errno: " << errno);
+               return false;
+          }
+
+          int fds[2] = {m_mrt_sock.get_socket(), check_interface.get_event_socket()};
+          for(int i = 0; i < 2; i++){
+               if(fds[i] < 0) continue; //the interfaces are polled
+
+               struct epoll_event ev;
+               memset(&ev, 0, sizeof(ev));
+               ev.events = EPOLLIN;
+               ev.data.fd = fds[i];
+               if(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fds[i], &ev) < 0){
+                    HC_LOG_ERROR("failed to add a socket to the event loop! Error: " << strerror(errno) << " errno: " << errno);
+                    ::close(epoll_fd);
+                    return false;
+               }
+          }
+     }
+
      //#################################
      int alive_time=0;
+     time_t last_status = time(NULL);
      proxy::m_running = true;
      while(proxy::m_running){
 
-          usleep(2000000);
-          alive_time +=1;
+          //wait for interface events
+          if(m_single_thread){
+               if(!wait_for_events(epoll_fd, check_interface, PROXY_CHECK_IF_TIMEOUT)){
+                    usleep(PROXY_CHECK_IF_TIMEOUT * 1000);
+               }
+          }else if(!check_interface.check(PROXY_CHECK_IF_TIMEOUT)){
+               usleep(PROXY_CHECK_IF_TIMEOUT * 1000);
+          }
+
+          if(time(NULL) - last_reconcile >= PROXY_RECONCILE_INTERVAL){
+               msg.type = proxy_msg::ROUTING_MSG;
+               msg.msg = new routing_msg(routing_msg::RECONCILE);
+               routing::getInstance()->add_msg(msg);
+               last_reconcile = time(NULL);
+          }
+
+          if(m_print_status && time(NULL) - last_status >= PROXY_CHECK_IF_TIMEOUT / 1000){
+               alive_time +=1;
+               last_status = time(NULL);
 
-          if(m_print_status){
                debug_msg::lod lod;
                if(m_verbose_lvl==0){
                     lod =debug_msg::NORMAL;
@@ -742,7 +1390,6 @@ bool proxy::start(){
                cout << dm->get_debug_msg() << endl;
           }
 
-          check_interface.check();
           //calc swap_to_down interfaces
           if_list_tmp = check_interface.swap_to_down();
           for(vector<int>::iterator i= if_list_tmp.begin(); i < if_list_tmp.end(); i++){
@@ -757,8 +1404,12 @@ bool proxy::start(){
                }
 
                msg.type = proxy_msg::CONFIG_MSG;
-               msg.msg = new config_msg(config_msg::DEL_DOWNSTREAM,*i, it_vif->second);
-               m_proxy_instances[it_proxy_numb->second]->add_msg(msg);
+               if(shared_upstreams.find(*i) != shared_upstreams.end()){
+                    msg.msg = new config_msg(config_msg::DEL_UPSTREAM,*i, it_vif->second);
+               }else{
+                    msg.msg = new config_msg(config_msg::DEL_DOWNSTREAM,*i, it_vif->second);
+               }
+               add_instance_msg(it_proxy_numb->second, msg);
           }
 
           //calc swap_to_up interfaces
@@ -775,16 +1426,98 @@ bool proxy::start(){
                }
 
                msg.type = proxy_msg::CONFIG_MSG;
-               msg.msg = new config_msg(config_msg::ADD_DOWNSTREAM,*i, it_vif->second);
-               m_proxy_instances[it_proxy_numb->second]->add_msg(msg);
+               if(shared_upstreams.find(*i) != shared_upstreams.end()){
+                    map<int, vector<group_prefix> >::iterator it_prefixes = m_upstream_prefixes.find(*i);
+                    msg.msg = new config_msg(config_msg::ADD_UPSTREAM,*i, it_vif->second, (it_prefixes == m_upstream_prefixes.end())? vector<group_prefix>() : it_prefixes->second);
+               }else{
+                    msg.msg = new config_msg(config_msg::ADD_DOWNSTREAM,*i, it_vif->second);
+               }
+               add_instance_msg(it_proxy_numb->second, msg);
           }
-     }
 
+          //calc interfaces with changed addresses
+          if_list_tmp = check_interface.addr_changed();
+          for(vector<int>::iterator i= if_list_tmp.begin(); i < if_list_tmp.end(); i++){
+               if((it_vif = m_vif_map.find(*i)) == m_vif_map.end()){
+                    HC_LOG_ERROR("failed to find vif form if_index: " << *i);
+                    continue;
+               }
 
+               if((it_proxy_numb = m_interface_map.find(*i)) == m_interface_map.end()){
+                    HC_LOG_ERROR("failed to find proxy instance form if_index: " << *i);
+                    continue;
+               }
+
+               msg.type = proxy_msg::CONFIG_MSG;
+               msg.msg = new config_msg(config_msg::CHANGE_ADDR,*i, it_vif->second);
+               add_instance_msg(it_proxy_numb->second, msg);
+          }
+     }
+
+     if(epoll_fd >= 0){
+          ::close(epoll_fd);
+     }
 
      return true;
 }
 
+bool proxy::wait_for_events(int epoll_fd, check_if& check_interface, int timeout_msec){
+     HC_LOG_TRACE("");
+
+     timing* tim = timing::getInstance();
+     struct epoll_event events[PROXY_EVENT_LOOP_MAX_EVENTS];
+
+     struct timeval end;
+     gettimeofday(&end, NULL);
+     end.tv_sec += timeout_msec / 1000;
+     end.tv_usec += 1000 * (timeout_msec % 1000);
+     if(end.tv_usec >= 1000000){
+          end.tv_sec += 1;
+          end.tv_usec -= 1000000;
+     }
+
+     bool if_event = false;
+     while(!if_event && proxy::m_running){
+          struct timeval now;
+          struct timeval diff;
+          gettimeofday(&now, NULL);
+          if(!timercmp(&now, &end, <)){
+               break;
+          }
+          timersub(&end, &now, &diff);
+
+          //wake up for the next reminder
+          int wait = diff.tv_sec * 1000 + (diff.tv_usec + 999) / 1000;
+          int next = tim->get_next_timeout();
+          if(next >= 0 && next < wait){
+               wait = next;
+          }
+
+          int rc = epoll_wait(epoll_fd, events, PROXY_EVENT_LOOP_MAX_EVENTS, wait);
+          if(rc < 0){
+               if(errno == EINTR){ //e.g. the signal to stop the proxy
+                    return true;
+               }
+               HC_LOG_ERROR("failed to wait for events! Error: " << strerror(errno) << " errno: " << errno);
+               return false;
+          }
+
+          //the proxy instances and the routing process the packet before receive_packet() returns
+          for(int i = 0; i < rc; i++){
+               if(events[i].data.fd == m_mrt_sock.get_socket()){
+                    m_receiver->receive_packet();
+               }else{
+                    if_event = true;
+               }
+          }
+
+          tim->check_time();
+     }
+
+     //read the interface events or poll the interfaces
+     return check_interface.check(0);
+}
+
 void proxy::signal_handler(int sig){
      HC_LOG_TRACE("");
 
@@ -811,6 +1544,13 @@ void proxy::end(){
           delete m_proxy_instances[i];
      }
 
+     if(m_worker_pool != NULL){
+          HC_LOG_DEBUG("stop worker pool");
+          m_worker_pool->stop();
+          delete m_worker_pool;
+          m_worker_pool = NULL;
+     }
+
      HC_LOG_DEBUG("stop receiver");
      m_receiver->stop();
      HC_LOG_DEBUG("join receiver");
@@ -818,6 +1558,13 @@ void proxy::end(){
      HC_LOG_DEBUG("joined");
      delete m_receiver;
 
+     //after the proxy instances to send their leaves
+     HC_LOG_DEBUG("kill sender worker thread");
+     sender_service::getInstance()->add_msg(m);
+     HC_LOG_DEBUG("join sender worker thread");
+     sender_service::getInstance()->join();
+     HC_LOG_DEBUG("joined");
+
      HC_LOG_DEBUG("kill routing worker thread");
      routing::getInstance()->add_msg(m);
      HC_LOG_DEBUG("join routing worker thread");
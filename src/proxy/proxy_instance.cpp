@@ -23,12 +23,15 @@
 #include "include/hamcast_logging.h"
 #include "include/proxy/proxy_instance.hpp"
 #include "include/utils/mc_timers_values.hpp"
+#include "include/utils/if_cache.hpp"
+#include "include/utils/mc_msg_format.hpp"
 
 #include <net/if.h>
 #include <sstream>
+#include <cstdlib>
 
 proxy_instance::proxy_instance():
-    worker(PROXY_INSTANCE_MSG_QUEUE_SIZE), m_upstream(0), m_addr_family(-1), m_version(-1)
+    worker(PROXY_INSTANCE_MSG_QUEUE_SIZE), m_shard(0), m_upstream(0), m_addr_family(-1), m_version(-1), m_raw_membership(false), m_gq_jitter(0), m_remember_sources(false)
 {
     HC_LOG_TRACE("");
 
@@ -39,41 +42,103 @@ proxy_instance::~proxy_instance(){
     close();
 }
 
-bool proxy_instance::init(int addr_family, int version, int upstream_index, int upstream_vif, int downstream_index, int downstram_vif,receiver* r){
+bool proxy_instance::init(int addr_family, int version, int upstream_index, int upstream_vif, int downstream_index, int downstram_vif,receiver* r, bool raw_membership, int gq_jitter, bool remember_sources, int shard, const std::vector<proxy_instance*>& shards){
     HC_LOG_TRACE("");
 
+    m_shard = shard;
+    m_shards = shards;
+
+    //e.g. mcp-eth0 or mcp-eth0.2 for the third shard
+    stringstream tmp_thread_name;
+    tmp_thread_name << "mcp-" << if_cache::getInstance()->get_name(upstream_index);
+    if(shards.size() > 1){
+        tmp_thread_name << "." << shard;
+    }
+    m_thread_name = tmp_thread_name.str();
+
     m_addr_family =  addr_family;
     m_version = version;
+    m_gq_jitter = (gq_jitter > 0)? gq_jitter : 0;
+    m_remember_sources = remember_sources;
 
     m_upstream = upstream_index;
+    m_upstreams.push_back(upstream_index);
     m_vif_map.insert(vif_pair(upstream_index,upstream_vif));
 
 
     m_state_table.insert(state_tabel_pair(downstream_index, g_state_map()));
     m_vif_map.insert(vif_pair(downstream_index, downstram_vif));
 
-    m_check_source.init(m_addr_family);
+    m_check_source.init(m_addr_family, check_source::SG_COUNTER);
 
     m_receiver = r;
 
     m_routing = routing::getInstance();
     m_timing = timing::getInstance();
 
-    if(m_addr_family == AF_INET){
-        m_sender = new igmp_sender;
-    }else if(m_addr_family == AF_INET6){
-        m_sender = new mld_sender;
-    }else{
+    m_sender = sender_service::getInstance();
+
+    if(m_addr_family != AF_INET && m_addr_family != AF_INET6){
         HC_LOG_ERROR("wrong addr_family: " << m_addr_family);
         return false;
     }
 
-    if(!m_sender->init(m_addr_family,m_version)) return false;
+    m_raw_membership = raw_membership;
+    if(m_raw_membership){
+        proxy_msg m;
+        m.type = proxy_msg::SENDER_MSG;
+        m.msg = new struct sender_msg(sender_msg::SET_RAW_MEMBERSHIP, this, m_upstream, true);
+        m_sender->add_msg(m);
+    }
 
     return true;
 }
 
-void proxy_instance::worker_thread(){
+int proxy_instance::get_shard(){
+    HC_LOG_TRACE("");
+    return m_shard;
+}
+
+int proxy_instance::get_shard_count(){
+    HC_LOG_TRACE("");
+    return m_shards.empty()? 1 : m_shards.size();
+}
+
+//called for every received group, it does not trace
+int proxy_instance::get_group_shard(const addr_storage& g_addr, int shard_count){
+    if(shard_count <= 1) return 0;
+
+    unsigned int hash = hash_group(g_addr);
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bU;
+    hash ^= hash >> 13;
+    return hash % shard_count;
+}
+
+//called for every group, it does not trace
+unsigned int proxy_instance::hash_group(const addr_storage& g_addr){
+    unsigned char addr[sizeof(struct in6_addr)];
+    unsigned int addr_len;
+    if(g_addr.get_addr_family() == AF_INET){
+        struct in_addr tmp;
+        tmp <<= g_addr;
+        memcpy(addr, &tmp, sizeof(tmp));
+        addr_len = sizeof(tmp);
+    }else{
+        struct in6_addr tmp;
+        tmp <<= g_addr;
+        memcpy(addr, &tmp, sizeof(tmp));
+        addr_len = sizeof(tmp);
+    }
+
+    unsigned int hash = 2166136261U;
+    for(unsigned int i = 0; i < addr_len; i++){
+        hash = (hash ^ addr[i]) * 16777619U;
+    }
+    return hash;
+}
+
+void proxy_instance::prepare(){
     HC_LOG_TRACE("");
 
     proxy_msg m;
@@ -95,50 +160,82 @@ void proxy_instance::worker_thread(){
     m.type = proxy_msg::CLOCK_MSG;
     m.msg = new struct clock_msg(clock_msg::SEND_GQ_TO_ALL);
     m_timing->add_time(MC_TV_QUERY_INTERVAL*1000 /*msec*/,this,m);
+}
 
-    //##-- thread working loop --##
-    while(m_running){
-        m = m_job_queue.dequeue();
-        HC_LOG_DEBUG("received new job. type: " << m.msg_type_to_string());
-        switch(m.type){
-        case proxy_msg::TEST_MSG: {
-            struct test_msg* t= (struct test_msg*) m.msg.get();
-            t->test();
-            break;
-        }
-        case proxy_msg::RECEIVER_MSG: {
-            struct receiver_msg* t= (struct receiver_msg*) m.msg.get();
-            handle_igmp(t);
-            break;
-        }
-        case proxy_msg::CLOCK_MSG: {
-            struct clock_msg* t = (struct clock_msg*) m.msg.get();
-            handle_clock(t);
-            break;
-        }
-        case proxy_msg::CONFIG_MSG: {
-            struct config_msg* t = (struct config_msg*) m.msg.get();
-            handle_config(t);
-            break;
-        }
-        case proxy_msg::DEBUG_MSG: {
-            struct debug_msg* t = (struct debug_msg*) m.msg.get();
-            handle_debug_msg(t);
-            break;
-        }
+void proxy_instance::handle_msg(proxy_msg& m){
+    HC_LOG_TRACE("");
 
-        case proxy_msg::EXIT_CMD: m_running = false; break;
-        default: HC_LOG_ERROR("unknown message format");
-        }
+    switch(m.type){
+    case proxy_msg::TEST_MSG: {
+        struct test_msg* t= (struct test_msg*) m.msg.get();
+        t->test();
+        break;
+    }
+    case proxy_msg::RECEIVER_MSG: {
+        struct receiver_msg* t= (struct receiver_msg*) m.msg.get();
+        handle_igmp(t);
+        break;
+    }
+    case proxy_msg::CLOCK_MSG: {
+        struct clock_msg* t = (struct clock_msg*) m.msg.get();
+        handle_clock(t);
+        break;
+    }
+    case proxy_msg::CONFIG_MSG: {
+        struct config_msg* t = (struct config_msg*) m.msg.get();
+        handle_config(t);
+        break;
+    }
+    case proxy_msg::DEBUG_MSG: {
+        struct debug_msg* t = (struct debug_msg*) m.msg.get();
+        handle_debug_msg(t);
+        break;
     }
 
+    case proxy_msg::EXIT_CMD: m_running = false; break;
+    default: HC_LOG_ERROR("unknown message format");
+    }
+
+    //a burst of due GSQs is sent with one syscall
+    if(!m_due_gsq.empty() && (m_due_gsq.size() >= PROXY_INSTANCE_MAX_GSQ_BATCH || is_job_queue_empty())){
+        send_due_gsq();
+    }
+}
+
+void proxy_instance::finish(){
+    HC_LOG_TRACE("");
+
+    proxy_msg m;
+    state_table_map::iterator it_state_table;
+
     //##-- timing --##
     //remove all running times
     m_timing->stop_all_time(this);
 
+    //##-- sender --##
+    //the socket is shared, leave the upstream groups of this proxy instance
+    vector<addr_storage> tmp_joined_groups;
+    map<addr_storage, int>::iterator it_group_upstream;
+    for(it_group_upstream = m_group_upstream.begin(); it_group_upstream != m_group_upstream.end(); it_group_upstream++){
+        tmp_joined_groups.push_back(it_group_upstream->first);
+    }
+    leave_upstream(tmp_joined_groups);
+
+    if(m_raw_membership){
+        for(unsigned int i = 0; i < m_upstreams.size(); i++){
+            m.type = proxy_msg::SENDER_MSG;
+            m.msg = new struct sender_msg(sender_msg::SET_RAW_MEMBERSHIP, this, m_upstreams[i], false);
+            m_sender->add_msg(m);
+        }
+    }
+
     //##-- del all interfaces --##
-    //upsteam
-    unregistrate_if(m_upstream);
+    //upsteams, the down ones are already unregistrated
+    for(unsigned int i = 0; i < m_upstreams.size(); i++){
+        if(m_upstreams_down.find(m_upstreams[i]) == m_upstreams_down.end()){
+            unregistrate_if(m_upstreams[i]);
+        }
+    }
     //downsteams
     for ( it_state_table=m_state_table.begin() ; it_state_table != m_state_table.end(); it_state_table++ ){
         unregistrate_if(it_state_table->first);
@@ -158,71 +255,63 @@ void proxy_instance::handle_igmp(struct receiver_msg* r){
 
     switch(r->type){
     case receiver_msg::JOIN: {
-        //upstream joins are uninteresting
-        if(r->if_index == m_upstream) return;
-
-        iter_table =m_state_table.find(r->if_index);
-        if(iter_table == m_state_table.end()) return;
-
-        iter_state = iter_table->second.find(r->g_addr);
-
-        if(iter_state == iter_table->second.end()){ //add group
-            struct src_state tmp_state(MC_TV_ROBUSTNESS_VARIABLE, src_state::RUNNING);
-            iter_table->second.insert(g_state_pair(r->g_addr,src_group_state_pair(src_state_map(), tmp_state)));
-
-            //--refresh upstream
-            if(!is_group_joined(r->if_index,r->g_addr)){
-                if(!m_sender->send_report(m_upstream, r->g_addr)){
-                    HC_LOG_ERROR("failed to join on upstream group: " << r->g_addr);
-                    return;
-                }
-            }
-
-            //--refresh routing
-            refresh_all_traffic(r->if_index, r->g_addr);
-
-        }else{ //refresh group
-            sgs_pair = &iter_state->second;
-            sgs_pair->second.robustness_counter = MC_TV_ROBUSTNESS_VARIABLE;
-            sgs_pair->second.flag = src_state::RUNNING;
-        }
-
+        vector<addr_storage> upstream_joins;
+        join_group(r->if_index, r->src_addr, r->g_addr, upstream_joins);
+        join_upstream(upstream_joins);
         break;
     }
     case receiver_msg::LEAVE:{
-        //cout << "leave an if: " << r->if_index << " für gruppe:" << r->g_addr << " empfangen" << endl;
-        //upstream leaves are uninteresting
-        if(r->if_index == m_upstream) return;
-
-        iter_table =m_state_table.find(r->if_index);
-        if(iter_table == m_state_table.end()) return;
-
-        iter_state = iter_table->second.find(r->g_addr);
-        if(iter_state == iter_table->second.end()) return;
-        sgs_pair = &iter_state->second;
-
-        sgs_pair->second.flag = src_state::RESPONSE_STATE;
-
-        msg.type = proxy_msg::CLOCK_MSG;
-        msg.msg = new struct clock_msg(clock_msg::SEND_GSQ, iter_table->first, iter_state->first);
-
-        if(m_addr_family == AF_INET){
-            sgs_pair->second.robustness_counter = MC_TV_LAST_MEMBER_QUERY_COUNT;
-
-            m_timing->add_time(MC_TV_LAST_MEMBER_QUERY_INTEVAL*1000 /*msec*/,this,msg);
-        }else if(m_addr_family== AF_INET6){
-            sgs_pair->second.robustness_counter = MC_TV_LAST_LISTENER_QUERY_COUNT;
-
-            m_timing->add_time(MC_TV_LAST_LISTENER_QUERY_INTERVAL*1000 /*msec*/,this,msg);
-        }else{
-            HC_LOG_ERROR("wrong addr_family: " << m_addr_family);
-            return;
+        leave_group(r->if_index, r->src_addr, r->g_addr);
+        break;
+    }
+    case receiver_msg::RECORDS: {
+        //upstream reports are uninteresting
+        if(is_upstream(r->if_index)) return;
+
+        //the proxy forwards whole groups, source lists only decide whether a record joins or leaves
+        vector<addr_storage> upstream_joins;
+        for(unsigned int i = 0; i < r->records.size(); i++){
+            group_record& rec = r->records[i];
+            switch(rec.type){
+            case MC_MSG_MODE_IS_EXCLUDE:
+            case MC_MSG_CHANGE_TO_EXCLUDE_MODE:
+                join_group(r->if_index, r->src_addr, rec.g_addr, upstream_joins);
+                break;
+            case MC_MSG_MODE_IS_INCLUDE:
+            case MC_MSG_ALLOW_NEW_SOURCES:
+                if(!rec.src_addrs.empty()){
+                    join_group(r->if_index, r->src_addr, rec.g_addr, upstream_joins);
+                }
+                break;
+            case MC_MSG_CHANGE_TO_INCLUDE_MODE:
+                if(rec.src_addrs.empty()){
+                    leave_group(r->if_index, r->src_addr, rec.g_addr);
+                }else{
+                    join_group(r->if_index, r->src_addr, rec.g_addr, upstream_joins);
+                }
+                break;
+            case MC_MSG_BLOCK_OLD_SOURCES:
+                //the host stays a member, query the group and the remaining listeners report it again
+                if(is_querier(r->if_index)){
+                    query_group(r->if_index, rec.g_addr);
+                }
+                break;
+            default:
+                HC_LOG_DEBUG("unknown record type: " << rec.type);
+            }
         }
+        join_upstream(upstream_joins);
 
         break;
     }
     case receiver_msg::CACHE_MISS: {
-        if(r->if_index == m_upstream){
+        if(is_upstream(r->if_index)){
+            //a group is only forwarded from its assigned upstream
+            if(r->if_index != get_upstream(r->g_addr)){
+                HC_LOG_DEBUG("source: " << r->src_addr << " of group: " << r->g_addr << " ignored on the not assigned upstream: " << r->if_index);
+                return;
+            }
+
             upstream_src_state_map::iterator it_gss = m_upstream_state.find(r->g_addr);
             if(it_gss == m_upstream_state.end()){ //new group found
                 struct src_state tmp_src_state(MC_TV_ROBUSTNESS_VARIABLE, src_state::UNUSED_SRC);
@@ -300,10 +389,546 @@ void proxy_instance::handle_igmp(struct receiver_msg* r){
         }
         break;
     }
+    case receiver_msg::QUERY: {
+        if(!is_upstream(r->if_index)){
+            handle_downstream_query(r);
+            return;
+        }
+
+        //only queries of the upstream in the raw membership mode are answered, otherwise the kernel answers
+        if(!m_raw_membership) return;
+
+        //a pending answer to a General Query covers all groups
+        bool general_query = (r->g_addr == addr_storage(m_addr_family));
+        if(general_query){
+            if(!m_gq_response_pending.insert(r->if_index).second) return;
+        }
+
+        //answer after a random delay up to the Max Response Time
+        msg.type = proxy_msg::CLOCK_MSG;
+        msg.msg = new struct clock_msg(clock_msg::SEND_REPORT, r->if_index, r->g_addr);
+        m_timing->add_time((r->max_resp_time > 0)? rand() % r->max_resp_time : 0 /*msec*/,this,msg);
+
+        break;
+    }
     default: HC_LOG_ERROR("unknown receiver messge format");
     }
 }
 
+void proxy_instance::join_group(int if_index, const addr_storage& host_addr, const addr_storage& g_addr, vector<addr_storage>& upstream_joins){
+    HC_LOG_TRACE("");
+
+    //upstream joins are uninteresting
+    if(is_upstream(if_index)) return;
+
+    //groups of the link local scope are not proxied, e.g. the reports of the own router joins (RFC 4605 Section 4)
+    if(is_link_local_group(g_addr)) return;
+
+    state_table_map::iterator iter_table =m_state_table.find(if_index);
+    if(iter_table == m_state_table.end()) return;
+
+    g_state_map::iterator iter_state = iter_table->second.find(g_addr);
+
+    //a group in INIT state only saves foreign sources and is joined like a new one
+    if(iter_state == iter_table->second.end() || iter_state->second.second.flag == src_state::INIT){ //add group
+        struct src_state tmp_state(MC_TV_ROBUSTNESS_VARIABLE, src_state::RUNNING);
+        if(iter_state == iter_table->second.end()){
+            iter_table->second.insert(g_state_pair(g_addr,src_group_state_pair(src_state_map(), tmp_state)));
+        }else{
+            iter_state->second.second = tmp_state;
+        }
+
+        //--refresh upstream
+        if(!is_group_joined(if_index,g_addr)){
+            upstream_joins.push_back(g_addr);
+        }
+
+        //--refresh routing, the known sources are forwarded immediately and saved by the routing thread afterwards
+        install_known_routes(g_addr);
+        refresh_all_traffic(if_index, g_addr);
+
+    }else{ //refresh group
+        src_group_state_pair* sgs_pair = &iter_state->second;
+        sgs_pair->second.robustness_counter = MC_TV_ROBUSTNESS_VARIABLE;
+        sgs_pair->second.flag = src_state::RUNNING;
+    }
+
+    //reports with an unspecified source can not be assigned to a host
+    if(!(host_addr == addr_storage(m_addr_family))){
+        m_hosts[if_index][g_addr][host_addr] = MC_TV_ROBUSTNESS_VARIABLE;
+    }
+}
+
+//called for every joined group, it does not trace
+bool proxy_instance::is_link_local_group(const addr_storage& g_addr){
+    if(g_addr.get_addr_family() == AF_INET){
+        struct in_addr addr;
+        addr <<= g_addr;
+        return (ntohl(addr.s_addr) & 0xffffff00) == 0xe0000000; //224.0.0.0/24
+    }else if(g_addr.get_addr_family() == AF_INET6){
+        struct in6_addr addr;
+        addr <<= g_addr;
+        return IN6_IS_ADDR_MC_NODELOCAL(&addr) || IN6_IS_ADDR_MC_LINKLOCAL(&addr);
+    }else{
+        return false;
+    }
+}
+
+void proxy_instance::install_known_routes(const addr_storage& g_addr){
+    HC_LOG_TRACE("");
+
+    //restore the remembered sources, they are aged like new sources
+    if(m_remember_sources){
+        upstream_src_state_map::iterator it_last = m_last_sources.find(g_addr);
+        if(it_last != m_last_sources.end()){
+            src_state_map& srcs = m_upstream_state[g_addr];
+            for(src_state_map::iterator it_src = it_last->second.begin(); it_src != it_last->second.end(); it_src++){
+                if(srcs.find(it_src->first) == srcs.end()){
+                    srcs.insert(src_state_pair(it_src->first, src_state(MC_TV_ROBUSTNESS_VARIABLE, src_state::UNUSED_SRC)));
+                }
+            }
+            m_last_sources.erase(it_last);
+        }
+    }
+
+    upstream_src_state_map::iterator it_gss = m_upstream_state.find(g_addr);
+    if(it_gss == m_upstream_state.end()) return;
+
+    int upstream = get_upstream(g_addr);
+    if(upstream < 0) return;
+    vif_map::iterator it_vif_map = m_vif_map.find(upstream);
+    if(it_vif_map == m_vif_map.end()){
+        HC_LOG_ERROR("cant find vif to if_index:" << upstream);
+        return;
+    }
+
+    std::list<int> vif_list;
+    add_all_group_vifs_to_list(&vif_list, upstream, g_addr);
+    if(vif_list.empty()) return;
+
+    for(src_state_map::iterator it_src = it_gss->second.begin(); it_src != it_gss->second.end(); it_src++){
+        m_routing->add_route_now(it_vif_map->second, g_addr, it_src->first, vif_list);
+    }
+}
+
+void proxy_instance::join_upstream(const vector<addr_storage>& g_addrs){
+    HC_LOG_TRACE("");
+
+    if(g_addrs.empty()) return;
+
+    //collect the groups of every upstream, a group is joined on one upstream only
+    map<int, vector<addr_storage> > tmp_joins;
+    for(unsigned int i = 0; i < g_addrs.size(); i++){
+        if(m_group_upstream.find(g_addrs[i]) != m_group_upstream.end()) continue;
+
+        int upstream = get_upstream(g_addrs[i]);
+        if(upstream < 0){
+            m_pending_upstream.insert(g_addrs[i]);
+            continue;
+        }
+        m_pending_upstream.erase(g_addrs[i]);
+        m_group_upstream[g_addrs[i]] = upstream;
+        tmp_joins[upstream].push_back(g_addrs[i]);
+    }
+
+    map<int, vector<addr_storage> >::iterator it_joins;
+    for(it_joins = tmp_joins.begin(); it_joins != tmp_joins.end(); it_joins++){
+        proxy_msg msg;
+        msg.type = proxy_msg::SENDER_MSG;
+        msg.msg = new struct sender_msg(sender_msg::JOIN, this, it_joins->first, it_joins->second);
+        m_sender->add_msg(msg);
+
+        //repeat the unsolicited report once for the whole batch, the kernel does this for socket joins
+        if(m_raw_membership){
+            msg.type = proxy_msg::SENDER_MSG;
+            msg.msg = new struct sender_msg(sender_msg::SEND_CURRENT_STATE, this, it_joins->first, it_joins->second);
+            m_timing->add_time(rand() % (MC_TV_UNSOLICITED_REPORT_INTERVAL*1000) /*msec*/,m_sender,msg);
+        }
+    }
+}
+
+void proxy_instance::leave_upstream(const vector<addr_storage>& g_addrs){
+    HC_LOG_TRACE("");
+
+    if(g_addrs.empty()) return;
+
+    map<int, vector<addr_storage> > tmp_leaves;
+    for(unsigned int i = 0; i < g_addrs.size(); i++){
+        m_pending_upstream.erase(g_addrs[i]);
+
+        map<addr_storage, int>::iterator it_group_upstream = m_group_upstream.find(g_addrs[i]);
+        if(it_group_upstream == m_group_upstream.end()) continue;
+
+        tmp_leaves[it_group_upstream->second].push_back(g_addrs[i]);
+        m_group_upstream.erase(it_group_upstream);
+    }
+
+    map<int, vector<addr_storage> >::iterator it_leaves;
+    for(it_leaves = tmp_leaves.begin(); it_leaves != tmp_leaves.end(); it_leaves++){
+        proxy_msg msg;
+        msg.type = proxy_msg::SENDER_MSG;
+        msg.msg = new struct sender_msg(sender_msg::LEAVE, this, it_leaves->first, it_leaves->second);
+        m_sender->add_msg(msg);
+    }
+}
+
+bool proxy_instance::is_upstream(int if_index){
+    HC_LOG_TRACE("");
+
+    return find(m_upstreams.begin(), m_upstreams.end(), if_index) != m_upstreams.end();
+}
+
+//called for every group and source, it does not trace
+int proxy_instance::get_upstream(const addr_storage& g_addr){
+    int upstream = -1;
+
+    //the backup upstreams are used if no other upstream is running
+    bool use_backup = true;
+    for(unsigned int i = 0; i < m_upstreams.size(); i++){
+        if(m_backup_upstreams.find(m_upstreams[i]) == m_backup_upstreams.end() && m_upstreams_down.find(m_upstreams[i]) == m_upstreams_down.end()){
+            use_backup = false;
+            break;
+        }
+    }
+
+    //a configured range wins, the longest prefix of a running upstream
+    int best_prefix_len = -1;
+    map<int, vector<group_prefix> >::iterator it_prefixes;
+    for(it_prefixes = m_upstream_prefixes.begin(); it_prefixes != m_upstream_prefixes.end(); it_prefixes++){
+        if(m_upstreams_down.find(it_prefixes->first) != m_upstreams_down.end()) continue;
+        if((m_backup_upstreams.find(it_prefixes->first) != m_backup_upstreams.end()) != use_backup) continue;
+
+        for(unsigned int i = 0; i < it_prefixes->second.size(); i++){
+            if(it_prefixes->second[i].second > best_prefix_len && is_in_prefix(g_addr, it_prefixes->second[i])){
+                best_prefix_len = it_prefixes->second[i].second;
+                upstream = it_prefixes->first;
+            }
+        }
+    }
+    if(upstream > 0) return upstream;
+
+    //highest random weight (rendezvous) hashing, only the groups of a lost upstream move
+    unsigned int g_hash = hash_group(g_addr);
+    unsigned int best_weight = 0;
+    for(unsigned int i = 0; i < m_upstreams.size(); i++){
+        if(m_upstreams_down.find(m_upstreams[i]) != m_upstreams_down.end()) continue;
+        if((m_backup_upstreams.find(m_upstreams[i]) != m_backup_upstreams.end()) != use_backup) continue;
+
+        //FNV-1a of the group and the interface index with a final mix
+        unsigned int weight = g_hash;
+        for(unsigned int j = 0; j < sizeof(int); j++){
+            weight = (weight ^ ((m_upstreams[i] >> (8*j)) & 0xff)) * 16777619U;
+        }
+        weight ^= weight >> 16;
+        weight *= 0x85ebca6bU;
+        weight ^= weight >> 13;
+
+        if(upstream < 0 || weight > best_weight){
+            best_weight = weight;
+            upstream = m_upstreams[i];
+        }
+    }
+
+    return upstream;
+}
+
+//called for every group and prefix, it does not trace
+bool proxy_instance::is_in_prefix(const addr_storage& g_addr, const group_prefix& prefix){
+    if(g_addr.get_addr_family() != prefix.first.get_addr_family()) return false;
+
+    unsigned char g[sizeof(struct in6_addr)];
+    unsigned char p[sizeof(struct in6_addr)];
+    int addr_len;
+    if(g_addr.get_addr_family() == AF_INET){
+        struct in_addr tmp;
+        tmp <<= g_addr;
+        memcpy(g, &tmp, sizeof(tmp));
+        tmp <<= prefix.first;
+        memcpy(p, &tmp, sizeof(tmp));
+        addr_len = sizeof(tmp);
+    }else{
+        struct in6_addr tmp;
+        tmp <<= g_addr;
+        memcpy(g, &tmp, sizeof(tmp));
+        tmp <<= prefix.first;
+        memcpy(p, &tmp, sizeof(tmp));
+        addr_len = sizeof(tmp);
+    }
+
+    int bits = prefix.second;
+    for(int i = 0; i < addr_len && bits > 0; i++, bits -= 8){
+        unsigned char mask = (bits >= 8)? 0xff : (unsigned char)(0xff << (8 - bits));
+        if((g[i] & mask) != (p[i] & mask)) return false;
+    }
+    return true;
+}
+
+void proxy_instance::rebalance_upstreams(){
+    HC_LOG_TRACE("");
+
+    //leave the moved groups on there old upstream
+    map<int, vector<addr_storage> > tmp_leaves;
+    vector<addr_storage> tmp_moved;
+    map<addr_storage, int>::iterator it_group_upstream;
+    for(it_group_upstream = m_group_upstream.begin(); it_group_upstream != m_group_upstream.end(); it_group_upstream++){
+        if(get_upstream(it_group_upstream->first) != it_group_upstream->second){
+            tmp_leaves[it_group_upstream->second].push_back(it_group_upstream->first);
+            tmp_moved.push_back(it_group_upstream->first);
+        }
+    }
+
+    //the pending groups are joined again as soon as an upstream is running
+    set<addr_storage>::iterator it_pending;
+    for(it_pending = m_pending_upstream.begin(); it_pending != m_pending_upstream.end(); it_pending++){
+        if(get_upstream(*it_pending) > 0){
+            tmp_moved.push_back(*it_pending);
+        }
+    }
+    if(tmp_moved.empty()) return;
+    HC_LOG_DEBUG("move " << tmp_moved.size() << " groups to another upstream");
+
+    map<int, vector<addr_storage> >::iterator it_leaves;
+    for(it_leaves = tmp_leaves.begin(); it_leaves != tmp_leaves.end(); it_leaves++){
+        proxy_msg msg;
+        msg.type = proxy_msg::SENDER_MSG;
+        msg.msg = new struct sender_msg(sender_msg::LEAVE, this, it_leaves->first, it_leaves->second);
+        m_sender->add_msg(msg);
+    }
+
+    //rewrite the input interface of the known upstream sources, the routing module sends them in one batch,
+    //without a running upstream the routes of the old upstream are deleted, the sources of a pending group get there routes again
+    src_state_map::iterator iter_src;
+    for(unsigned int i = 0; i < tmp_moved.size(); i++){
+        upstream_src_state_map::iterator it_gss = m_upstream_state.find(tmp_moved[i]);
+        if(it_gss == m_upstream_state.end()) continue;
+
+        bool pending = m_pending_upstream.find(tmp_moved[i]) != m_pending_upstream.end();
+        int upstream = get_upstream(tmp_moved[i]);
+        int route_upstream = upstream;
+        if(upstream < 0 && (it_group_upstream = m_group_upstream.find(tmp_moved[i])) != m_group_upstream.end()){
+            route_upstream = it_group_upstream->second;
+        }
+
+        for(iter_src = it_gss->second.begin(); iter_src != it_gss->second.end(); iter_src++){
+            if(iter_src->second.flag != src_state::CACHED_SRC && !pending) continue;
+
+            if(upstream < 0 || !split_traffic(upstream, tmp_moved[i], iter_src->first)){
+                iter_src->second.flag = src_state::UNUSED_SRC;
+                del_route(route_upstream, tmp_moved[i], iter_src->first);
+            }
+        }
+    }
+
+    //join all moved groups with one report per upstream, groups without a running upstream stay pending
+    for(unsigned int i = 0; i < tmp_moved.size(); i++){
+        m_group_upstream.erase(tmp_moved[i]);
+    }
+    join_upstream(tmp_moved);
+
+    //the downstream sources are forwarded to the new upstream, or only to the other downstreams
+    state_table_map::iterator iter_table;
+    g_state_map::iterator iter_state;
+    for(iter_table = m_state_table.begin(); iter_table != m_state_table.end(); iter_table++){
+        for(unsigned int i = 0; i < tmp_moved.size(); i++){
+            if((iter_state = iter_table->second.find(tmp_moved[i])) == iter_table->second.end()) continue;
+
+            for(iter_src = iter_state->second.first.begin(); iter_src != iter_state->second.first.end(); iter_src++){
+                if(!split_traffic(iter_table->first, tmp_moved[i], iter_src->first) && iter_src->second.flag == src_state::CACHED_SRC){
+                    iter_src->second.flag = src_state::UNUSED_SRC;
+                    del_route(iter_table->first, tmp_moved[i], iter_src->first);
+                }
+            }
+        }
+    }
+}
+
+void proxy_instance::leave_group(int if_index, const addr_storage& host_addr, const addr_storage& g_addr){
+    HC_LOG_TRACE("");
+
+    //upstream leaves are uninteresting
+    if(is_upstream(if_index)) return;
+
+    //static groups are never queried or deleted
+    if(is_static_group(if_index, g_addr)) return;
+
+    map<int, g_host_map>::iterator it_hosts = m_hosts.find(if_index);
+    if(it_hosts != m_hosts.end()){
+        g_host_map::iterator it_g_hosts = it_hosts->second.find(g_addr);
+        if(it_g_hosts != it_hosts->second.end()){
+            it_g_hosts->second.erase(host_addr);
+
+            //IGMPv2 and MLDv1 hosts suppress their reports, only the last reporting host is known
+            if(it_g_hosts->second.empty() && m_fast_leave.find(if_index) != m_fast_leave.end()){
+                state_table_map::iterator iter_table = m_state_table.find(if_index);
+                if(iter_table == m_state_table.end()) return;
+
+                g_state_map::iterator iter_state = iter_table->second.find(g_addr);
+                if(iter_state != iter_table->second.end() && iter_state->second.second.flag != src_state::INIT){
+                    HC_LOG_DEBUG("fast leave if_index: " << if_index << " group: " << g_addr);
+                    del_group(if_index, g_addr);
+                    return;
+                }
+            }
+        }
+    }
+
+    //a non-querier follows the Group Specific Queries of the querier (RFC 2236 Section 6)
+    if(!is_querier(if_index)) return;
+
+    query_group(if_index, g_addr);
+}
+
+void proxy_instance::query_group(int if_index, const addr_storage& g_addr){
+    HC_LOG_TRACE("");
+
+    if(is_static_group(if_index, g_addr)) return;
+
+    state_table_map::iterator iter_table =m_state_table.find(if_index);
+    if(iter_table == m_state_table.end()) return;
+
+    g_state_map::iterator iter_state = iter_table->second.find(g_addr);
+    if(iter_state == iter_table->second.end()) return;
+    src_group_state_pair* sgs_pair = &iter_state->second;
+
+    sgs_pair->second.flag = src_state::RESPONSE_STATE;
+
+    proxy_msg msg;
+    msg.type = proxy_msg::CLOCK_MSG;
+    msg.msg = new struct clock_msg(clock_msg::SEND_GSQ, iter_table->first, iter_state->first);
+
+    if(m_addr_family == AF_INET){
+        sgs_pair->second.robustness_counter = MC_TV_LAST_MEMBER_QUERY_COUNT;
+
+        m_timing->add_time(MC_TV_LAST_MEMBER_QUERY_INTEVAL*1000 /*msec*/,this,msg);
+    }else if(m_addr_family== AF_INET6){
+        sgs_pair->second.robustness_counter = MC_TV_LAST_LISTENER_QUERY_COUNT;
+
+        m_timing->add_time(MC_TV_LAST_LISTENER_QUERY_INTERVAL*1000 /*msec*/,this,msg);
+    }else{
+        HC_LOG_ERROR("wrong addr_family: " << m_addr_family);
+    }
+}
+
+bool proxy_instance::is_static_group(int if_index, const addr_storage& g_addr){
+    HC_LOG_TRACE("");
+
+    map<int, set<addr_storage> >::iterator it_static = m_static_groups.find(if_index);
+    return it_static != m_static_groups.end() && it_static->second.find(g_addr) != it_static->second.end();
+}
+
+void proxy_instance::join_static_groups(int if_index){
+    HC_LOG_TRACE("");
+
+    vector<addr_storage> upstream_joins;
+    if(is_upstream(if_index)){
+        //the upstreams join the groups even without downstream members, there sources are known on the first join
+        set<addr_storage>::iterator it_g;
+        for(it_g = m_static_upstream.begin(); it_g != m_static_upstream.end(); it_g++){
+            upstream_joins.push_back(*it_g);
+        }
+    }else{
+        map<int, set<addr_storage> >::iterator it_static = m_static_groups.find(if_index);
+        if(it_static == m_static_groups.end()) return;
+
+        //a static group has no reporting host, it is joined like a report with an unspecified source
+        set<addr_storage>::iterator it_g;
+        for(it_g = it_static->second.begin(); it_g != it_static->second.end(); it_g++){
+            join_group(if_index, addr_storage(m_addr_family), *it_g, upstream_joins);
+        }
+    }
+    join_upstream(upstream_joins);
+}
+
+void proxy_instance::del_group(int if_index, const addr_storage& g_addr){
+    HC_LOG_TRACE("");
+
+    state_table_map::iterator iter_table =m_state_table.find(if_index);
+    if(iter_table == m_state_table.end()) return;
+
+    g_state_map::iterator iter_state = iter_table->second.find(g_addr);
+    if(iter_state == iter_table->second.end()) return;
+    src_group_state_pair* sgs_pair = &iter_state->second;
+
+    //refresh upstream
+    if(!is_group_joined(if_index,g_addr)){
+        leave_upstream(vector<addr_storage>(1, g_addr));
+    }
+
+    //del only if no FOREIGN_SRC available
+    if(sgs_pair->first.size() == 0){
+        iter_table->second.erase(iter_state);
+    }else{ //set groupstate to INIT
+        sgs_pair->second.flag = src_state::INIT;
+    }
+
+    map<int, g_host_map>::iterator it_hosts = m_hosts.find(if_index);
+    if(it_hosts != m_hosts.end()){
+        it_hosts->second.erase(g_addr);
+    }
+
+    //refresh routing
+    refresh_all_traffic(if_index, g_addr);
+}
+
+void proxy_instance::handle_downstream_query(struct receiver_msg* r){
+    HC_LOG_TRACE("");
+
+    if(m_state_table.find(r->if_index) == m_state_table.end()) return;
+
+    //queries with an unspecified source do not take part in the election, e.g. of snooping switches
+    addr_storage own_addr;
+    if(!(r->src_addr == addr_storage(m_addr_family)) && get_own_addr(r->if_index, own_addr) && r->src_addr < own_addr){
+        if(m_other_querier[r->if_index]++ == 0){
+            HC_LOG_DEBUG("other querier " << r->src_addr << " present on if_index: " << r->if_index << ", suppress own queries");
+        }
+
+        //each query restarts the timer, only the last reminder ends it
+        proxy_msg msg;
+        msg.type = proxy_msg::CLOCK_MSG;
+        msg.msg = new struct clock_msg(clock_msg::OTHER_QUERIER_PRESENT, r->if_index, r->src_addr);
+        m_timing->add_time(MC_TV_OTHER_QUERIER_PRESENT_INTERVAL*1000 /*msec*/,this,msg);
+    }
+
+    //a non-querier tracks the membership of a queried group like after a leave, but stays silent
+    if(!is_querier(r->if_index) && !(r->g_addr == addr_storage(m_addr_family))){
+        query_group(r->if_index, r->g_addr);
+    }
+}
+
+bool proxy_instance::is_querier(int if_index){
+    HC_LOG_TRACE("");
+
+    return m_other_querier.find(if_index) == m_other_querier.end();
+}
+
+bool proxy_instance::get_own_addr(int if_index, addr_storage& addr){
+    HC_LOG_TRACE("");
+
+    if_cache_snapshot snapshot = if_cache::getInstance()->get_snapshot();
+    const struct if_cache_entry* entry = if_cache::find(snapshot, if_index);
+    if(entry == NULL) return false;
+
+    if(m_addr_family == AF_INET){
+        if(entry->ipv4.empty()) return false;
+        addr = entry->ipv4[0].addr;
+        return true;
+    }else if(m_addr_family == AF_INET6){
+        //MLD messages are sent from the link-local address
+        for(unsigned int i = 0; i < entry->ipv6.size(); i++){
+            struct in6_addr tmp;
+            tmp <<= entry->ipv6[i].addr;
+            if(IN6_IS_ADDR_LINKLOCAL(&tmp)){
+                addr = entry->ipv6[i].addr;
+                return true;
+            }
+        }
+        return false;
+    }else{
+        HC_LOG_ERROR("wrong addr_family: " << m_addr_family);
+        return false;
+    }
+}
+
 void proxy_instance::handle_clock(struct clock_msg* c){
     HC_LOG_TRACE("");
 
@@ -316,33 +941,16 @@ void proxy_instance::handle_clock(struct clock_msg* c){
 
     switch(c->type){
     case clock_msg::SEND_GQ_TO_ALL: {
-        //send GQ
-        send_gq_to_all();
-
+        //the General Queries are staggered per downstream by SEND_GQ, they also age the groups
         m_check_source.check(); //reloade routing table
 
-        //##-- dekrement all counter of all groups on all downstream interfaces in RUNNING state --##
-        //##-- and dekrement all counter of all groups source addresses --##
+        //##-- dekrement all counter of all groups source addresses --##
         vector<addr_storage> tmp_erase_group_vector; //if group not joined and all sources are deleted
         for(iter_table= m_state_table.begin(); iter_table != m_state_table.end(); iter_table++){
 
             for(iter_state= iter_table->second.begin(); iter_state != iter_table->second.end(); iter_state++){
                 sgs_pair = &iter_state->second;
 
-                //-- process groups in RUNNING state --
-                if( sgs_pair->second.flag == src_state::RUNNING){
-                    //if counter == 0 delete this group after query response
-                    if(--sgs_pair->second.robustness_counter == 0){
-                        sgs_pair->second.flag= src_state::WAIT_FOR_DEL;
-                        sgs_pair->second.robustness_counter = PROXY_INSTANCE_DEL_IMMEDIATELY;
-
-                        msg.type = proxy_msg::CLOCK_MSG;
-                        msg.msg = new struct clock_msg(clock_msg::DEL_GROUP, iter_table->first, iter_state->first);
-                        m_timing->add_time(MC_TV_QUERY_RESPONSE_INTERVAL*1000 /*msec*/,this,msg);
-                    }
-                }
-
-
                 //-- process sources in FOREIGN_SRC state -downstream- --
                 vector<addr_storage> tmp_erase_source_vector;
                 for(iter_src = sgs_pair->first.begin(); iter_src != sgs_pair->first.end(); iter_src++){
@@ -406,6 +1014,25 @@ void proxy_instance::handle_clock(struct clock_msg* c){
 
 
 
+        //-- forget remembered upstream sources after there lifetime --
+        upstream_src_state_map::iterator it_last = m_last_sources.begin();
+        while(it_last != m_last_sources.end()){
+            iter_src = it_last->second.begin();
+            while(iter_src != it_last->second.end()){
+                if(--iter_src->second.robustness_counter <= 0){
+                    it_last->second.erase(iter_src++);
+                }else{
+                    iter_src++;
+                }
+            }
+
+            if(it_last->second.empty()){
+                m_last_sources.erase(it_last++);
+            }else{
+                it_last++;
+            }
+        }
+
         //-- process sources in FOREIGN_SRC state -upstream- --
         upstream_src_state_map::iterator tmp_it_up_ss_map;
         src_state_map* tmp_ss_map;
@@ -422,9 +1049,15 @@ void proxy_instance::handle_clock(struct clock_msg* c){
                         //save invalid sources
                         tmp_erase_source_vector.push_back(iter_src->first);
 
+                        //remember the source for the next join of the group
+                        if(m_remember_sources){
+                            m_last_sources[tmp_it_up_ss_map->first][iter_src->first] = src_state(PROXY_INSTANCE_LAST_SOURCES_LIFETIME, src_state::UNUSED_SRC);
+                        }
+
                         //refresh routing
                         if(iter_src->second.flag == src_state::CACHED_SRC){
-                            del_route(m_upstream, tmp_it_up_ss_map->first, iter_src->first);
+                            map<addr_storage, int>::iterator it_group_upstream = m_group_upstream.find(tmp_it_up_ss_map->first);
+                            del_route((it_group_upstream == m_group_upstream.end())? get_upstream(tmp_it_up_ss_map->first) : it_group_upstream->second, tmp_it_up_ss_map->first, iter_src->first);
                         }
 
                     }
@@ -472,7 +1105,9 @@ void proxy_instance::handle_clock(struct clock_msg* c){
 
         sgs_pair = &iter_state->second;
         if(sgs_pair->second.flag == src_state::RESPONSE_STATE){
-            m_sender->send_group_specific_query(c->if_index,c->g_addr);
+            if(is_querier(c->if_index)){
+                m_due_gsq.push_back(pair<int, addr_storage>(c->if_index, c->g_addr));
+            }
 
             if(--sgs_pair->second.robustness_counter == PROXY_INSTANCE_DEL_IMMEDIATELY){
                 sgs_pair->second.flag = src_state::WAIT_FOR_DEL;
@@ -513,29 +1148,87 @@ void proxy_instance::handle_clock(struct clock_msg* c){
         sgs_pair = &iter_state->second;
         if(sgs_pair->second.flag == src_state::WAIT_FOR_DEL){
             HC_LOG_DEBUG("DEL_GROUP if_index: " << c->if_index << " group: " << c->g_addr);
+            del_group(c->if_index, c->g_addr);
+        }
 
-            //refresh upstream
-            if(!is_group_joined(c->if_index,c->g_addr)){
-                if(!m_sender->send_leave(m_upstream, c->g_addr)){
-                    HC_LOG_ERROR("failed to leave on upstream group: " << c->g_addr);
-                }
-            }
+        break;
+    }
+    case clock_msg::SEND_GQ: {
+        //the first shard sends the queries and passes them on, the other shards only age there groups
+        if(m_shard > 0){
+            age_groups(c->if_index);
+            return;
+        }
 
-            //del only if no FOREIGN_SRC available
-            if(sgs_pair->first.size() == 0){
-                iter_table->second.erase(iter_state);
-            }else{ //set groupstate to INIT
-                sgs_pair->second.flag = src_state::INIT;
-            }
+        map<int, bool>::iterator it_timer = m_gq_timer.find(c->if_index);
+        if(it_timer == m_gq_timer.end()) return;
 
-            //refresh routing
-            //cout << "in del group: refresh_all_traffic()..." << endl;
-            refresh_all_traffic(c->if_index, c->g_addr);
+        //the timer of a deleted downstream ends
+        if(m_state_table.find(c->if_index) == m_state_table.end()){
+            m_gq_timer.erase(it_timer);
+            return;
+        }
+
+        //the queries are suppressed while another querier is present
+        if(is_querier(c->if_index)){
+            msg.type = proxy_msg::SENDER_MSG;
+            msg.msg = new struct sender_msg(sender_msg::SEND_GQ, vector<int>(1, c->if_index));
+            m_sender->add_msg(msg);
+        }
+
+        age_groups(c->if_index);
+        for(unsigned int i = 1; i < m_shards.size(); i++){
+            msg.type = proxy_msg::CLOCK_MSG;
+            msg.msg = new struct clock_msg(clock_msg::SEND_GQ, c->if_index, c->g_addr);
+            m_shards[i]->add_msg(msg);
+        }
+
+        //the first query is staggered over the Startup Query Interval, the following ones over the Query Interval
+        int next = MC_TV_QUERY_INTERVAL*1000; //msec
+        if(!it_timer->second){
+            it_timer->second = true;
+            next += (int)(get_gq_phase(c->if_index) * (MC_TV_QUERY_INTERVAL - MC_TV_STARTUP_QUERY_INTERVAL)*1000);
+        }
+        if(m_gq_jitter > 0){
+            next += rand() % (2*m_gq_jitter + 1) - m_gq_jitter;
         }
 
+        msg.type = proxy_msg::CLOCK_MSG;
+        msg.msg = new struct clock_msg(clock_msg::SEND_GQ, c->if_index, c->g_addr);
+        m_timing->add_time(next /*msec*/,this,msg);
+        break;
+    }
+    case clock_msg::SEND_REPORT: {
+        msg.type = proxy_msg::SENDER_MSG;
+        if(c->g_addr == addr_storage(m_addr_family)){ //General Query
+            m_gq_response_pending.erase(c->if_index);
+
+            msg.msg = new struct sender_msg(sender_msg::SEND_CURRENT_STATE, this, c->if_index, vector<addr_storage>());
+        }else{
+            msg.msg = new struct sender_msg(sender_msg::SEND_CURRENT_STATE, this, c->if_index, vector<addr_storage>(1, c->g_addr));
+        }
+        m_sender->add_msg(msg);
+
+        break;
+    }
+    case clock_msg::OTHER_QUERIER_PRESENT: {
+        map<int, int>::iterator it = m_other_querier.find(c->if_index);
+        if(it == m_other_querier.end()) return;
+
+        //the last reminder expired, no query of the other querier was received in the meantime
+        if(--it->second == 0){
+            m_other_querier.erase(it);
+            HC_LOG_DEBUG("other querier " << c->g_addr << " expired on if_index: " << c->if_index << ", become querier");
+
+            //every shard takes part in the election, the first one sends the queries
+            if(m_shard == 0){
+                msg.type = proxy_msg::SENDER_MSG;
+                msg.msg = new struct sender_msg(sender_msg::SEND_GQ, vector<int>(1, c->if_index));
+                m_sender->add_msg(msg);
+            }
+        }
         break;
     }
-    case clock_msg::SEND_GQ: break; //start up Query Interval vor new interfaces
     default: HC_LOG_ERROR("unknown clock message foramt");
     }
 }
@@ -554,6 +1247,9 @@ void proxy_instance::handle_config(struct config_msg* c){
         m_state_table.insert(state_tabel_pair(c->if_index,g_state_map()));
         m_vif_map.insert(vif_pair(c->if_index,c->vif));
         registrate_if(c->if_index);
+
+        //a downstream that comes back joins its static groups again
+        join_static_groups(c->if_index);
         break;
     }
     case config_msg::DEL_DOWNSTREAM: {
@@ -563,6 +1259,8 @@ void proxy_instance::handle_config(struct config_msg* c){
         }
 
         unregistrate_if(c->if_index);
+        m_other_querier.erase(c->if_index);
+        m_hosts.erase(c->if_index);
 
         state_table_map::iterator iter_table;
         g_state_map::iterator iter_state;
@@ -576,6 +1274,7 @@ void proxy_instance::handle_config(struct config_msg* c){
         }
 
         vector<addr_storage> tmp_erase_group_vector;
+        vector<addr_storage> tmp_leave_group_vector;
         for(iter_state= iter_table->second.begin(); iter_state != iter_table->second.end(); iter_state++){
             sgs_pair = &iter_state->second;
 
@@ -591,12 +1290,12 @@ void proxy_instance::handle_config(struct config_msg* c){
 
             //refresh upstream
             if(!is_group_joined(c->if_index,iter_state->first)){
-                if(!m_sender->send_leave(m_upstream, iter_state->first)){
-                    HC_LOG_ERROR("failed to leave on upstream group: " << iter_state->first);
-                }
+                tmp_leave_group_vector.push_back(iter_state->first);
             }
         }
 
+        leave_upstream(tmp_leave_group_vector);
+
         //erase all groups
         for(unsigned int i=0; i< tmp_erase_group_vector.size(); i++){
             if((iter_state = iter_table->second.find(tmp_erase_group_vector[i]))!= iter_table->second.end()){
@@ -647,6 +1346,103 @@ void proxy_instance::handle_config(struct config_msg* c){
 
         break;
     }
+    case config_msg::ADD_UPSTREAM: {
+        bool new_upstream = !is_upstream(c->if_index);
+        bool was_down = (m_upstreams_down.erase(c->if_index) > 0);
+
+        if(new_upstream){
+            m_upstreams.push_back(c->if_index);
+        }
+        m_vif_map[c->if_index] = c->vif;
+        if(new_upstream || was_down){
+            registrate_if(c->if_index);
+        }
+
+        if(new_upstream && m_raw_membership){
+            proxy_msg msg;
+            msg.type = proxy_msg::SENDER_MSG;
+            msg.msg = new struct sender_msg(sender_msg::SET_RAW_MEMBERSHIP, this, c->if_index, true);
+            m_sender->add_msg(msg);
+        }
+
+        if(c->prefixes.empty()){
+            m_upstream_prefixes.erase(c->if_index);
+        }else{
+            m_upstream_prefixes[c->if_index] = c->prefixes;
+        }
+
+        rebalance_upstreams();
+        break;
+    }
+    case config_msg::DEL_UPSTREAM: {
+        if(!is_upstream(c->if_index) || !m_upstreams_down.insert(c->if_index).second){
+            HC_LOG_ERROR("failed to del upstream, interface " << c->if_index << " not exist or allready down");
+            break;
+        }
+
+        //move the groups before the vif is removed
+        rebalance_upstreams();
+        unregistrate_if(c->if_index);
+        break;
+    }
+    case config_msg::SET_BACKUP_UPSTREAM: {
+        if(!is_upstream(c->if_index)){
+            HC_LOG_ERROR("failed to set backup upstream, interface " << c->if_index << " is no upstream");
+            break;
+        }
+
+        m_backup_upstreams.insert(c->if_index);
+        rebalance_upstreams();
+        break;
+    }
+    case config_msg::STATIC_GROUPS: {
+        //a shard keeps the groups of its partition
+        vector<addr_storage> tmp_g_addrs;
+        for(unsigned int i = 0; i < c->g_addrs.size(); i++){
+            if(get_group_shard(c->g_addrs[i], get_shard_count()) == m_shard){
+                tmp_g_addrs.push_back(c->g_addrs[i]);
+            }
+        }
+
+        //kept over a DEL_DOWNSTREAM like SET_FAST_LEAVE
+        if(is_upstream(c->if_index)){
+            //joined groups are already joined by an upstream
+            vector<addr_storage> tmp_joins;
+            for(unsigned int i = 0; i < tmp_g_addrs.size(); i++){
+                if(!is_group_joined(c->if_index, tmp_g_addrs[i])){
+                    tmp_joins.push_back(tmp_g_addrs[i]);
+                }
+                m_static_upstream.insert(tmp_g_addrs[i]);
+            }
+            join_upstream(tmp_joins);
+        }else if(m_state_table.find(c->if_index) != m_state_table.end()){
+            m_static_groups[c->if_index].insert(tmp_g_addrs.begin(), tmp_g_addrs.end());
+            join_static_groups(c->if_index);
+        }else{
+            HC_LOG_ERROR("failed to set static groups, interface " << c->if_index << " not exist");
+        }
+        break;
+    }
+    case config_msg::SET_FAST_LEAVE: {
+        //kept over a DEL_DOWNSTREAM, the interface may come back
+        m_fast_leave.insert(c->if_index);
+        break;
+    }
+    case config_msg::CHANGE_ADDR: {
+        if(m_vif_map.find(c->if_index) == m_vif_map.end()){
+            HC_LOG_DEBUG("address changed on unregistered interface: " << c->if_index);
+            break;
+        }
+
+        //the hosts know the old querier address, query them from the new one
+        if(!is_upstream(c->if_index) && m_shard == 0){
+            proxy_msg msg;
+            msg.type = proxy_msg::SENDER_MSG;
+            msg.msg = new struct sender_msg(sender_msg::SEND_GQ, vector<int>(1, c->if_index));
+            m_sender->add_msg(msg);
+        }
+        break;
+    }
     default: HC_LOG_ERROR("unknown config message format");
     }
 }
@@ -662,14 +1458,27 @@ void proxy_instance::handle_debug_msg(struct debug_msg* db){
     upstream_src_state_map::iterator iter_up_src_state;
 
 
-    char cstr[IF_NAMESIZE];
-    string if_name(if_indextoname(m_upstream,cstr));
+    if_cache* cache = if_cache::getInstance();
+    string if_name(cache->get_name(m_upstream));
 
     if((iter_vif = m_vif_map.find(m_upstream))== m_vif_map.end()){
         HC_LOG_ERROR("failed to find vif to upstream if_index:" << m_upstream);
         return;
     }
-    str << "##-- instance upstream " << if_name << " [vif=" << iter_vif->second<< "] --##" << endl;
+    str << "##-- instance upstream " << if_name << " [vif=" << iter_vif->second<< "]";
+    if(get_shard_count() > 1){
+        str << " [shard " << m_shard + 1 << "/" << get_shard_count() << "]";
+    }
+    str << (m_backup_upstreams.find(m_upstream) == m_backup_upstreams.end()? "" : " [backup]") << (m_upstreams_down.find(m_upstream) == m_upstreams_down.end()? "" : " [down]") << " --##" << endl;
+
+    //more upstreams share the groups of this instance
+    for(unsigned int i = 1; i < m_upstreams.size(); i++){
+        if((iter_vif = m_vif_map.find(m_upstreams[i]))== m_vif_map.end()){
+            HC_LOG_ERROR("failed to find vif to upstream if_index:" << m_upstreams[i]);
+            return;
+        }
+        str << "\t-- upstream " << cache->get_name(m_upstreams[i]) << " [vif=" << iter_vif->second << "]" << (m_backup_upstreams.find(m_upstreams[i]) == m_backup_upstreams.end()? "" : " [backup]") << (m_upstreams_down.find(m_upstreams[i]) == m_upstreams_down.end()? "" : " [down]") << " --" << endl;
+    }
 
     if(db->get_level_of_detail() > debug_msg::LESS){
 
@@ -680,7 +1489,12 @@ void proxy_instance::handle_debug_msg(struct debug_msg* db){
             int tmp_g_counter=0;
             for(iter_up_src_state= m_upstream_state.begin(); iter_up_src_state !=m_upstream_state.end(); iter_up_src_state++){
                 src_state_map* tmp_src_state_map = &iter_up_src_state->second;
-                str << "\t[" << tmp_g_counter++ << "] " <<iter_up_src_state->first << "\t" << endl;
+                str << "\t[" << tmp_g_counter++ << "] " <<iter_up_src_state->first << "\t" << (m_static_upstream.find(iter_up_src_state->first) == m_static_upstream.end()? "" : "[static]");
+                if(m_upstreams.size() > 1){
+                    int upstream = get_upstream(iter_up_src_state->first);
+                    str << "[" << ((upstream < 0)? "none" : cache->get_name(upstream)) << "]";
+                }
+                str << endl;
 
                 int tmp_s_counter=0;
                 if(db->get_level_of_detail() > debug_msg::MORE){
@@ -698,23 +1512,29 @@ void proxy_instance::handle_debug_msg(struct debug_msg* db){
 
         //downstream output
         for(iter_table= m_state_table.begin(); iter_table != m_state_table.end(); iter_table++){
-            if_name = if_indextoname(iter_table->first,cstr);
+            if_name = cache->get_name(iter_table->first);
 
             if((iter_vif = m_vif_map.find(iter_table->first))== m_vif_map.end()){
                 HC_LOG_ERROR("failed to find vif to downstream if_index:" << iter_table->first);
                 return;
             }
 
-            str << "\t-- downstream " << if_name << " [vif=" << iter_vif->second << "] --" << endl;
+            str << "\t-- downstream " << if_name << " [vif=" << iter_vif->second << "]" << (is_querier(iter_table->first)? "" : " [non-querier]") << (m_fast_leave.find(iter_table->first) == m_fast_leave.end()? "" : " [fast-leave]") << " --" << endl;
 
             if(db->get_level_of_detail() > debug_msg::NORMAL){
 
-                str << "\t\tgroup addr | robustness_counter | flag" << endl;
+                str << "\t\tgroup addr | robustness_counter | flag | hosts" << endl;
 
+                map<int, g_host_map>::iterator tmp_it_if_hosts = m_hosts.find(iter_table->first);
                 int tmp_g_counter=0;
                 for(iter_state= iter_table->second.begin(); iter_state != iter_table->second.end(); iter_state++){
                     src_group_state_pair* tmp_gsp = &iter_state->second;
-                    str << "\t\t[" << tmp_g_counter++ << "] " <<iter_state->first << "\t"  << tmp_gsp->second.robustness_counter << "\t" << tmp_gsp->second.state_type_to_string() << endl;
+                    unsigned int tmp_host_count = 0;
+                    if(tmp_it_if_hosts != m_hosts.end()){
+                        g_host_map::iterator tmp_it_hosts = tmp_it_if_hosts->second.find(iter_state->first);
+                        if(tmp_it_hosts != tmp_it_if_hosts->second.end()) tmp_host_count = tmp_it_hosts->second.size();
+                    }
+                    str << "\t\t[" << tmp_g_counter++ << "] " <<iter_state->first << "\t"  << tmp_gsp->second.robustness_counter << "\t" << tmp_gsp->second.state_type_to_string() << "\t" << tmp_host_count << (is_static_group(iter_table->first, iter_state->first)? "\t[static]" : "") << endl;
 
                     int tmp_s_counter=0;
                     if(db->get_level_of_detail() > debug_msg::MORE){
@@ -735,20 +1555,84 @@ void proxy_instance::handle_debug_msg(struct debug_msg* db){
     db->add_debug_msg(str.str());
 }
 
-bool proxy_instance::send_gq_to_all(){
+void proxy_instance::schedule_first_gq(int if_index){
     HC_LOG_TRACE("");
-    HC_LOG_DEBUG("send general query to all");
-    bool correct= true;
 
-    state_table_map::iterator it_state_table;
-    for(it_state_table= m_state_table.begin(); it_state_table != m_state_table.end(); it_state_table++){
-        if(!m_sender->send_general_query(it_state_table->first)){
-            HC_LOG_ERROR("failed to send general to if_index: " << it_state_table->first);
-            correct = false;
+    //a downstream that is added again keeps its running timer
+    if(m_gq_timer.find(if_index) != m_gq_timer.end()) return;
+    m_gq_timer[if_index] = false;
+
+    proxy_msg msg;
+    msg.type = proxy_msg::CLOCK_MSG;
+    msg.msg = new struct clock_msg(clock_msg::SEND_GQ, if_index, addr_storage(m_addr_family));
+    m_timing->add_time((int)(get_gq_phase(if_index) * MC_TV_STARTUP_QUERY_INTERVAL*1000) /*msec*/,this,msg);
+}
+
+double proxy_instance::get_gq_phase(int if_index){
+    HC_LOG_TRACE("");
+
+    //the golden ratio spreads consecutive interface indexes of all proxy instances evenly
+    double phase = if_index * 0.6180339887;
+    return phase - (long)phase;
+}
+
+void proxy_instance::age_groups(int if_index){
+    HC_LOG_TRACE("");
+
+    state_table_map::iterator iter_table = m_state_table.find(if_index);
+    if(iter_table == m_state_table.end()) return;
+
+    //hosts that did not report since the last queries are forgotten
+    g_host_map& hosts = m_hosts[if_index];
+    g_host_map::iterator it_g_hosts = hosts.begin();
+    while(it_g_hosts != hosts.end()){
+        host_map::iterator it_host = it_g_hosts->second.begin();
+        while(it_host != it_g_hosts->second.end()){
+            if(--it_host->second == 0){
+                it_g_hosts->second.erase(it_host++);
+            }else{
+                it_host++;
+            }
+        }
+
+        if(it_g_hosts->second.empty()){
+            hosts.erase(it_g_hosts++);
+        }else{
+            it_g_hosts++;
+        }
+    }
+
+    g_state_map::iterator iter_state;
+    for(iter_state= iter_table->second.begin(); iter_state != iter_table->second.end(); iter_state++){
+        src_group_state_pair* sgs_pair = &iter_state->second;
+
+        //-- process groups in RUNNING state, static groups are never aged --
+        if( sgs_pair->second.flag == src_state::RUNNING && !is_static_group(if_index, iter_state->first)){
+            //if counter == 0 delete this group after query response
+            if(--sgs_pair->second.robustness_counter == 0){
+                sgs_pair->second.flag= src_state::WAIT_FOR_DEL;
+                sgs_pair->second.robustness_counter = PROXY_INSTANCE_DEL_IMMEDIATELY;
+
+                proxy_msg msg;
+                msg.type = proxy_msg::CLOCK_MSG;
+                msg.msg = new struct clock_msg(clock_msg::DEL_GROUP, iter_table->first, iter_state->first);
+                m_timing->add_time(MC_TV_QUERY_RESPONSE_INTERVAL*1000 /*msec*/,this,msg);
+            }
         }
     }
+}
+
+bool proxy_instance::send_due_gsq(){
+    HC_LOG_TRACE("");
+    HC_LOG_DEBUG("send " << m_due_gsq.size() << " group specific queries");
+
+    proxy_msg msg;
+    msg.type = proxy_msg::SENDER_MSG;
+    msg.msg = new struct sender_msg(sender_msg::SEND_GSQ, m_due_gsq);
+    m_sender->add_msg(msg);
+    m_due_gsq.clear();
 
-    return correct;
+    return true;
 }
 
 /*void proxy_instance::split_traffic(int if_index, addr_storage g_addr){
@@ -786,7 +1670,7 @@ bool proxy_instance::send_gq_to_all(){
      cout << endl; //???????????????????????????????
 
 
-     if(if_index == m_upstream){
+     if(is_upstream(if_index)){
           iter_uss_map = m_upstream_state.find(g_addr);
           if(iter_uss_map == m_upstream_state.end()){
                HC_LOG_ERROR("cant find g_addr:" << g_addr << " for upstream if_index:" << if_index);
@@ -838,7 +1722,9 @@ bool proxy_instance::split_traffic(int if_index, const addr_storage& g_addr, con
     //find all downstream interaces who join this group and if if_index is not a upstream add upstream vif
     add_all_group_vifs_to_list(&vif_list, if_index, g_addr);
     //cout << "split_traffic: haben wieviele vifs gefunden: " << vif_list.size() << endl;
-    if(vif_list.size() == 0) return false; //if nobody join this group ignore
+    //if nobody join this group ignore, sources of a static upstream group get a route without outputs
+    //the kernel drops there packets without upcalls and they stay known for the first join
+    if(vif_list.size() == 0 && (!is_upstream(if_index) || m_static_upstream.find(g_addr) == m_static_upstream.end())) return false;
 
 
     msg.type = proxy_msg::ROUTING_MSG;
@@ -847,7 +1733,7 @@ bool proxy_instance::split_traffic(int if_index, const addr_storage& g_addr, con
 
 
     //set source to flag CACHED_SRC
-    if(if_index == m_upstream){ //upstream source
+    if(is_upstream(if_index)){ //upstream source
         upstream_src_state_map::iterator it_gss = m_upstream_state.find(g_addr);
         if(it_gss == m_upstream_state.end()){
             HC_LOG_ERROR("CACHE_MISS refresh routing: failed to find upstream g_addr:" << g_addr);
@@ -907,15 +1793,17 @@ void proxy_instance::refresh_all_traffic(int if_index, const addr_storage& g_add
     g_state_map::iterator iter_state;
     src_group_state_pair* sgs_pair = 0;
 
-    if(if_index == m_upstream){
+    if(is_upstream(if_index)){
         HC_LOG_ERROR("the if_index:" << if_index << " mussnt be the upstream, upstream have no joined groups");
     }
 
     //process upstream
+    //without a running upstream the upstream sources have no route
+    int upstream = get_upstream(g_addr);
     iter_uss = m_upstream_state.find(g_addr);
-    if(iter_uss != m_upstream_state.end()){ //g_addr found
+    if(iter_uss != m_upstream_state.end() && upstream > 0){ //g_addr found
         for(iter_src = iter_uss->second.begin(); iter_src != iter_uss->second.end(); iter_src++){
-            if(!split_traffic(m_upstream, g_addr, iter_src->first)){
+            if(!split_traffic(upstream, g_addr, iter_src->first)){
                 //have to check old upstream source because the have no default stream so they dont refresh themselve like downstreams
                 iter_src->second.flag = src_state::UNUSED_SRC;
                 del_route(if_index,g_addr,iter_src->first);
@@ -949,11 +1837,12 @@ void proxy_instance::add_all_group_vifs_to_list(std::list<int>* vif_list, int wi
     g_state_map::iterator iter_state;
     src_group_state_pair* sgs_pair = 0;
 
-    //all downstream traffic musst be forward to upstream
-    if(without_if_index != m_upstream){
-        it_vif_map = m_vif_map.find(m_upstream);
+    //all downstream traffic musst be forward to the upstream of the group, if an upstream is running
+    int upstream = is_upstream(without_if_index)? -1 : get_upstream(g_addr);
+    if(upstream > 0){
+        it_vif_map = m_vif_map.find(upstream);
         if(it_vif_map == m_vif_map.end()){
-            HC_LOG_ERROR("cant find vif to if_index:" << m_upstream);
+            HC_LOG_ERROR("cant find vif to if_index:" << upstream);
             return;
         }
         vif_list->push_back(it_vif_map->second);
@@ -994,46 +1883,45 @@ void proxy_instance::registrate_if(int if_index){
     }
     int vif = it_vif_map->second;
 
+    //##-- receiver --##
+    m_receiver->registrate_interface(if_index, vif, this);
+
+    //the first shard owns the interfaces
+    if(m_shard > 0) return;
+
     //##-- routing --##
     proxy_msg m;
     m.type = proxy_msg::ROUTING_MSG;
     m.msg = new struct routing_msg(routing_msg::ADD_VIF, if_index, vif);
     m_routing->add_msg(m);
 
-    //##-- receiver --##
-    m_receiver->registrate_interface(if_index, vif, this);
-
-    if(if_index != m_upstream){
+    if(!is_upstream(if_index)){
 
         //##-- sender --##
         //join all_router_addr at all downstreams
+        vector<addr_storage> mc_router_addrs;
         if(m_addr_family == AF_INET){
-            addr_storage mc_router_addr(IPV4_ALL_IGMP_ROUTERS_ADDR);
-            if(!m_sender->send_report(if_index, mc_router_addr)){
-                HC_LOG_ERROR("failed to join: ==> " << IPV4_ALL_IGMP_ROUTERS_ADDR);
+            mc_router_addrs.push_back(addr_storage(IPV4_ALL_IGMP_ROUTERS_ADDR));
+            if(m_version == 3){ //IGMPv3 reports are sent to this group
+                mc_router_addrs.push_back(addr_storage(IPV4_IGMPV3_ADDR));
             }
         }else if(m_addr_family == AF_INET6){
-            addr_storage mc_router_addr(IPV6_ALL_LINK_LOCAL_ROUTER);
-            if(!m_sender->send_report(if_index, mc_router_addr )){
-                HC_LOG_ERROR("failed to join: ==> " << mc_router_addr);
-            }
-
-            mc_router_addr= IPV6_ALL_SITE_LOCAL_ROUTER;
-            if(!m_sender->send_report(if_index, mc_router_addr )){
-                HC_LOG_ERROR("failed to join: ==> " << mc_router_addr);
+            mc_router_addrs.push_back(addr_storage(IPV6_ALL_LINK_LOCAL_ROUTER));
+            mc_router_addrs.push_back(addr_storage(IPV6_ALL_SITE_LOCAL_ROUTER));
+            if(m_version == 2){ //MLDv2 reports are sent to this group
+                mc_router_addrs.push_back(addr_storage(IPV6_ALL_MLDv2_CAPABLE_ROUTERS));
             }
-
-            HC_LOG_WARN("untesteted");
         }else{
             HC_LOG_ERROR("wrong addr_family: " << m_addr_family);
             return;
         }
 
-        //send the first GQ
-        if(!m_sender->send_general_query(if_index)){
-            HC_LOG_ERROR("failed to send general to if_index: " << if_index);
-            return;
-        }
+        m.type = proxy_msg::SENDER_MSG;
+        m.msg = new struct sender_msg(sender_msg::JOIN, this, if_index, mc_router_addrs);
+        m_sender->add_msg(m);
+
+        //the first GQ is staggered with the other downstreams
+        schedule_first_gq(if_index);
     }
 }
 
@@ -1047,46 +1935,46 @@ void proxy_instance::unregistrate_if(int if_index){
     }
     int vif = it_vif_map->second;
 
+    //##-- receiver --##
+    m_receiver->del_interface(if_index, vif, this);
+
+    //the first shard owns the interfaces
+    if(m_shard > 0) return;
+
     //##-- routing --##
     proxy_msg m;
     m.type = proxy_msg::ROUTING_MSG;
     m.msg = new struct routing_msg(routing_msg::DEL_VIF,if_index, vif);
     m_routing->add_msg(m);
 
-    //##-- receiver --##
-    m_receiver->del_interface(if_index, vif);
-
     //##-- timing --##
     //remove all running times
     //m_timing->stop_all_time(this);
 
-    if(if_index != m_upstream){
+    if(!is_upstream(if_index)){
 
         //##-- sender --##
         //leave all router addr at all downstreams
+        vector<addr_storage> mc_router_addrs;
         if(m_addr_family == AF_INET){
-            addr_storage mc_router_addr(IPV4_ALL_IGMP_ROUTERS_ADDR);
-            if(!m_sender->send_leave(if_index, mc_router_addr )){
-                HC_LOG_ERROR("failed to leave: ==> " << mc_router_addr);
+            mc_router_addrs.push_back(addr_storage(IPV4_ALL_IGMP_ROUTERS_ADDR));
+            if(m_version == 3){ //IGMPv3 reports are sent to this group
+                mc_router_addrs.push_back(addr_storage(IPV4_IGMPV3_ADDR));
             }
         }else if(m_addr_family == AF_INET6){
-            addr_storage mc_router_addr(IPV6_ALL_LINK_LOCAL_ROUTER);
-            if(!m_sender->send_leave(if_index, mc_router_addr )){
-                HC_LOG_ERROR("failed to leave: ==> " << mc_router_addr);
-            }
-
-            mc_router_addr=IPV6_ALL_SITE_LOCAL_ROUTER;
-            if(!m_sender->send_leave(if_index, mc_router_addr )){
-                HC_LOG_ERROR("failed to leave: ==> " << mc_router_addr);
+            mc_router_addrs.push_back(addr_storage(IPV6_ALL_LINK_LOCAL_ROUTER));
+            mc_router_addrs.push_back(addr_storage(IPV6_ALL_SITE_LOCAL_ROUTER));
+            if(m_version == 2){ //MLDv2 reports are sent to this group
+                mc_router_addrs.push_back(addr_storage(IPV6_ALL_MLDv2_CAPABLE_ROUTERS));
             }
-
-            HC_LOG_WARN("untesteted");
         }else{
             HC_LOG_ERROR("wrong addr_family: " << m_addr_family);
             return;
         }
 
-
+        m.type = proxy_msg::SENDER_MSG;
+        m.msg = new struct sender_msg(sender_msg::LEAVE, this, if_index, mc_router_addrs);
+        m_sender->add_msg(m);
     }
 
 }
@@ -1098,6 +1986,9 @@ bool proxy_instance::is_group_joined(int without_if_index, const addr_storage& g
     g_state_map::iterator iter_state;
     src_group_state_pair* sgs_pair = 0;
 
+    //the upstream never leaves its static groups
+    if(m_static_upstream.find(g_addr) != m_static_upstream.end()) return true;
+
     //process downstream
     for(iter_table = m_state_table.begin(); iter_table != m_state_table.end(); iter_table++){
         if(without_if_index != iter_table->first){
@@ -1120,5 +2011,4 @@ bool proxy_instance::is_group_joined(int without_if_index, const addr_storage& g
 void proxy_instance::close(){
     HC_LOG_TRACE("");
 
-    delete m_sender;
 }
@@ -22,6 +22,7 @@
 
 #include "include/hamcast_logging.h"
 #include "include/proxy/receiver.hpp"
+#include "include/proxy/proxy_instance.hpp"
 
 #include <iostream>
 using namespace std;
@@ -42,16 +43,6 @@ void receiver::close(){
      delete m_worker_thread;
 }
 
-bool receiver::init_if_prop(){
-     HC_LOG_TRACE("");
-
-     //if(!m_if_prop.init_IfInfo()) return false;
-     //if(!m_if_prop.refresh_network_interfaces()) return false;
-     m_if_property.refresh_network_interfaces();
-
-     return true;
-}
-
 bool receiver::init(int addr_family, int version, mroute_socket* mrt_sock){
      HC_LOG_TRACE("");
 
@@ -59,7 +50,6 @@ bool receiver::init(int addr_family, int version, mroute_socket* mrt_sock){
      m_version =  version;
      m_mrt_sock = mrt_sock;
 
-     if(!init_if_prop()) return false;
      if(!m_mrt_sock->set_receive_timeout(RECEIVER_RECV_TIMEOUT)) return false;
      //if(!m_mrt_sock->setLoopBack(true)) return false;
 
@@ -70,9 +60,71 @@ proxy_instance* receiver::get_proxy_instance(int if_index){
      HC_LOG_TRACE("");
      if_poxy_instance_map::iterator it=  m_if_proxy_map.find(if_index);
      if(it != m_if_proxy_map.end()){
-          return it->second;
+          for(unsigned int i = 0; i < it->second.size(); i++){
+               if(it->second[i] != NULL) return it->second[i];
+          }
+     }
+     return NULL;
+}
+
+void receiver::send_to_shard(int if_index, const addr_storage& g_addr, proxy_msg& m){
+     HC_LOG_TRACE("");
+
+     if_poxy_instance_map::iterator it=  m_if_proxy_map.find(if_index);
+     if(it == m_if_proxy_map.end()) return;
+     std::vector<proxy_instance*>& shards = it->second;
+
+     if(shards.size() == 1){
+          shards[0]->add_msg(m);
+     }else if(g_addr == addr_storage(m_addr_family)){ //General Query
+          for(unsigned int i = 0; i < shards.size(); i++){
+               if(shards[i] != NULL) shards[i]->add_msg(m);
+          }
      }else{
-          return NULL;
+          proxy_instance* p = shards[proxy_instance::get_group_shard(g_addr, shards.size())];
+          if(p != NULL) p->add_msg(m);
+     }
+}
+
+void receiver::send_records_to_shards(struct receiver_msg* r_msg){
+     HC_LOG_TRACE("");
+
+     proxy_msg m;
+     m.type = proxy_msg::RECEIVER_MSG;
+
+     if_poxy_instance_map::iterator it=  m_if_proxy_map.find(r_msg->if_index);
+     if(it == m_if_proxy_map.end()){
+          delete r_msg;
+          return;
+     }
+     std::vector<proxy_instance*>& shards = it->second;
+
+     if(shards.size() == 1){
+          m.msg = r_msg;
+          shards[0]->add_msg(m);
+          return;
+     }
+
+     //every shard gets the records of its groups in one message
+     std::vector<struct receiver_msg*> tmp_msgs(shards.size(), (struct receiver_msg*)NULL);
+     for(unsigned int i = 0; i < r_msg->records.size(); i++){
+          int shard = proxy_instance::get_group_shard(r_msg->records[i].g_addr, shards.size());
+          if(tmp_msgs[shard] == NULL){
+               tmp_msgs[shard] = new struct receiver_msg(receiver_msg::RECORDS, r_msg->if_index, r_msg->src_addr, addr_storage());
+          }
+          tmp_msgs[shard]->records.push_back(r_msg->records[i]);
+     }
+     delete r_msg;
+
+     for(unsigned int i = 0; i < tmp_msgs.size(); i++){
+          if(tmp_msgs[i] == NULL) continue;
+
+          if(shards[i] != NULL){
+               m.msg = tmp_msgs[i];
+               shards[i]->add_msg(m);
+          }else{
+               delete tmp_msgs[i];
+          }
      }
 }
 
@@ -80,16 +132,26 @@ void receiver::registrate_interface(int if_index, int vif, proxy_instance* p){
      HC_LOG_TRACE("");
 
      boost::lock_guard<boost::mutex> lock(m_data_lock);
-     m_if_proxy_map.insert(if_proxy_instance_pair(if_index,p));
+     std::vector<proxy_instance*>& shards = m_if_proxy_map[if_index];
+     shards.resize(p->get_shard_count(), NULL);
+     shards[p->get_shard()] = p;
 
      m_vif_map.insert(vif_pair(vif,if_index));
 }
 
-void receiver::del_interface(int if_index,int vif){
+void receiver::del_interface(int if_index,int vif, proxy_instance* p){
      HC_LOG_TRACE("");
 
      boost::lock_guard<boost::mutex> lock(m_data_lock);
-     m_if_proxy_map.erase(if_index);
+     if_poxy_instance_map::iterator it = m_if_proxy_map.find(if_index);
+     if(it == m_if_proxy_map.end()) return;
+
+     //the interface is deleted with its last shard
+     it->second[p->get_shard()] = NULL;
+     for(unsigned int i = 0; i < it->second.size(); i++){
+          if(it->second[i] != NULL) return;
+     }
+     m_if_proxy_map.erase(it);
      m_vif_map.erase(vif);
 }
 
@@ -108,23 +170,36 @@ void receiver::worker_thread(void* arg){
      HC_LOG_TRACE("");
 
      receiver* r= (receiver*) arg;
+
+     thread_prop::apply(thread_prop::RECEIVER, "mcproxy-recv");
+     while(r->m_running){
+          r->receive_packet();
+     }
+}
+
+void receiver::receive_packet(){
+     HC_LOG_TRACE("");
+
      int info_size = 0;
 
      //########################
      //create msg
      //iov
-     unsigned char iov_buf[r->get_iov_min_size()];
+     unsigned char iov_buf[get_iov_min_size()];
      struct iovec iov;
      iov.iov_base = iov_buf;
      iov.iov_len = sizeof(iov_buf);
 
      //control
-     unsigned char ctrl[r->get_ctrl_min_size()];
+     unsigned char ctrl[get_ctrl_min_size()];
+
+     //sender address
+     struct sockaddr_storage name;
 
      //create msghdr
      struct msghdr msg;
-     msg.msg_name = NULL;
-     msg.msg_namelen = 0;
+     msg.msg_name = &name;
+     msg.msg_namelen = sizeof(name);
 
      msg.msg_iov = &iov;
      msg.msg_iovlen = 1;
@@ -135,18 +210,25 @@ void receiver::worker_thread(void* arg){
      msg.msg_flags = 0;
      //########################
 
-     while(r->m_running){
-          if(!r->m_mrt_sock->receive_msg(&msg,info_size)){
-               HC_LOG_ERROR("received failed");
+     if(!m_mrt_sock->receive_msg(&msg,info_size)){
+          HC_LOG_ERROR("received failed");
+          if(!worker::is_single_thread()){
                sleep(1);
-               continue;
-          }
-          if(info_size == 0) {
-               continue; //on timeout
           }
-          r->m_data_lock.lock();
-          r->analyse_packet(&msg,info_size);
-          r->m_data_lock.unlock();
+          return;
+     }
+     if(info_size == 0) {
+          return; //on timeout
+     }
+
+     //in the single threaded mode the proxy instances process the packet before analyse_packet() returns
+     //and may register interfaces, there is no other thread to lock against
+     if(worker::is_single_thread()){
+          analyse_packet(&msg,info_size);
+     }else{
+          m_data_lock.lock();
+          analyse_packet(&msg,info_size);
+          m_data_lock.unlock();
      }
 }
 
@@ -154,7 +236,11 @@ void receiver::start(){
      HC_LOG_TRACE("");
 
      m_running =  true;
-     m_worker_thread =  new boost::thread(receiver::worker_thread, this);
+
+     //in the single threaded mode the event loop calls receive_packet()
+     if(!worker::is_single_thread()){
+          m_worker_thread =  new boost::thread(receiver::worker_thread, this);
+     }
 }
 
 void receiver::stop(){
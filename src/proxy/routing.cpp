@@ -28,12 +28,17 @@
 #include <linux/mroute.h>
 #include <linux/mroute6.h>
 #include <iostream>
+#include <algorithm>
+#include <errno.h>
+#include <vector>
 
 routing::routing():
-     worker(ROUTING_MSG_QUEUE_SIZE)
+     worker(ROUTING_MSG_QUEUE_SIZE), m_mrt_sock(NULL), m_batch_routes(false)
 {
      HC_LOG_TRACE("");
 
+     m_thread_role = thread_prop::ROUTING;
+     m_thread_name = "mcproxy-route";
 }
 
 routing* routing::getInstance(){
@@ -42,53 +47,67 @@ routing* routing::getInstance(){
      return &instance;
 }
 
-bool routing::init(int addr_family, int version, mroute_socket* mrt_sock){
+bool routing::init(int addr_family, int version, mroute_socket* mrt_sock, bool batch_routes){
      HC_LOG_TRACE("");
 
      m_addr_family = addr_family;
      m_version = version;
      m_mrt_sock = mrt_sock;
 
-     if(!init_if_prop()) return false;
+     if(!m_mrt_netlink.init(addr_family)){
+          HC_LOG_WARN("kernel forwarding routes can not be reconciled");
+          batch_routes = false;
+     }
+
+     if(batch_routes && addr_family != AF_INET){
+          HC_LOG_WARN("batched forwarding rules are only supported for AF_INET, use setsockopt");
+          batch_routes = false;
+     }
+     m_batch_routes = batch_routes;
 
      return false;
 }
 
-bool routing::init_if_prop(){
+const struct if_cache_addr* routing::get_if_addr(const if_cache_snapshot& snapshot, int if_index, const struct if_cache_entry** entry){
      HC_LOG_TRACE("");
 
-     if(!m_if_prop.refresh_network_interfaces()) return false;
+     if(m_addr_family != AF_INET && m_addr_family != AF_INET6){
+          HC_LOG_ERROR("wrong addr_family: " << m_addr_family);
+          return NULL;
+     }
 
-     return true;
+     *entry = if_cache::find(snapshot, if_index);
+     if(*entry == NULL || (*entry)->get_addrs(m_addr_family).empty()){
+          return NULL;
+     }
+
+     return &(*entry)->get_addrs(m_addr_family).front();
 }
 
 bool routing::add_vif(routing_msg* msg){
      HC_LOG_TRACE("");
 
-     char cstr[IF_NAMESIZE];
-     struct ifaddrs* item=NULL;
-     string if_name(if_indextoname(msg->if_index,cstr));
+     if_cache* cache = if_cache::getInstance();
+     if_cache_snapshot snapshot = cache->get_snapshot();
+     const struct if_cache_entry* entry = NULL;
+     const struct if_cache_addr* item = get_if_addr(snapshot, msg->if_index, &entry);
 
-     if(m_addr_family == AF_INET){
-          if((item = m_if_prop.get_ip4_if(if_name))== NULL){
-               HC_LOG_ERROR("interface not found: " << if_name);
-               return false;
-          }
-     }else if(m_addr_family == AF_INET6){
-          if((item = m_if_prop.get_ip6_if(if_name)->front()) == NULL){
-               HC_LOG_ERROR("interface not found: " << if_name);
-               return false;
-          }
-     }else{
-          HC_LOG_ERROR("wrong addr_family: " << m_addr_family);
-          return false;
+     //the interface can be up or addressed since the last refresh
+     if(item == NULL){
+          cache->refresh();
+          snapshot = cache->get_snapshot();
+          item = get_if_addr(snapshot, msg->if_index, &entry);
      }
 
-     if((item->ifa_flags & IFF_POINTOPOINT) && (item->ifa_dstaddr != NULL)) { //tunnel
+     if(item == NULL){
+          HC_LOG_ERROR("interface not found or not addressed, interface index: " << msg->if_index);
+          return false;
+     }
+     const string& if_name = entry->name;
 
-          addr_storage p2p_addr(*(item->ifa_dstaddr));
+     if((entry->flags & IFF_POINTOPOINT) && (item->dstaddr.get_addr_family() == m_addr_family)) { //tunnel
 
-          if(!m_mrt_sock->add_vif(msg->vif,if_name.c_str(),p2p_addr.to_string().c_str())){
+          if(!m_mrt_sock->add_vif(msg->vif,if_name.c_str(),item->dstaddr.to_string().c_str())){
                return false;
           }
 
@@ -99,6 +118,8 @@ bool routing::add_vif(routing_msg* msg){
 
      }
 
+     m_vif_if_index[msg->vif] = msg->if_index;
+
      HC_LOG_DEBUG("added interface: " << if_name << " to vif_table with vif number:" << msg->vif);
      return true;
 }
@@ -123,17 +144,30 @@ bool routing::add_route(routing_msg* msg){
               out_vif[i++] = *iter_out;
      }
 
-     if(!m_mrt_sock->add_mroute(msg->vif, msg->src_addr.to_string().c_str(), msg->g_addr.to_string().c_str(), out_vif,msg->output_vif.size())){
+     map<int, int>::iterator it_if;
+     if(m_batch_routes && (it_if = m_vif_if_index.find(msg->vif)) != m_vif_if_index.end()){
+          if(!m_mrt_netlink.add_route(msg->vif, it_if->second, msg->src_addr, msg->g_addr, out_vif, msg->output_vif.size())){
+               return false;
+          }
+     }else if(!m_mrt_sock->add_mroute(msg->vif, msg->src_addr.to_string().c_str(), msg->g_addr.to_string().c_str(), out_vif,msg->output_vif.size())){
           return false;
      }
 
+     m_routes[pair<addr_storage, addr_storage>(msg->src_addr, msg->g_addr)] = pair<int, list<int> >(msg->vif, msg->output_vif);
      return true;
 }
 
 bool routing::del_route(routing_msg* msg){
      HC_LOG_TRACE("");
 
-     if(!m_mrt_sock->del_mroute(msg->vif, msg->src_addr.to_string().c_str(), msg->g_addr.to_string().c_str())){
+     m_routes.erase(pair<addr_storage, addr_storage>(msg->src_addr, msg->g_addr));
+
+     map<int, int>::iterator it_if;
+     if(m_batch_routes && (it_if = m_vif_if_index.find(msg->vif)) != m_vif_if_index.end()){
+          if(!m_mrt_netlink.del_route(msg->vif, it_if->second, msg->src_addr, msg->g_addr)){
+               return false;
+          }
+     }else if(!m_mrt_sock->del_mroute(msg->vif, msg->src_addr.to_string().c_str(), msg->g_addr.to_string().c_str())){
           return false;
      }
 
@@ -147,42 +181,226 @@ bool routing::del_vif(routing_msg* msg){
           return false;
      }
 
+     m_vif_if_index.erase(msg->vif);
+
      HC_LOG_DEBUG("removed interface with vif number: " << msg->vif) ;
      return true;
 }
 
-routing::~routing(){
+void routing::flush_routes(){
+     HC_LOG_TRACE("");
 
+     vector<struct mroute_netlink_op> failed;
+     m_mrt_netlink.flush();
+     m_mrt_netlink.swap_failed(failed);
+
+     for(vector<struct mroute_netlink_op>::iterator it = failed.begin(); it != failed.end(); it++){
+          if(it->error == EOPNOTSUPP && m_batch_routes){
+               HC_LOG_WARN("the kernel does not support RTM_NEWROUTE for IPMR, use setsockopt");
+               m_batch_routes = false;
+          }
+
+          pair<addr_storage, addr_storage> key(it->src_addr, it->g_addr);
+          route_map::iterator it_route = m_routes.find(key);
+
+          if(it->add){
+               if(it_route == m_routes.end() || it_route->second.first != it->vif){
+                    continue; //changed in the meantime
+               }
+
+               unsigned int out_vif[MAXVIFS];
+               unsigned int n = 0;
+               for(list<int>::iterator iter_out = it_route->second.second.begin(); iter_out != it_route->second.second.end() && n < MAXVIFS; iter_out++){
+                    out_vif[n++] = *iter_out;
+               }
+
+               if(!m_mrt_sock->add_mroute(it->vif, it->src_addr.to_string().c_str(), it->g_addr.to_string().c_str(), out_vif, n)){
+                    m_routes.erase(it_route);
+               }
+          }else if(it->error != ENOENT && it_route == m_routes.end()){
+               m_mrt_sock->del_mroute(it->vif, it->src_addr.to_string().c_str(), it->g_addr.to_string().c_str());
+          }
+     }
 }
 
-void routing::worker_thread(){
+bool routing::reconcile(){
      HC_LOG_TRACE("");
 
-     while(m_running){
-          proxy_msg m = m_job_queue.dequeue();
-          HC_LOG_DEBUG("received new job. type: " << m.msg_type_to_string());
-          switch(m.type){
-          case proxy_msg::TEST_MSG: {
-               struct test_msg* t= (struct test_msg*) m.msg.get();
-               t->test();
-               break;
+     flush_routes();
+
+     if(!m_mrt_netlink.dump_routes(m_kernel_routes)){
+          HC_LOG_ERROR("failed to dump the kernel forwarding routes");
+          return false;
+     }
+
+     map<int, int> if_index_vif;
+     for(map<int, int>::iterator it = m_vif_if_index.begin(); it != m_vif_if_index.end(); it++){
+          if_index_vif[it->second] = it->first;
+     }
+
+     map<pair<addr_storage, addr_storage>, unsigned int> kernel_rows;
+     map<int, int>::iterator it_vif;
+     int deleted = 0;
+     int repaired = 0;
+
+     //delete kernel routes of our vifs that are not intended
+     for(unsigned int row = 0; row < m_kernel_routes.size; row++){
+          if((it_vif = if_index_vif.find(m_kernel_routes.i_if[row])) == if_index_vif.end()){
+               continue; //not a route of the proxy
+          }
+
+          addr_storage src_addr;
+          addr_storage g_addr;
+          if(m_addr_family == AF_INET){
+               src_addr = addr_storage(m_kernel_routes.origin[row].v4);
+               g_addr = addr_storage(m_kernel_routes.group[row].v4);
+          }else{
+               src_addr = addr_storage(m_kernel_routes.origin[row].v6);
+               g_addr = addr_storage(m_kernel_routes.group[row].v6);
+          }
+
+          pair<addr_storage, addr_storage> key(src_addr, g_addr);
+          if(m_routes.find(key) == m_routes.end()){
+               HC_LOG_DEBUG("reconcile: delete stale route src: " << src_addr << " g: " << g_addr);
+               if(m_mrt_sock->del_mroute(it_vif->second, src_addr.to_string().c_str(), g_addr.to_string().c_str())){
+                    deleted++;
+               }
+          }else{
+               kernel_rows[key] = row;
+          }
+     }
+
+     //add missing or different routes
+     vector<int> intended;
+     vector<int> installed;
+     for(route_map::iterator it = m_routes.begin(); it != m_routes.end(); it++){
+          int vif = it->second.first;
+          list<int>& output_vif = it->second.second;
+
+          if(m_vif_if_index.find(vif) == m_vif_if_index.end()){
+               continue; //the input interface is not registered (yet)
           }
-          case proxy_msg::ROUTING_MSG: {
-               struct routing_msg* t= (struct routing_msg*) m.msg.get();
-
-               switch(t->type){
-               case routing_msg::ADD_VIF: add_vif(t); break;
-               case routing_msg::DEL_VIF: del_vif(t); break;
-               case routing_msg::ADD_ROUTE: add_route(t); break;
-               case routing_msg::DEL_ROUTE: del_route(t); break;
-               default: HC_LOG_ERROR("unknown routing action format");
+
+          map<pair<addr_storage, addr_storage>, unsigned int>::iterator it_row = kernel_rows.find(it->first);
+          if(it_row != kernel_rows.end()){
+               unsigned int row = it_row->second;
+
+               intended.assign(output_vif.begin(), output_vif.end());
+               installed.clear();
+               for(unsigned int o = m_kernel_routes.o_if_begin[row]; o < m_kernel_routes.o_if_begin[row + 1]; o++){
+                    if((it_vif = if_index_vif.find(m_kernel_routes.o_if[o])) != if_index_vif.end()){
+                         installed.push_back(it_vif->second);
+                    }
+               }
+               sort(intended.begin(), intended.end());
+               sort(installed.begin(), installed.end());
+
+               if(if_index_vif[m_kernel_routes.i_if[row]] == vif && intended == installed){
+                    continue;
                }
-               break;
           }
-          case proxy_msg::EXIT_CMD: m_running = false; break;
-          default: HC_LOG_ERROR("unknown message format");
+
+          HC_LOG_DEBUG("reconcile: repair route src: " << it->first.first << " g: " << it->first.second);
+          unsigned int out_vif[MAXMIFS > MAXVIFS ? MAXMIFS : MAXVIFS];
+          unsigned int n = 0;
+          for(list<int>::iterator iter_out = output_vif.begin(); iter_out != output_vif.end() && n < sizeof(out_vif) / sizeof(out_vif[0]); iter_out++){
+               out_vif[n++] = *iter_out;
+          }
+
+          if(m_mrt_sock->add_mroute(vif, it->first.first.to_string().c_str(), it->first.second.to_string().c_str(), out_vif, n)){
+               repaired++;
           }
+     }
+
+     if(deleted > 0 || repaired > 0){
+          HC_LOG_WARN("reconcile: kernel routes: " << m_kernel_routes.size << " deleted: " << deleted << " repaired: " << repaired);
+     }else{
+          HC_LOG_DEBUG("reconcile: kernel routes: " << m_kernel_routes.size << " in sync");
+     }
+
+     return true;
+}
 
+bool routing::get_route_pkt_cnt(const addr_storage& src_addr, const addr_storage& g_addr, unsigned long& pkt_cnt){
+     HC_LOG_TRACE("");
+
+     if(m_mrt_sock == NULL){
+          HC_LOG_ERROR("routing is not initialized");
+          return false;
+     }
+
+     return m_mrt_sock->get_mroute_stats(src_addr, g_addr, &pkt_cnt, NULL, NULL);
+}
+
+bool routing::add_route_now(int vif, const addr_storage& g_addr, const addr_storage& src_addr, const list<int>& output_vif){
+     HC_LOG_TRACE("");
+
+     if(m_mrt_sock == NULL){
+          HC_LOG_ERROR("routing is not initialized");
+          return false;
      }
+
+     if(m_addr_family == AF_INET){
+          if(output_vif.size() > MAXVIFS) return false;
+     }else if(m_addr_family == AF_INET6){
+          if(output_vif.size() > MAXMIFS) return false;
+     }else{
+          HC_LOG_ERROR("wrong addr_family: " << m_addr_family);
+          return false;
+     }
+
+     unsigned int out_vif[output_vif.size()];
+     int i=0;
+     for(list<int>::const_iterator iter_out = output_vif.begin(); iter_out != output_vif.end(); iter_out++){
+          out_vif[i++] = *iter_out;
+     }
+
+     //a forwarding rule of the batch mode is replaced by this setsockopt, the kernel keeps the last one
+     return m_mrt_sock->add_mroute(vif, src_addr.to_string().c_str(), g_addr.to_string().c_str(), out_vif, output_vif.size());
+}
+
+routing::~routing(){
+
+}
+
+void routing::handle_msg(proxy_msg& m){
+     HC_LOG_TRACE("");
+
+     switch(m.type){
+     case proxy_msg::TEST_MSG: {
+          struct test_msg* t= (struct test_msg*) m.msg.get();
+          t->test();
+          break;
+     }
+     case proxy_msg::ROUTING_MSG: {
+          struct routing_msg* t= (struct routing_msg*) m.msg.get();
+
+          //keep the order between batched forwarding rules and the other actions
+          if(t->type != routing_msg::ADD_ROUTE && t->type != routing_msg::DEL_ROUTE && m_mrt_netlink.pending() > 0){
+               flush_routes();
+          }
+
+          switch(t->type){
+          case routing_msg::ADD_VIF: add_vif(t); break;
+          case routing_msg::DEL_VIF: del_vif(t); break;
+          case routing_msg::ADD_ROUTE: add_route(t); break;
+          case routing_msg::DEL_ROUTE: del_route(t); break;
+          case routing_msg::RECONCILE: reconcile(); break;
+          default: HC_LOG_ERROR("unknown routing action format");
+          }
+          break;
+     }
+     case proxy_msg::EXIT_CMD: m_running = false; break;
+     default: HC_LOG_ERROR("unknown message format");
+     }
+
+     //send the batch if no more jobs are waiting
+     if(m_mrt_netlink.pending() > 0 && is_job_queue_empty()){
+          flush_routes();
+     }
+}
+
+void routing::finish(){
+     HC_LOG_TRACE("");
      HC_LOG_DEBUG("worker thread routing end");
 }
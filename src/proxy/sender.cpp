@@ -27,6 +27,10 @@ sender::sender(){
      HC_LOG_TRACE("");
 }
 
+sender::~sender(){
+     HC_LOG_TRACE("");
+}
+
 bool sender::init(int addr_family, int version){
      HC_LOG_TRACE("");
 
@@ -44,16 +48,165 @@ bool sender::init(int addr_family, int version){
 
      if(!m_sock.set_loop_back(false)) return false;
 
-     if(!init_if_prop()) return false;
-
      return true;
 }
 
-bool sender::init_if_prop(){
+bool sender::send_general_queries(const std::vector<int>& if_indexes){
      HC_LOG_TRACE("");
 
-     if(!m_if_prop.refresh_network_interfaces()) return false;
+     bool correct = true;
+     for(unsigned int i = 0; i < if_indexes.size(); i++){
+          if(!send_general_query(if_indexes[i])){
+               correct = false;
+          }
+     }
+     return correct;
+}
+
+bool sender::send_group_specific_queries(const gsq_vector& queries){
+     HC_LOG_TRACE("");
 
-     return true;
+     bool correct = true;
+     for(unsigned int i = 0; i < queries.size(); i++){
+          if(!send_group_specific_query(queries[i].first, queries[i].second)){
+               correct = false;
+          }
+     }
+     return correct;
+}
+
+bool sender::send_report(int if_index, const addr_storage& g_addr){
+     HC_LOG_TRACE("");
+
+     membership_map::iterator it = m_membership.find(if_index);
+     if(it == m_membership.end()){
+          return m_sock.join_group(g_addr, if_index);
+     }
+
+     if(!it->second.insert(g_addr).second){ //already joined
+          return true;
+     }
+
+     return send_raw_reports(if_index, std::vector<addr_storage>(1, g_addr), JOIN_REPORT);
+}
+
+bool sender::send_leave(int if_index, const addr_storage& g_addr){
+     HC_LOG_TRACE("");
+
+     membership_map::iterator it = m_membership.find(if_index);
+     if(it == m_membership.end()){
+          return m_sock.leave_group(g_addr, if_index);
+     }
+
+     if(it->second.erase(g_addr) == 0){ //not joined
+          return true;
+     }
+
+     return send_raw_reports(if_index, std::vector<addr_storage>(1, g_addr), LEAVE_REPORT);
+}
+
+bool sender::send_reports(int if_index, const std::vector<addr_storage>& g_addrs){
+     HC_LOG_TRACE("");
+
+     membership_map::iterator it = m_membership.find(if_index);
+     if(it == m_membership.end()){
+          return m_sock.join_groups(g_addrs, if_index);
+     }
+
+     std::vector<addr_storage> joined;
+     for(unsigned int i = 0; i < g_addrs.size(); i++){
+          if(it->second.insert(g_addrs[i]).second){
+               joined.push_back(g_addrs[i]);
+          }
+     }
+
+     return joined.empty() || send_raw_reports(if_index, joined, JOIN_REPORT);
+}
+
+bool sender::send_leaves(int if_index, const std::vector<addr_storage>& g_addrs){
+     HC_LOG_TRACE("");
+
+     membership_map::iterator it = m_membership.find(if_index);
+     if(it == m_membership.end()){
+          return m_sock.leave_groups(g_addrs, if_index);
+     }
+
+     std::vector<addr_storage> left;
+     for(unsigned int i = 0; i < g_addrs.size(); i++){
+          if(it->second.erase(g_addrs[i]) > 0){
+               left.push_back(g_addrs[i]);
+          }
+     }
+
+     return left.empty() || send_raw_reports(if_index, left, LEAVE_REPORT);
 }
 
+bool sender::set_raw_membership(int if_index, bool enable){
+     HC_LOG_TRACE("if_index: " << if_index << " enable: " << enable);
+
+     membership_map::iterator it = m_membership.find(if_index);
+     if(enable){
+          if(it == m_membership.end()){
+               m_membership.insert(std::pair<int, std::set<addr_storage> >(if_index, std::set<addr_storage>()));
+          }
+          return true;
+     }
+
+     if(it == m_membership.end()){
+          return true;
+     }
+
+     std::vector<addr_storage> left(it->second.begin(), it->second.end());
+     m_membership.erase(it);
+
+     return left.empty() || send_raw_reports(if_index, left, LEAVE_REPORT);
+}
+
+bool sender::is_raw_membership(int if_index) const{
+     HC_LOG_TRACE("");
+
+     return m_membership.find(if_index) != m_membership.end();
+}
+
+bool sender::send_current_state(int if_index){
+     HC_LOG_TRACE("");
+
+     membership_map::iterator it = m_membership.find(if_index);
+     if(it == m_membership.end() || it->second.empty()){
+          return true;
+     }
+
+     std::vector<addr_storage> joined(it->second.begin(), it->second.end());
+     HC_LOG_DEBUG("report the current state of " << joined.size() << " groups on if_index: " << if_index);
+
+     return send_raw_reports(if_index, joined, CURRENT_STATE_REPORT);
+}
+
+bool sender::send_current_state(int if_index, const addr_storage& g_addr){
+     HC_LOG_TRACE("");
+
+     membership_map::iterator it = m_membership.find(if_index);
+     if(it == m_membership.end() || it->second.find(g_addr) == it->second.end()){
+          return true;
+     }
+
+     return send_raw_reports(if_index, std::vector<addr_storage>(1, g_addr), CURRENT_STATE_REPORT);
+}
+
+bool sender::send_current_state(int if_index, const std::vector<addr_storage>& g_addrs){
+     HC_LOG_TRACE("");
+
+     membership_map::iterator it = m_membership.find(if_index);
+     if(it == m_membership.end()){
+          return true;
+     }
+
+     std::vector<addr_storage> joined;
+     for(unsigned int i = 0; i < g_addrs.size(); i++){
+          if(it->second.find(g_addrs[i]) != it->second.end()){
+               joined.push_back(g_addrs[i]);
+          }
+     }
+
+     return joined.empty() || send_raw_reports(if_index, joined, CURRENT_STATE_REPORT);
+}
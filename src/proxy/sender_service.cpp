@@ -0,0 +1,327 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * mcproxy is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * mcproxy is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with mcproxy; see the file COPYING.LESSER.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+
+#include "include/hamcast_logging.h"
+#include "include/proxy/sender_service.hpp"
+#include "include/proxy/igmp_sender.hpp"
+#include "include/proxy/mld_sender.hpp"
+
+#include <algorithm>
+
+sender_service::sender_service():
+     worker(SENDER_SERVICE_MSG_QUEUE_SIZE), m_addr_family(-1), m_version(-1), m_sender(NULL), m_timing(NULL), m_report_window(0), m_report_flush_scheduled(false)
+{
+     HC_LOG_TRACE("");
+
+     m_thread_role = thread_prop::SENDER;
+     m_thread_name = "mcproxy-send";
+}
+
+sender_service::~sender_service(){
+     HC_LOG_TRACE("");
+
+     delete m_sender;
+}
+
+sender_service* sender_service::getInstance(){
+     HC_LOG_TRACE("");
+     static sender_service instance;
+     return &instance;
+}
+
+bool sender_service::init(int addr_family, int version, int report_window){
+     HC_LOG_TRACE("");
+
+     m_addr_family = addr_family;
+     m_version = version;
+     m_report_window = (report_window > 0)? report_window : 0;
+     m_timing = timing::getInstance();
+
+     delete m_sender;
+     if(m_addr_family == AF_INET){
+          m_sender = new igmp_sender;
+     }else if(m_addr_family == AF_INET6){
+          m_sender = new mld_sender;
+     }else{
+          HC_LOG_ERROR("wrong addr_family: " << m_addr_family);
+          m_sender = NULL;
+          return false;
+     }
+
+     return m_sender->init(m_addr_family, m_version);
+}
+
+void sender_service::join_groups(struct sender_msg* msg){
+     HC_LOG_TRACE("");
+
+     group_owner_map& groups = m_group_owner[msg->if_index];
+
+     //only the first proxy instance joins the group on the network
+     std::vector<addr_storage> joined;
+     for(unsigned int i = 0; i < msg->g_addrs.size(); i++){
+          std::set<proxy_instance*>& owners = groups[msg->g_addrs[i]];
+          if(owners.empty()){
+               joined.push_back(msg->g_addrs[i]);
+          }
+          owners.insert(msg->owner);
+     }
+
+     if(joined.empty()) return;
+
+     if(m_report_window > 0 && m_sender->is_raw_membership(msg->if_index)){
+          add_due_reports(msg->if_index, joined, true);
+     }else if(!m_sender->send_reports(msg->if_index, joined)){
+          HC_LOG_ERROR("failed to join groups on if_index: " << msg->if_index);
+     }
+}
+
+void sender_service::leave_groups(struct sender_msg* msg){
+     HC_LOG_TRACE("");
+
+     std::map<int, group_owner_map>::iterator it_if = m_group_owner.find(msg->if_index);
+     if(it_if == m_group_owner.end()) return;
+
+     //only the last proxy instance leaves the group on the network
+     std::vector<addr_storage> left;
+     for(unsigned int i = 0; i < msg->g_addrs.size(); i++){
+          group_owner_map::iterator it_group = it_if->second.find(msg->g_addrs[i]);
+          if(it_group == it_if->second.end()) continue;
+
+          it_group->second.erase(msg->owner);
+          if(it_group->second.empty()){
+               left.push_back(msg->g_addrs[i]);
+               it_if->second.erase(it_group);
+          }
+     }
+
+     if(it_if->second.empty()){
+          m_group_owner.erase(it_if);
+     }
+
+     if(left.empty()) return;
+
+     if(m_report_window > 0 && m_sender->is_raw_membership(msg->if_index)){
+          add_due_reports(msg->if_index, left, false);
+     }else if(!m_sender->send_leaves(msg->if_index, left)){
+          HC_LOG_ERROR("failed to leave groups on if_index: " << msg->if_index);
+     }
+}
+
+void sender_service::send_current_state(struct sender_msg* msg){
+     HC_LOG_TRACE("");
+
+     //repeated reports of single groups are collected like the membership changes
+     if(!msg->g_addrs.empty() && m_report_window > 0 && m_sender->is_raw_membership(msg->if_index)){
+          m_due_current_state[msg->if_index].insert(msg->g_addrs.begin(), msg->g_addrs.end());
+          schedule_reports();
+          return;
+     }
+
+     bool correct;
+     if(msg->g_addrs.empty()){
+          correct = m_sender->send_current_state(msg->if_index);
+     }else{
+          correct = m_sender->send_current_state(msg->if_index, msg->g_addrs);
+     }
+
+     if(!correct){
+          HC_LOG_ERROR("failed to report the current state on if_index: " << msg->if_index);
+     }
+}
+
+void sender_service::set_raw_membership(struct sender_msg* msg){
+     HC_LOG_TRACE("");
+
+     //the collected changes have to reach the network before the mode changes
+     flush_reports();
+
+     std::set<proxy_instance*>& owners = m_raw_owner[msg->if_index];
+     bool used = !owners.empty();
+
+     if(msg->enable){
+          owners.insert(msg->owner);
+     }else{
+          owners.erase(msg->owner);
+     }
+
+     //the mode changes with the first and the last proxy instance
+     if(used != !owners.empty()){
+          if(!m_sender->set_raw_membership(msg->if_index, msg->enable)){
+               HC_LOG_ERROR("failed to set the raw membership mode on if_index: " << msg->if_index);
+          }
+     }
+
+     if(owners.empty()){
+          m_raw_owner.erase(msg->if_index);
+     }
+}
+
+void sender_service::flush_queries(){
+     HC_LOG_TRACE("");
+
+     if(!m_due_gq.empty()){
+          //proxy instances can query the same interface within one batch
+          std::sort(m_due_gq.begin(), m_due_gq.end());
+          m_due_gq.erase(std::unique(m_due_gq.begin(), m_due_gq.end()), m_due_gq.end());
+
+          HC_LOG_DEBUG("send " << m_due_gq.size() << " general queries");
+          if(!m_sender->send_general_queries(m_due_gq)){
+               HC_LOG_ERROR("failed to send general queries");
+          }
+          m_due_gq.clear();
+     }
+
+     if(!m_due_gsq.empty()){
+          HC_LOG_DEBUG("send " << m_due_gsq.size() << " group specific queries");
+          if(!m_sender->send_group_specific_queries(m_due_gsq)){
+               HC_LOG_ERROR("failed to send group specific queries");
+          }
+          m_due_gsq.clear();
+     }
+}
+
+void sender_service::add_due_reports(int if_index, const std::vector<addr_storage>& g_addrs, bool join){
+     HC_LOG_TRACE("");
+
+     due_report_map& due = m_due_reports[if_index];
+     for(unsigned int i = 0; i < g_addrs.size(); i++){
+          due_report_map::iterator it = due.find(g_addrs[i]);
+          if(it == due.end()){
+               due.insert(std::pair<addr_storage, bool>(g_addrs[i], join));
+          }else if(it->second != join){ //the change cancels a collected change
+               due.erase(it);
+          }
+     }
+
+     if(due.empty()){
+          m_due_reports.erase(if_index);
+     }
+
+     if(!m_due_reports.empty()){
+          schedule_reports();
+     }
+}
+
+void sender_service::schedule_reports(){
+     HC_LOG_TRACE("");
+
+     //the first collected report starts the report window
+     if(!m_report_flush_scheduled){
+          proxy_msg m;
+          m.type = proxy_msg::CLOCK_MSG;
+          m.msg = new struct clock_msg(clock_msg::SEND_DUE_REPORTS);
+          m_timing->add_time(m_report_window, this, m);
+          m_report_flush_scheduled = true;
+     }
+}
+
+void sender_service::flush_reports(){
+     HC_LOG_TRACE("");
+
+     std::map<int, due_report_map>::iterator it_if;
+     for(it_if = m_due_reports.begin(); it_if != m_due_reports.end(); it_if++){
+          std::vector<addr_storage> joined;
+          std::vector<addr_storage> left;
+          for(due_report_map::iterator it = it_if->second.begin(); it != it_if->second.end(); it++){
+               if(it->second){
+                    joined.push_back(it->first);
+               }else{
+                    left.push_back(it->first);
+               }
+          }
+
+          HC_LOG_DEBUG("send " << joined.size() << " joins and " << left.size() << " leaves on if_index: " << it_if->first);
+          if(!left.empty() && !m_sender->send_leaves(it_if->first, left)){
+               HC_LOG_ERROR("failed to leave groups on if_index: " << it_if->first);
+          }
+          if(!joined.empty() && !m_sender->send_reports(it_if->first, joined)){
+               HC_LOG_ERROR("failed to join groups on if_index: " << it_if->first);
+          }
+     }
+     m_due_reports.clear();
+
+     std::map<int, std::set<addr_storage> >::iterator it_cs;
+     for(it_cs = m_due_current_state.begin(); it_cs != m_due_current_state.end(); it_cs++){
+          std::vector<addr_storage> g_addrs(it_cs->second.begin(), it_cs->second.end());
+          if(!m_sender->send_current_state(it_cs->first, g_addrs)){
+               HC_LOG_ERROR("failed to report the current state on if_index: " << it_cs->first);
+          }
+     }
+     m_due_current_state.clear();
+}
+
+void sender_service::handle_msg(proxy_msg& m){
+     HC_LOG_TRACE("");
+
+     switch(m.type){
+     case proxy_msg::TEST_MSG: {
+          struct test_msg* t= (struct test_msg*) m.msg.get();
+          t->test();
+          break;
+     }
+     case proxy_msg::SENDER_MSG: {
+          struct sender_msg* t= (struct sender_msg*) m.msg.get();
+
+          if(m_sender == NULL){
+               HC_LOG_ERROR("sender not initialized");
+               break;
+          }
+
+          switch(t->type){
+          case sender_msg::SEND_GQ: m_due_gq.insert(m_due_gq.end(), t->if_indexes.begin(), t->if_indexes.end()); break;
+          case sender_msg::SEND_GSQ: m_due_gsq.insert(m_due_gsq.end(), t->queries.begin(), t->queries.end()); break;
+          case sender_msg::JOIN: join_groups(t); break;
+          case sender_msg::LEAVE: leave_groups(t); break;
+          case sender_msg::SEND_CURRENT_STATE: send_current_state(t); break;
+          case sender_msg::SET_RAW_MEMBERSHIP: set_raw_membership(t); break;
+          default: HC_LOG_ERROR("unknown sender action format");
+          }
+          break;
+     }
+     case proxy_msg::CLOCK_MSG: {
+          struct clock_msg* t= (struct clock_msg*) m.msg.get();
+          if(t->type == clock_msg::SEND_DUE_REPORTS){
+               m_report_flush_scheduled = false;
+               flush_reports();
+          }else{
+               HC_LOG_ERROR("unknown clock action format");
+          }
+          break;
+     }
+     case proxy_msg::EXIT_CMD: m_running = false; break;
+     default: HC_LOG_ERROR("unknown message format");
+     }
+
+     //send the queries of all proxy instances as one batch if no more jobs are waiting
+     unsigned int due = m_due_gq.size() + m_due_gsq.size();
+     if(due > 0 && (due >= SENDER_SERVICE_MAX_BATCH || is_job_queue_empty() || !m_running)){
+          flush_queries();
+     }
+}
+
+void sender_service::finish(){
+     HC_LOG_TRACE("");
+
+     //the report window does not outlast the sender
+     flush_reports();
+     HC_LOG_DEBUG("worker thread sender_service end");
+}
@@ -0,0 +1,210 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * mcproxy is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * mcproxy is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with mcproxy; see the file COPYING.LESSER.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+
+#include "include/hamcast_logging.h"
+#include "include/proxy/thread_prop.hpp"
+
+#include <pthread.h>
+#include <sys/mman.h>
+#include <errno.h>
+#include <string.h>
+#include <sstream>
+using namespace std;
+
+bool thread_prop::m_configured = false;
+bool thread_prop::m_has_cpus[thread_prop::ROLE_COUNT] = {false};
+cpu_set_t thread_prop::m_cpus[thread_prop::ROLE_COUNT];
+int thread_prop::m_policy[thread_prop::ROLE_COUNT] = {SCHED_OTHER};
+int thread_prop::m_priority[thread_prop::ROLE_COUNT] = {0};
+
+bool thread_prop::parse_role(const string& str, role& r){
+     HC_LOG_TRACE("");
+
+     for(int i = 0; i < ROLE_COUNT; i++){
+          if(str.compare(role_to_string((role)i)) == 0){
+               r = (role)i;
+               return true;
+          }
+     }
+     return false;
+}
+
+const char* thread_prop::role_to_string(role r){
+     HC_LOG_TRACE("");
+
+     switch(r){
+     case MAIN: return "main";
+     case RECEIVER: return "receiver";
+     case ROUTING: return "routing";
+     case SENDER: return "sender";
+     case TIMING: return "timing";
+     case PROXY_INSTANCE: return "instance";
+     default: return "unknown";
+     }
+}
+
+bool thread_prop::get_process_cpus(cpu_set_t& cpus){
+     HC_LOG_TRACE("");
+
+     //the first call is made by the config parser, before the main thread is pinned
+     static bool init = false;
+     static bool valid = false;
+     static cpu_set_t process_cpus;
+
+     if(!init){
+          init = true;
+          CPU_ZERO(&process_cpus);
+          if(sched_getaffinity(0, sizeof(process_cpus), &process_cpus) < 0){
+               HC_LOG_ERROR("failed to get the CPU affinity of the process! Error: " << strerror(errno) << " errno: " << errno);
+          }else{
+               valid = true;
+          }
+     }
+
+     cpus = process_cpus;
+     return valid;
+}
+
+bool thread_prop::set_cpus(role r, const vector<int>& cpus){
+     HC_LOG_TRACE("");
+
+     cpu_set_t process_cpus;
+     if(!get_process_cpus(process_cpus)) return false;
+
+     if(cpus.empty()){
+          HC_LOG_ERROR("no CPU defined for the role: " << role_to_string(r));
+          return false;
+     }
+
+     cpu_set_t tmp_cpus;
+     CPU_ZERO(&tmp_cpus);
+     for(unsigned int i = 0; i < cpus.size(); i++){
+          if(cpus[i] < 0 || cpus[i] >= CPU_SETSIZE || !CPU_ISSET(cpus[i], &process_cpus)){
+               HC_LOG_ERROR("CPU " << cpus[i] << " is not usable by the process");
+               return false;
+          }
+          CPU_SET(cpus[i], &tmp_cpus);
+     }
+
+     m_cpus[r] = tmp_cpus;
+     m_has_cpus[r] = true;
+     m_configured = true;
+     return true;
+}
+
+bool thread_prop::set_priority(role r, int policy, int priority){
+     HC_LOG_TRACE("");
+
+     cpu_set_t process_cpus;
+     get_process_cpus(process_cpus);
+
+     if(policy != SCHED_FIFO && policy != SCHED_RR){
+          HC_LOG_ERROR("wrong scheduling policy: " << policy);
+          return false;
+     }
+
+     int min = sched_get_priority_min(policy);
+     int max = sched_get_priority_max(policy);
+     if(priority < min || priority > max){
+          HC_LOG_ERROR("the priority must be between " << min << " and " << max);
+          return false;
+     }
+
+     m_policy[r] = policy;
+     m_priority[r] = priority;
+     m_configured = true;
+     return true;
+}
+
+bool thread_prop::lock_memory(){
+     HC_LOG_TRACE("");
+
+     //a page fault of a real-time thread would delay it
+     if(mlockall(MCL_CURRENT | MCL_FUTURE) < 0){
+          HC_LOG_ERROR("failed to lock the memory! Error: " << strerror(errno) << " errno: " << errno);
+          return false;
+     }
+     return true;
+}
+
+void thread_prop::apply(role r, const string& name){
+     HC_LOG_TRACE("");
+
+     string tmp_name = name.substr(0, THREAD_PROP_MAX_NAME_LEN);
+     int rc = pthread_setname_np(pthread_self(), tmp_name.c_str());
+     if(rc != 0){
+          HC_LOG_ERROR("failed to set the thread name: " << tmp_name << " Error: " << strerror(rc) << " errno: " << rc);
+     }
+
+     if(!m_configured){
+          return;
+     }
+
+     //a new thread inherits affinity and policy of its creator, so they are set for every role
+     cpu_set_t cpus;
+     if(m_has_cpus[r]){
+          cpus = m_cpus[r];
+     }else if(!get_process_cpus(cpus)){
+          return;
+     }
+
+     rc = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+     if(rc != 0){
+          HC_LOG_ERROR("failed to set the CPU affinity of the thread: " << tmp_name << " Error: " << strerror(rc) << " errno: " << rc);
+     }
+
+     struct sched_param param;
+     memset(&param, 0, sizeof(param));
+     param.sched_priority = m_priority[r];
+     rc = pthread_setschedparam(pthread_self(), m_policy[r], &param);
+     if(rc != 0){
+          HC_LOG_ERROR("failed to set the scheduling policy of the thread: " << tmp_name << " Error: " << strerror(rc) << " errno: " << rc);
+     }
+}
+
+string thread_prop::to_string(){
+     HC_LOG_TRACE("");
+
+     stringstream str;
+     for(int i = 0; i < ROLE_COUNT; i++){
+          if(!m_has_cpus[i] && m_policy[i] == SCHED_OTHER){
+               continue;
+          }
+
+          str << "\t" << role_to_string((role)i) << ":";
+          if(m_has_cpus[i]){
+               str << " cpu";
+               for(int c = 0; c < CPU_SETSIZE; c++){
+                    if(CPU_ISSET(c, &m_cpus[i])){
+                         str << " " << c;
+                    }
+               }
+          }
+          if(m_policy[i] == SCHED_FIFO){
+               str << " fifo " << m_priority[i];
+          }else if(m_policy[i] == SCHED_RR){
+               str << " rr " << m_priority[i];
+          }
+          str << endl;
+     }
+     return str.str();
+}
@@ -22,7 +22,8 @@
 
 #include "include/hamcast_logging.h"
 #include "include/proxy/timing.hpp"
-#include "include/proxy/proxy_instance.hpp"
+#include "include/proxy/worker.hpp"
+#include "include/proxy/thread_prop.hpp"
 #include <sys/time.h>
 #include <iostream>
 
@@ -38,7 +39,7 @@ timing::~timing(){
      delete m_worker_thread;
 }
 
-timing::timehandling::timehandling(struct timeval time, proxy_instance* pr_i, proxy_msg pr_msg){
+timing::timehandling::timehandling(struct timeval time, worker* pr_i, proxy_msg pr_msg){
      HC_LOG_TRACE("");
      m_time = time;
      m_pr_i = pr_i;
@@ -48,30 +49,65 @@ timing::timehandling::timehandling(struct timeval time, proxy_instance* pr_i, pr
 void timing::worker_thread(timing* t){
      HC_LOG_TRACE("");
 
+     thread_prop::apply(thread_prop::TIMING, "mcproxy-timer");
      while(t->m_running){
           usleep(TIME_POLL_INTERVAL);
+          t->check_time();
+     }
+}
+
+void timing::check_time(){
+     HC_LOG_TRACE("");
+
+     struct timeval current_timeval;
+     gettimeofday(&current_timeval, NULL);
+
+     //the reminders are sent without the lock, in the single threaded mode the owner processes them at once and may add new ones
+     list<struct timehandling> due;
 
-          struct timeval current_timeval;
-          gettimeofday(&current_timeval, NULL);
-
-          t->m_global_lock.lock();
-
-          list<struct timehandling>::iterator iter;
-          for(iter= t->m_time_list.begin(); iter != t->m_time_list.end(); iter++){
-               if(current_timeval.tv_sec > iter->m_time.tv_sec){
-                    iter->m_pr_i->add_msg(iter->m_pr_msg);
-                    iter = t->m_time_list.erase(iter);
-               }else if(current_timeval.tv_sec == iter->m_time.tv_sec){
-                    if(current_timeval.tv_usec >= iter->m_time.tv_usec){
-                         iter->m_pr_i->add_msg(iter->m_pr_msg);
-                         iter = t->m_time_list.erase(iter);
-                    }
-               }
+     m_global_lock.lock();
+     list<struct timehandling>::iterator iter= m_time_list.begin();
+     while(iter != m_time_list.end()){
+          if(!timercmp(&current_timeval, &iter->m_time, <)){
+               due.push_back(*iter);
+               iter = m_time_list.erase(iter);
+          }else{
+               iter++;
           }
+     }
+     m_global_lock.unlock();
+
+     for(iter= due.begin(); iter != due.end(); iter++){
+          iter->m_pr_i->add_msg(iter->m_pr_msg);
+     }
+}
+
+int timing::get_next_timeout(){
+     HC_LOG_TRACE("");
+
+     struct timeval current_timeval;
+     gettimeofday(&current_timeval, NULL);
+
+     boost::lock_guard<boost::mutex> lock(m_global_lock);
+     if(m_time_list.empty()){
+          return -1;
+     }
 
-          t->m_global_lock.unlock();
+     list<struct timehandling>::iterator iter= m_time_list.begin();
+     struct timeval next = iter->m_time;
+     for(iter++; iter != m_time_list.end(); iter++){
+          if(timercmp(&iter->m_time, &next, <)){
+               next = iter->m_time;
+          }
+     }
 
+     if(!timercmp(&current_timeval, &next, <)){
+          return 0;
      }
+
+     struct timeval diff;
+     timersub(&next, &current_timeval, &diff);
+     return diff.tv_sec * 1000 + (diff.tv_usec + 999) / 1000; //round up, not to wake before the reminder expires
 }
 
 timing* timing::getInstance(){
@@ -81,13 +117,17 @@ timing* timing::getInstance(){
      return &instance;
 }
 
-void timing::add_time(int msec, proxy_instance* m_pr_i, proxy_msg& pr_msg){
+void timing::add_time(int msec, worker* m_pr_i, proxy_msg& pr_msg){
      HC_LOG_TRACE("");
 
      struct timeval t;
      gettimeofday(&t, NULL);
      t.tv_sec += msec/1000;
-     t.tv_usec += 1000 * (msec % 1000);;
+     t.tv_usec += 1000 * (msec % 1000);
+     if(t.tv_usec >= 1000000){
+          t.tv_sec += 1;
+          t.tv_usec -= 1000000;
+     }
 
      struct timehandling th(t, m_pr_i, pr_msg);
 
@@ -97,15 +137,17 @@ void timing::add_time(int msec, proxy_instance* m_pr_i, proxy_msg& pr_msg){
 
 }
 
-void timing::stop_all_time(proxy_instance* pr_i){
+void timing::stop_all_time(worker* pr_i){
      HC_LOG_TRACE("");
 
      m_global_lock.lock();
 
-     list<struct timehandling>::iterator iter;
-     for(iter= m_time_list.begin(); iter != m_time_list.end(); iter++){
+     list<struct timehandling>::iterator iter= m_time_list.begin();
+     while(iter != m_time_list.end()){
           if(iter->m_pr_i == pr_i){
                iter = m_time_list.erase(iter);
+          }else{
+               iter++;
           }
      }
 
@@ -116,7 +158,11 @@ void timing::start(){
      HC_LOG_TRACE("");
 
      m_running =  true;
-     m_worker_thread =  new boost::thread(timing::worker_thread, this);
+
+     //in the single threaded mode the event loop calls check_time()
+     if(!worker::is_single_thread()){
+          m_worker_thread =  new boost::thread(timing::worker_thread, this);
+     }
 }
 
 void timing::stop(){
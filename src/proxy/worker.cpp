@@ -23,8 +23,12 @@
 #include "include/hamcast_logging.h"
 #include "include/proxy/worker.hpp"
 
+bool worker::m_single_thread = false;
+bool worker::m_dispatching = false;
+std::deque<std::pair<worker*, proxy_msg> > worker::m_loop_queue;
+
 worker::worker(int max_msg):
-     m_worker_thread(0), m_running(false), m_job_queue(max_msg)
+     m_worker_thread(0), m_loop_pending(0), m_pool(NULL), m_pool_scheduled(false), m_pool_finished(true), m_thread_role(thread_prop::PROXY_INSTANCE), m_thread_name("mcproxy-worker"), m_running(false), m_job_queue(max_msg)
 
 {
     HC_LOG_TRACE("");
@@ -39,15 +43,110 @@ void worker::start(){
      HC_LOG_TRACE("");
 
      m_running =  true;
-     m_worker_thread =  new boost::thread(worker::worker_thread_starter, this);
+     if(m_single_thread){
+          prepare();
+     }else if(m_pool != NULL){
+          //the jobs added during prepare() wait until it is done
+          m_pool_finished = false;
+          m_pool_scheduled = true;
+          prepare();
+
+          bool waiting;
+          {
+               boost::lock_guard<boost::mutex> lock(m_pool_lock);
+               waiting = !m_pool_queue.empty();
+               if(!waiting){
+                    m_pool_scheduled = false;
+               }
+          }
+          if(waiting){
+               m_pool->schedule(this);
+          }
+     }else{
+          m_worker_thread =  new boost::thread(worker::worker_thread_starter, this);
+     }
 }
 
 void worker::worker_thread_starter(worker* w){
      HC_LOG_TRACE("");
 
+     thread_prop::apply(w->m_thread_role, w->m_thread_name);
      w->worker_thread();
 }
 
+void worker::worker_thread(){
+     HC_LOG_TRACE("");
+
+     prepare();
+
+     while(m_running){
+          proxy_msg m = m_job_queue.dequeue();
+          HC_LOG_DEBUG("received new job. type: " << m.msg_type_to_string());
+          handle_msg(m);
+     }
+
+     finish();
+}
+
+void worker::prepare(){
+     HC_LOG_TRACE("");
+}
+
+void worker::finish(){
+     HC_LOG_TRACE("");
+}
+
+bool worker::is_job_queue_empty(){
+     HC_LOG_TRACE("");
+
+     if(m_single_thread){
+          return m_loop_pending == 0;
+     }else if(m_pool != NULL){
+          boost::lock_guard<boost::mutex> lock(m_pool_lock);
+          return m_pool_queue.empty();
+     }else{
+          return m_job_queue.is_empty();
+     }
+}
+
+void worker::dispatch_loop_queue(){
+     HC_LOG_TRACE("");
+
+     m_dispatching = true;
+     while(!m_loop_queue.empty()){
+          std::pair<worker*, proxy_msg> job = m_loop_queue.front();
+          m_loop_queue.pop_front();
+
+          worker* w = job.first;
+          w->m_loop_pending--;
+          if(!w->m_running){ //stopped, like a thread that no longer reads its queue
+               continue;
+          }
+
+          HC_LOG_DEBUG("received new job. type: " << job.second.msg_type_to_string());
+          w->handle_msg(job.second);
+          if(!w->m_running){
+               w->finish();
+          }
+     }
+     m_dispatching = false;
+}
+
+void worker::set_single_thread(bool single_thread){
+     HC_LOG_TRACE("");
+     m_single_thread = single_thread;
+}
+
+void worker::set_worker_pool(worker_pool* pool){
+     HC_LOG_TRACE("");
+     m_pool = pool;
+}
+
+bool worker::is_single_thread(){
+     HC_LOG_TRACE("");
+     return m_single_thread;
+}
+
 void worker::close(){
      HC_LOG_TRACE("");
      join();
@@ -58,7 +157,32 @@ void worker::add_msg(proxy_msg& msg){
      HC_LOG_TRACE("");
 
      HC_LOG_DEBUG("message type:" << msg.msg_type_to_string());
-     m_job_queue.enqueue(msg);
+     if(m_pool != NULL){
+          //a worker is scheduled once, so only one pool thread at a time processes its jobs
+          bool schedule = false;
+          {
+               boost::lock_guard<boost::mutex> lock(m_pool_lock);
+               m_pool_queue.push_back(msg);
+               if(!m_pool_scheduled){
+                    m_pool_scheduled = true;
+                    schedule = true;
+               }
+          }
+          if(schedule){
+               m_pool->schedule(this);
+          }
+          return;
+     }else if(!m_single_thread){
+          m_job_queue.enqueue(msg);
+          return;
+     }
+
+     //a job added by a job of a worker is processed after that job
+     m_loop_queue.push_back(std::pair<worker*, proxy_msg>(this, msg));
+     m_loop_pending++;
+     if(!m_dispatching){
+          dispatch_loop_queue();
+     }
 }
 
 bool worker::is_running(){
@@ -71,5 +195,10 @@ void worker::join(){
 
      if(m_worker_thread){
           m_worker_thread->join();
+     }else if(m_pool != NULL){
+          boost::unique_lock<boost::mutex> lock(m_pool_lock);
+          while(!m_pool_finished){
+               m_pool_cond.wait(lock);
+          }
      }
 }
@@ -0,0 +1,226 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * mcproxy is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * mcproxy is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with mcproxy; see the file COPYING.LESSER.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+
+#include "include/hamcast_logging.h"
+#include "include/proxy/worker_pool.hpp"
+#include "include/proxy/worker.hpp"
+#include "include/proxy/thread_prop.hpp"
+
+#include <sstream>
+
+//index of the run queue of a pool thread, -1 outside of the pool
+static __thread int t_pool_index = -1;
+
+worker_pool::worker_pool(int threads):
+     m_running(false), m_idle(0), m_next_queue(0)
+{
+     HC_LOG_TRACE("");
+
+     if(threads <= 0){
+          threads = boost::thread::hardware_concurrency();
+          if(threads <= 0){
+               threads = 1;
+          }
+     }
+
+     for(int i = 0; i < threads; i++){
+          m_run_queues.push_back(new run_queue());
+     }
+}
+
+worker_pool::~worker_pool(){
+     HC_LOG_TRACE("");
+
+     stop();
+     for(unsigned int i = 0; i < m_run_queues.size(); i++){
+          delete m_run_queues[i];
+     }
+}
+
+int worker_pool::get_thread_count(){
+     HC_LOG_TRACE("");
+     return m_run_queues.size();
+}
+
+void worker_pool::start(){
+     HC_LOG_TRACE("");
+
+     m_running = true;
+     for(unsigned int i = 0; i < m_run_queues.size(); i++){
+          m_threads.push_back(new boost::thread(worker_pool::worker_thread_starter, this, i));
+     }
+}
+
+void worker_pool::stop(){
+     HC_LOG_TRACE("");
+
+     {
+          boost::lock_guard<boost::mutex> lock(m_idle_lock);
+          m_running = false;
+          m_idle_cond.notify_all();
+     }
+
+     for(unsigned int i = 0; i < m_threads.size(); i++){
+          m_threads[i]->join();
+          delete m_threads[i];
+     }
+     m_threads.clear();
+}
+
+void worker_pool::worker_thread_starter(worker_pool* p, int index){
+     HC_LOG_TRACE("");
+
+     t_pool_index = index;
+
+     std::stringstream name;
+     name << "mcproxy-pool" << index;
+     thread_prop::apply(thread_prop::PROXY_INSTANCE, name.str());
+
+     p->worker_thread(index);
+}
+
+void worker_pool::schedule(worker* w){
+     HC_LOG_TRACE("");
+
+     int index = t_pool_index;
+     if(index < 0){
+          boost::lock_guard<boost::mutex> lock(m_idle_lock);
+          index = m_next_queue;
+          m_next_queue = (m_next_queue + 1) % m_run_queues.size();
+     }
+
+     run_queue* q = m_run_queues[index];
+     {
+          boost::lock_guard<boost::mutex> lock(q->lock);
+          q->workers.push_back(w);
+     }
+
+     //an idle thread checks the run queues with this lock held before it sleeps, no wakeup is lost
+     boost::lock_guard<boost::mutex> lock(m_idle_lock);
+     if(m_idle > 0){
+          m_idle_cond.notify_one();
+     }
+}
+
+worker* worker_pool::get_runnable(int index){
+     //called for every job batch, it does not trace
+
+     //the own run queue in order
+     run_queue* q = m_run_queues[index];
+     {
+          boost::lock_guard<boost::mutex> lock(q->lock);
+          if(!q->workers.empty()){
+               worker* w = q->workers.front();
+               q->workers.pop_front();
+               return w;
+          }
+     }
+
+     //steal the last scheduled worker of another run queue
+     for(unsigned int i = 1; i < m_run_queues.size(); i++){
+          q = m_run_queues[(index + i) % m_run_queues.size()];
+          boost::lock_guard<boost::mutex> lock(q->lock);
+          if(!q->workers.empty()){
+               worker* w = q->workers.back();
+               q->workers.pop_back();
+               return w;
+          }
+     }
+
+     return NULL;
+}
+
+void worker_pool::worker_thread(int index){
+     HC_LOG_TRACE("");
+
+     for(;;){
+          worker* w = get_runnable(index);
+          if(w != NULL){
+               run(w, index);
+               continue;
+          }
+
+          boost::unique_lock<boost::mutex> lock(m_idle_lock);
+          if(!m_running){
+               break;
+          }
+
+          //look again with the lock held, schedule() notifies only after it
+          w = get_runnable(index);
+          if(w != NULL){
+               lock.unlock();
+               run(w, index);
+               continue;
+          }
+
+          m_idle++;
+          m_idle_cond.wait(lock);
+          m_idle--;
+     }
+
+     HC_LOG_DEBUG("worker thread worker_pool end");
+}
+
+void worker_pool::run(worker* w, int index){
+     //called for every job batch, it does not trace
+
+     for(int i = 0; i < WORKER_POOL_MAX_BATCH; i++){
+          proxy_msg m;
+          {
+               boost::lock_guard<boost::mutex> lock(w->m_pool_lock);
+               if(w->m_pool_queue.empty()){
+                    break;
+               }
+               m = w->m_pool_queue.front();
+               w->m_pool_queue.pop_front();
+          }
+
+          HC_LOG_DEBUG("received new job. type: " << m.msg_type_to_string());
+          w->handle_msg(m);
+
+          if(!w->m_running){
+               w->finish();
+
+               //the worker stays scheduled, it is not run again, join() may release it after the notification
+               boost::lock_guard<boost::mutex> lock(w->m_pool_lock);
+               w->m_pool_finished = true;
+               w->m_pool_cond.notify_all();
+               return;
+          }
+     }
+
+     //schedule again if more jobs are waiting, the other workers of the run queue are processed before
+     bool more;
+     {
+          boost::lock_guard<boost::mutex> lock(w->m_pool_lock);
+          more = !w->m_pool_queue.empty();
+          if(!more){
+               w->m_pool_scheduled = false;
+          }
+     }
+
+     if(more){
+          run_queue* q = m_run_queues[index];
+          boost::lock_guard<boost::mutex> lock(q->lock);
+          q->workers.push_back(w);
+     }
+}
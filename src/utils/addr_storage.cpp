@@ -29,6 +29,21 @@
 #include <endian.h>
 #include <string>
 
+namespace {
+     //the address is stored at the position used by struct sockaddr_in or struct sockaddr_in6
+     inline struct in_addr* in_addr_of(const struct sockaddr_storage& s){
+          return &((struct sockaddr_in*)&s)->sin_addr;
+     }
+
+     inline struct in6_addr* in6_addr_of(const struct sockaddr_storage& s){
+          return &((struct sockaddr_in6*)&s)->sin6_addr;
+     }
+
+     inline void* addr_of(const struct sockaddr_storage& s){
+          return (s.ss_family == AF_INET6)? (void*)in6_addr_of(s) : (void*)in_addr_of(s);
+     }
+}
+
 addr_storage::addr_storage(){
      HC_LOG_TRACE("");
 
@@ -83,7 +98,7 @@ std::ostream& operator <<(std::ostream& s, const addr_storage a){
      HC_LOG_TRACE("");
 
      char addressBuffer[INET6_ADDRSTRLEN];
-     if(inet_ntop(a.m_addr.ss_family, (void*)&a.m_addr.__ss_align, addressBuffer, sizeof(addressBuffer)) != NULL){
+     if(inet_ntop(a.m_addr.ss_family, addr_of(a.m_addr), addressBuffer, sizeof(addressBuffer)) != NULL){
           s << addressBuffer;
      }else{
           HC_LOG_ERROR("failed to convert sockaddr_storage");
@@ -103,14 +118,14 @@ struct sockaddr_storage& operator<<=(struct sockaddr_storage& l, const struct ad
 struct in_addr& operator<<=(struct in_addr& l,const addr_storage& r){
      HC_LOG_TRACE("");
 
-     l = *(struct in_addr*)&r.m_addr.__ss_align;
+     l = *in_addr_of(r.m_addr);
      return l;
 }
 
 struct in6_addr& operator<<=(struct in6_addr& l,const addr_storage& r){
      HC_LOG_TRACE("");
 
-     l = *(struct in6_addr*)&r.m_addr.__ss_align;
+     l = *in6_addr_of(r.m_addr);
      return l;
 }
 
@@ -140,7 +155,7 @@ addr_storage& addr_storage::operator=(const std::string& s){
      m_addr.ss_family=AF_INET6;
 }
 
-if(inet_pton(m_addr.ss_family, s.c_str(), &m_addr.__ss_align)<1){
+if(inet_pton(m_addr.ss_family, s.c_str(), addr_of(m_addr))<1){
      HC_LOG_ERROR("failed to convert string to sockaddr_storage:" << s);
 }
 
@@ -151,7 +166,7 @@ addr_storage& addr_storage::operator=(const struct in_addr& s){
      HC_LOG_TRACE("");
 
      m_addr.ss_family = AF_INET;
-     *(struct in_addr*)&m_addr.__ss_align = s;
+     *in_addr_of(m_addr) = s;
      return *this;
 }
 
@@ -159,7 +174,7 @@ addr_storage& addr_storage::operator=(const struct in6_addr& s){
      HC_LOG_TRACE("");
 
      m_addr.ss_family = AF_INET6;
-     *(struct in6_addr*)&m_addr.__ss_align = s;
+     *in6_addr_of(m_addr) = s;
      return *this;
 }
 
@@ -168,9 +183,9 @@ addr_storage& addr_storage::operator=(const struct sockaddr& s){
 
      m_addr.ss_family = s.sa_family;
      if(s.sa_family == AF_INET){
-          *(struct in_addr*)&m_addr.__ss_align = ((struct sockaddr_in*)&s)->sin_addr;
+          *in_addr_of(m_addr) = ((struct sockaddr_in*)&s)->sin_addr;
      }else if(s.sa_family == AF_INET6){
-          *(struct in6_addr*)&m_addr.__ss_align =  ((struct sockaddr_in6*)&s)->sin6_addr;
+          *in6_addr_of(m_addr) =  ((struct sockaddr_in6*)&s)->sin6_addr;
      }else{
           HC_LOG_ERROR("failed to convert sockaddr_storage: unknown address family");
      }
@@ -204,10 +219,10 @@ bool operator< (const addr_storage& addr1, const addr_storage& addr2){
      HC_LOG_TRACE("");
 
      if(addr1.m_addr.ss_family == AF_INET && addr2.m_addr.ss_family == AF_INET){
-          return  ntohl(*((in_addr_t*) &addr1.m_addr.__ss_align)) < ntohl(*((in_addr_t*) &addr2.m_addr.__ss_align));
+          return  ntohl(in_addr_of(addr1.m_addr)->s_addr) < ntohl(in_addr_of(addr2.m_addr)->s_addr);
      }else if(addr1.m_addr.ss_family == AF_INET6 && addr2.m_addr.ss_family == AF_INET6){
-          const uint8_t* a1 = ((in6_addr*)&addr1.m_addr.__ss_align)->__in6_u.__u6_addr8;
-          const uint8_t* a2 = ((in6_addr*)&addr2.m_addr.__ss_align)->__in6_u.__u6_addr8;
+          const uint8_t* a1 = in6_addr_of(addr1.m_addr)->s6_addr;
+          const uint8_t* a2 = in6_addr_of(addr2.m_addr)->s6_addr;
 # if __BYTE_ORDER == __BIG_ENDIAN
           for(int i= sizeof(struct in6_addr)/sizeof(uint8_t)-1; i >= 0; i--){
 # else
@@ -244,7 +259,7 @@ std::string addr_storage::to_string() const{
      HC_LOG_TRACE("");
 
      char addressBuffer[INET6_ADDRSTRLEN];
-     if(inet_ntop(m_addr.ss_family, (void*)&m_addr.__ss_align, addressBuffer, sizeof(addressBuffer)) != NULL){
+     if(inet_ntop(m_addr.ss_family, addr_of(m_addr), addressBuffer, sizeof(addressBuffer)) != NULL){
           return std::string(addressBuffer);
      }else{
      HC_LOG_ERROR("failed to convert sockaddr_storage");
@@ -256,7 +271,7 @@ addr_storage& addr_storage::mask(const addr_storage& s){
      HC_LOG_TRACE("");
 
      if(this->m_addr.ss_family == AF_INET && s.m_addr.ss_family == AF_INET){
-          *((in_addr_t*) &this->m_addr.__ss_align) = *((in_addr_t*) &this->m_addr.__ss_align) & *((in_addr_t*) &s.m_addr.__ss_align);
+          in_addr_of(this->m_addr)->s_addr = in_addr_of(this->m_addr)->s_addr & in_addr_of(s.m_addr)->s_addr;
           return *this;
      }else {
      HC_LOG_ERROR("incompatible ip versions");
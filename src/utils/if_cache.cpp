@@ -0,0 +1,169 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * mcproxy is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * mcproxy is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with mcproxy; see the file COPYING.LESSER.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+
+
+#include "include/hamcast_logging.h"
+#include "include/utils/if_cache.hpp"
+
+#include <ifaddrs.h>
+#include <net/if.h>
+#include <errno.h>
+#include <cstring>
+#include <iostream>
+
+if_cache::if_cache():
+     m_snapshot(new if_cache_map())
+{
+     HC_LOG_TRACE("");
+}
+
+if_cache* if_cache::getInstance(){
+     HC_LOG_TRACE("");
+     static if_cache instance;
+     return &instance;
+}
+
+bool if_cache::refresh(){
+     HC_LOG_TRACE("");
+
+     boost::lock_guard<boost::mutex> lock(m_refresh_lock);
+
+     struct ifaddrs* if_addrs = NULL;
+     if(getifaddrs(&if_addrs) < 0){
+          HC_LOG_ERROR("getifaddrs failed! Error: " << strerror(errno) << " errno: " << errno);
+          return false;
+     }
+
+     boost::shared_ptr<if_cache_map> new_map(new if_cache_map());
+     map<string, int> name_index; //one if_nametoindex per interface and refresh
+
+     for(struct ifaddrs* item = if_addrs; item != NULL; item = item->ifa_next){
+          if(item->ifa_name == NULL){
+               continue;
+          }
+
+          int if_index;
+          map<string, int>::iterator it_name = name_index.find(item->ifa_name);
+          if(it_name == name_index.end()){
+               if_index = if_nametoindex(item->ifa_name);
+               name_index.insert(pair<string, int>(item->ifa_name, if_index));
+          }else{
+               if_index = it_name->second;
+          }
+
+          if(if_index == 0){ //removed in the meantime
+               continue;
+          }
+
+          struct if_cache_entry& entry = (*new_map)[if_index];
+          entry.if_index = if_index;
+          entry.name = item->ifa_name;
+          entry.flags = item->ifa_flags;
+
+          if(item->ifa_addr == NULL){
+               continue;
+          }
+
+          int family = item->ifa_addr->sa_family;
+          if(family != AF_INET && family != AF_INET6){
+               continue; //e.g. AF_PACKET
+          }
+
+          struct if_cache_addr a;
+          a.addr = *(item->ifa_addr);
+          if(item->ifa_netmask != NULL){
+               a.netmask = *(item->ifa_netmask);
+          }
+          if((item->ifa_flags & IFF_POINTOPOINT) && item->ifa_dstaddr != NULL){
+               a.dstaddr = *(item->ifa_dstaddr);
+          }
+
+          if(family == AF_INET){
+               entry.ipv4.push_back(a);
+          }else{
+               entry.ipv6.push_back(a);
+          }
+     }
+
+     freeifaddrs(if_addrs);
+
+     if_cache_snapshot snapshot(new_map);
+     boost::atomic_store(&m_snapshot, snapshot);
+
+     HC_LOG_DEBUG("refreshed interface cache with " << snapshot->size() << " interfaces");
+     return true;
+}
+
+if_cache_snapshot if_cache::get_snapshot() const{
+     HC_LOG_TRACE("");
+     return boost::atomic_load(&m_snapshot);
+}
+
+const struct if_cache_entry* if_cache::find(const if_cache_snapshot& snapshot, int if_index){
+     HC_LOG_TRACE("");
+
+     if_cache_map::const_iterator it = snapshot->find(if_index);
+     if(it == snapshot->end()){
+          return NULL;
+     }
+     return &it->second;
+}
+
+string if_cache::get_name(int if_index) const{
+     HC_LOG_TRACE("");
+
+     const struct if_cache_entry* entry = find(get_snapshot(), if_index);
+     if(entry == NULL){
+          return string();
+     }
+     return entry->name;
+}
+
+void if_cache::test_if_cache(){
+     HC_LOG_TRACE("");
+
+     if_cache* c = if_cache::getInstance();
+     if(!c->refresh()){
+          cout << "refresh ==>FAILED!" << endl;
+          return;
+     }
+
+     if_cache_snapshot s = c->get_snapshot();
+     for(if_cache_map::const_iterator it = s->begin(); it != s->end(); it++){
+          const struct if_cache_entry& e = it->second;
+          cout << e.if_index << ": " << e.name << " flags: " << hex << e.flags << dec;
+          cout << ((e.flags & IFF_UP)? " UP" : "") << ((e.flags & IFF_RUNNING)? " RUNNING" : "") << endl;
+
+          for(unsigned int i = 0; i < e.ipv4.size(); i++){
+               cout << "\t" << e.ipv4[i].addr << " netmask: " << e.ipv4[i].netmask << endl;
+          }
+          for(unsigned int i = 0; i < e.ipv6.size(); i++){
+               cout << "\t" << e.ipv6[i].addr << " netmask: " << e.ipv6[i].netmask << endl;
+          }
+
+          if(c->get_name(e.if_index) != e.name){
+               cout << "get_name ==>FAILED!" << endl;
+               return;
+          }
+     }
+     cout << "if_cache: " << s->size() << " interfaces ==>OK!" << endl;
+}
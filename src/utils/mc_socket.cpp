@@ -270,6 +270,21 @@ bool mc_socket::send_packet(const char* addr, int port, const unsigned char* dat
     }
 }
 
+//called for every sent query, it does not trace
+bool mc_socket::send_packet(const struct sockaddr* addr, socklen_t addr_len, const unsigned char* data, unsigned int data_size) {
+    if (!is_udp_valid()) {
+        HC_LOG_ERROR("udp_socket invalid");
+        return false;
+    }
+
+    if (sendto(m_sock, data, data_size, 0, addr, addr_len) == -1) {
+        HC_LOG_ERROR("failed to send! Error: " << strerror(errno)  << " errno: " << errno);
+        return false; //failed to send
+    } else {
+        return true;
+    }
+}
+
 bool mc_socket::receive_packet(unsigned char* buf, int sizeOfBuf, int &sizeOfInfo) {
     HC_LOG_TRACE("");
 
@@ -370,6 +385,11 @@ bool mc_socket::receive_msg(struct msghdr* msg, int &sizeOfInfo){
     //     //#######################
 }
 
+int mc_socket::get_socket() const{
+    HC_LOG_TRACE("");
+    return m_sock;
+}
+
 bool mc_socket::set_receive_timeout(long msec){
     HC_LOG_TRACE("");
 
@@ -566,6 +586,84 @@ bool mc_socket::leave_group(const char* addr, int if_index) {
 
 }
 
+bool mc_socket::change_group(int optname, const addr_storage& g_addr, int if_index){
+    HC_LOG_TRACE("");
+
+    struct group_req req;
+    memset(&req, 0, sizeof(req));
+    req.gr_interface = if_index;
+    req.gr_group <<= g_addr;
+
+    int level = family_to_level(g_addr.get_addr_family());
+    if (level == -1) {
+        HC_LOG_ERROR("wrong address family of group: " << g_addr);
+        return false;
+    }
+
+    if (setsockopt (m_sock, level, optname, &req, sizeof(req)) == -1) {
+        HC_LOG_ERROR("failed to " << ((optname == MCAST_JOIN_GROUP)? "join " : "leave ") << g_addr << "! Error: " << strerror(errno) << " errno: " << errno);
+        return false;
+    } else {
+        return true;
+    }
+}
+
+bool mc_socket::join_group(const addr_storage& g_addr, int if_index) {
+    HC_LOG_TRACE("");
+
+    if (!is_udp_valid()) {
+        HC_LOG_ERROR("udp_socket invalid");
+        return false;
+    }
+
+    return change_group(MCAST_JOIN_GROUP, g_addr, if_index);
+}
+
+bool mc_socket::leave_group(const addr_storage& g_addr, int if_index) {
+    HC_LOG_TRACE("");
+
+    if (!is_udp_valid()) {
+        HC_LOG_ERROR("udp_socket invalid");
+        return false;
+    }
+
+    return change_group(MCAST_LEAVE_GROUP, g_addr, if_index);
+}
+
+bool mc_socket::join_groups(const std::vector<addr_storage>& g_addrs, int if_index) {
+    HC_LOG_TRACE("count: " << g_addrs.size());
+
+    if (!is_udp_valid()) {
+        HC_LOG_ERROR("udp_socket invalid");
+        return false;
+    }
+
+    bool correct = true;
+    for (unsigned int i = 0; i < g_addrs.size(); i++) {
+        if (!change_group(MCAST_JOIN_GROUP, g_addrs[i], if_index)) {
+            correct = false;
+        }
+    }
+    return correct;
+}
+
+bool mc_socket::leave_groups(const std::vector<addr_storage>& g_addrs, int if_index) {
+    HC_LOG_TRACE("count: " << g_addrs.size());
+
+    if (!is_udp_valid()) {
+        HC_LOG_ERROR("udp_socket invalid");
+        return false;
+    }
+
+    bool correct = true;
+    for (unsigned int i = 0; i < g_addrs.size(); i++) {
+        if (!change_group(MCAST_LEAVE_GROUP, g_addrs[i], if_index)) {
+            correct = false;
+        }
+    }
+    return correct;
+}
+
 void mc_socket::test_join_leave_send(){
     HC_LOG_TRACE("");
 
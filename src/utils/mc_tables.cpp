@@ -30,8 +30,19 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/socket.h>
-
-mc_tables::mc_tables(): m_addr_family(-1){
+#include <sys/time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <endian.h>
+#include <stdint.h>
+#include <arpa/inet.h>
+
+mc_tables::mc_tables(): m_addr_family(-1), m_read_buf_len(0){
+     m_vif_table.addr_family = -1;
+     m_vif_table.size = 0;
+     m_route_table.addr_family = -1;
+     m_route_table.size = 0;
 }
 
 string mc_tables::int2str(int x){
@@ -442,20 +453,25 @@ void mc_tables::print_vif_info(struct mr_vif& t){
 bool mc_tables::refresh_routes(){
      HC_LOG_TRACE("");
 
+     if(m_addr_family == AF_INET){
+          return refresh_routes(MR_CACHE_PATH_V4);
+     }else if(m_addr_family == AF_INET6){
+          return refresh_routes(MR_CACHE_PATH_V6);
+     }else{
+          HC_LOG_ERROR("wrong address family");
+          return false;
+     }
+}
+
+bool mc_tables::refresh_routes(const string& path){
+     HC_LOG_TRACE("");
+
      m_mr_cache.clear();
 
      ifstream file;
      char cstr[MAX_N_LINE_LENGTH];
 
      if(m_addr_family == AF_INET || m_addr_family == AF_INET6){
-          //--IPv4--
-          string path;
-          if(m_addr_family == AF_INET){
-               path = MR_CACHE_PATH_V4;
-          }else{
-               path = MR_CACHE_PATH_V6;
-          }
-
           file.open(path.c_str());
           if(!file){
                HC_LOG_ERROR("can't open file: " << path);
@@ -488,6 +504,7 @@ bool mc_tables::refresh_routes(){
                          strline >> cache_tmp.bytes;
                          strline >> cache_tmp.wrong;
 
+                         cache_tmp.o_if.clear();
                          while (!strline.eof()){
                               stringstream substr;
                               int o_if=0;
@@ -559,6 +576,404 @@ void mc_tables::print_route_info(struct mr_cache& t){
      cout << endl;
 }
 
+//#####################
+//##-- fast parser --##
+//#####################
+
+namespace {
+     //value of a hex digit, only valid for [0-9a-fA-F]
+     inline unsigned int hex_value(char c){
+          return (c & 0x0F) + 9 * ((c >> 6) & 0x01);
+     }
+
+     inline bool is_hex(char c){
+          return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+     }
+
+     inline void skip_blank(const char*& p, const char* end){
+          while(p < end && (*p == ' ' || *p == '\t')){
+               p++;
+          }
+     }
+
+     inline void skip_line(const char*& p, const char* end){
+          const char* nl = (const char*)memchr(p, '\n', end - p);
+          p = (nl == NULL)? end : nl + 1;
+     }
+
+     inline void skip_token(const char*& p, const char* end){
+          while(p < end && *p != ' ' && *p != '\t' && *p != '\n'){
+               p++;
+          }
+     }
+
+     //decode eight hex digits, most significant digit first
+     inline uint32_t decode_hex32(const char* p){
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+          //decode all eight digits at once, the first digit is the lowest byte of x
+          uint64_t x;
+          memcpy(&x, p, sizeof(x));
+          x = (x & 0x0F0F0F0F0F0F0F0FULL) + 9 * ((x >> 6) & 0x0101010101010101ULL);
+          x = ((x & 0x000F000F000F000FULL) << 4) | ((x >> 8) & 0x000F000F000F000FULL);
+          x = ((x & 0x000000FF000000FFULL) << 8) | ((x >> 16) & 0x000000FF000000FFULL);
+          return (uint32_t)(((x & 0xFFFF) << 16) | ((x >> 32) & 0xFFFF));
+#else
+          uint32_t v = 0;
+          for(int i = 0; i < 8; i++){
+               v = (v << 4) | hex_value(p[i]);
+          }
+          return v;
+#endif
+     }
+
+     inline bool is_delimiter(const char* p, const char* end){
+          return p == end || *p == ' ' || *p == '\t' || *p == '\n';
+     }
+
+     //decode a token of exactly eight hex digits
+     inline bool parse_hex32(const char*& p, const char* end, uint32_t& value){
+          skip_blank(p, end);
+          if(end - p < 8){
+               return false;
+          }
+          value = decode_hex32(p);
+          p += 8;
+          return is_delimiter(p, end);
+     }
+
+     //decode an IPv6 address printed as 32 hex digits with or without colons
+     inline bool parse_hex128(const char*& p, const char* end, struct in6_addr& addr){
+          skip_blank(p, end);
+          if(end - p >= 32 && is_hex(p[4])){
+               for(int i = 0; i < 4; i++){
+                    addr.s6_addr32[i] = htonl(decode_hex32(p));
+                    p += 8;
+               }
+               return is_delimiter(p, end);
+          }
+
+          for(int i = 0; i < 16; i++){
+               if(p < end && *p == ':'){
+                    p++;
+               }
+               if(end - p < 2 || !is_hex(p[0]) || !is_hex(p[1])){
+                    return false;
+               }
+               addr.s6_addr[i] = (hex_value(p[0]) << 4) | hex_value(p[1]);
+               p += 2;
+          }
+          return is_delimiter(p, end);
+     }
+
+     //decode a hex number of variable length
+     inline bool parse_hex(const char*& p, const char* end, unsigned int& value){
+          skip_blank(p, end);
+          if(p >= end || !is_hex(*p)){
+               return false;
+          }
+          unsigned int v = 0;
+          while(p < end && is_hex(*p)){
+               v = (v << 4) | hex_value(*p);
+               p++;
+          }
+          value = v;
+          return true;
+     }
+
+     inline bool parse_ulong(const char*& p, const char* end, unsigned long& value){
+          skip_blank(p, end);
+          if(p >= end || *p < '0' || *p > '9'){
+               return false;
+          }
+          unsigned long v = 0;
+          while(p < end && *p >= '0' && *p <= '9'){
+               v = v * 10 + (*p - '0');
+               p++;
+          }
+          value = v;
+          return true;
+     }
+
+     inline bool parse_int(const char*& p, const char* end, int& value){
+          skip_blank(p, end);
+          bool negative = false;
+          if(p < end && *p == '-'){
+               negative = true;
+               p++;
+          }
+          unsigned long v;
+          if(!parse_ulong(p, end, v)){
+               return false;
+          }
+          value = negative? -(int)v : (int)v;
+          return true;
+     }
+}
+
+bool mc_tables::read_file(const char* path){
+     HC_LOG_TRACE("path: " << path);
+
+     int fd = open(path, O_RDONLY);
+     if(fd < 0){
+          HC_LOG_ERROR("can't open file: " << path << "! Error: " << strerror(errno) << " errno: " << errno);
+          return false;
+     }
+
+     if(m_read_buf.size() < MC_TABLES_READ_BUF_SIZE){
+          m_read_buf.resize(MC_TABLES_READ_BUF_SIZE);
+     }
+
+     m_read_buf_len = 0;
+     for(;;){
+          if(m_read_buf_len == m_read_buf.size()){
+               m_read_buf.resize(m_read_buf.size() * 2);
+          }
+
+          ssize_t rc = read(fd, &m_read_buf[m_read_buf_len], m_read_buf.size() - m_read_buf_len);
+          if(rc < 0){
+               if(errno == EINTR){
+                    continue;
+               }
+               HC_LOG_ERROR("failed to read file: " << path << "! Error: " << strerror(errno) << " errno: " << errno);
+               ::close(fd);
+               return false;
+          }else if(rc == 0){
+               break;
+          }
+          m_read_buf_len += rc;
+     }
+
+     ::close(fd);
+     return true;
+}
+
+unsigned int mc_tables::count_lines(){
+     HC_LOG_TRACE("");
+
+     unsigned int lines = 0;
+     const char* p = m_read_buf_len > 0? &m_read_buf[0] : NULL;
+     const char* end = p + m_read_buf_len;
+     while(p < end && (p = (const char*)memchr(p, '\n', end - p)) != NULL){
+          lines++;
+          p++;
+     }
+     return lines;
+}
+
+void mc_tables::reserve_vif_table(unsigned int rows){
+     HC_LOG_TRACE("rows: " << rows);
+
+     struct mr_vif_table& t = m_vif_table;
+     if(t.vifi.size() < rows){
+          t.vifi.resize(rows);
+          t.ifname.resize(rows);
+          t.bytes_in.resize(rows);
+          t.pkts_in.resize(rows);
+          t.bytes_out.resize(rows);
+          t.pkts_out.resize(rows);
+          t.flags.resize(rows);
+          t.lcl_addr.resize(rows);
+          t.remote.resize(rows);
+     }
+}
+
+void mc_tables::reserve_route_table(unsigned int rows){
+     HC_LOG_TRACE("rows: " << rows);
+
+     struct mr_cache_table& t = m_route_table;
+     if(t.group.size() < rows){
+          t.group.resize(rows);
+          t.origin.resize(rows);
+          t.i_if.resize(rows);
+          t.pkts.resize(rows);
+          t.bytes.resize(rows);
+          t.wrong.resize(rows);
+          t.o_if_begin.resize(rows + 1);
+     }
+
+     if(t.o_if.size() < rows){
+          t.o_if.resize(rows);
+          t.o_ttl.resize(rows);
+     }
+}
+
+bool mc_tables::refresh_vif_table(const char* path){
+     HC_LOG_TRACE("");
+
+     struct mr_vif_table& t = m_vif_table;
+     t.size = 0;
+     t.addr_family = m_addr_family;
+
+     if(m_addr_family == AF_INET){
+          if(path == NULL) path = VIF_PATH_V4;
+     }else if(m_addr_family == AF_INET6){
+          if(path == NULL) path = VIF_PATH_V6;
+     }else{
+          HC_LOG_ERROR("wrong address family");
+          return false;
+     }
+
+     if(!read_file(path)){
+          return false;
+     }
+
+     reserve_vif_table(count_lines() + 1);
+
+     const char* p = m_read_buf_len > 0? &m_read_buf[0] : NULL;
+     const char* end = p + m_read_buf_len;
+     unsigned int row = 0;
+
+     skip_line(p, end); //table header
+     while(p < end){
+          const char* ifname;
+          bool ok = parse_int(p, end, t.vifi[row]);
+
+          skip_blank(p, end);
+          ifname = p;
+          skip_token(p, end);
+          t.ifname[row].assign(ifname, p - ifname);
+
+          ok = ok && parse_ulong(p, end, t.bytes_in[row]);
+          ok = ok && parse_ulong(p, end, t.pkts_in[row]);
+          ok = ok && parse_ulong(p, end, t.bytes_out[row]);
+          ok = ok && parse_ulong(p, end, t.pkts_out[row]);
+          ok = ok && parse_hex(p, end, t.flags[row]);
+
+          if(m_addr_family == AF_INET){
+               ok = ok && parse_hex32(p, end, t.lcl_addr[row].s_addr);
+               ok = ok && parse_hex32(p, end, t.remote[row].s_addr);
+          }
+
+          if(ok){
+               row++;
+          }else{
+               HC_LOG_ERROR("malformed line " << row + 1 << " in file: " << path);
+          }
+          skip_line(p, end);
+     }
+
+     t.size = row;
+     return true;
+}
+
+const struct mr_vif_table& mc_tables::get_vif_table() const{
+     HC_LOG_TRACE("");
+     return m_vif_table;
+}
+
+bool mc_tables::refresh_route_table(const char* path){
+     HC_LOG_TRACE("");
+
+     struct mr_cache_table& t = m_route_table;
+     t.size = 0;
+     t.addr_family = m_addr_family;
+
+     if(m_addr_family == AF_INET){
+          if(path == NULL) path = MR_CACHE_PATH_V4;
+     }else if(m_addr_family == AF_INET6){
+          if(path == NULL) path = MR_CACHE_PATH_V6;
+     }else{
+          HC_LOG_ERROR("wrong address family");
+          return false;
+     }
+
+     if(!read_file(path)){
+          return false;
+     }
+
+     reserve_route_table(count_lines() + 1);
+
+     const char* p = m_read_buf_len > 0? &m_read_buf[0] : NULL;
+     const char* end = p + m_read_buf_len;
+     unsigned int row = 0;
+     unsigned int n_oif = 0;
+
+     skip_line(p, end); //table header
+     while(p < end){
+          bool ok;
+          if(m_addr_family == AF_INET){
+               ok = parse_hex32(p, end, t.group[row].v4.s_addr);
+               ok = ok && parse_hex32(p, end, t.origin[row].v4.s_addr);
+          }else{
+               ok = parse_hex128(p, end, t.group[row].v6);
+               ok = ok && parse_hex128(p, end, t.origin[row].v6);
+          }
+
+          ok = ok && parse_int(p, end, t.i_if[row]);
+          ok = ok && parse_ulong(p, end, t.pkts[row]);
+          ok = ok && parse_ulong(p, end, t.bytes[row]);
+          ok = ok && parse_ulong(p, end, t.wrong[row]);
+
+          //output interfaces "vif:ttl"
+          t.o_if_begin[row] = n_oif;
+          skip_blank(p, end);
+          while(ok && p < end && *p != '\n'){
+               if(n_oif == t.o_if.size()){
+                    t.o_if.resize(2 * n_oif);
+                    t.o_ttl.resize(2 * n_oif);
+               }
+
+               ok = parse_int(p, end, t.o_if[n_oif]) && p < end && *p == ':';
+               if(ok){
+                    p++;
+                    ok = parse_int(p, end, t.o_ttl[n_oif]);
+               }
+               n_oif++;
+               skip_blank(p, end);
+          }
+
+          if(ok){
+               row++;
+          }else{
+               HC_LOG_ERROR("malformed line " << row + 1 << " in file: " << path);
+               n_oif = t.o_if_begin[row];
+          }
+          skip_line(p, end);
+     }
+
+     t.o_if_begin[row] = n_oif;
+     t.size = row;
+     return true;
+}
+
+const struct mr_cache_table& mc_tables::get_route_table() const{
+     HC_LOG_TRACE("");
+     return m_route_table;
+}
+
+int mc_tables::find_route(int vif, const addr_storage& src_addr, const addr_storage& g_addr) const{
+     HC_LOG_TRACE("");
+
+     const struct mr_cache_table& t = m_route_table;
+     if(t.addr_family == AF_INET){
+          struct in_addr src;
+          struct in_addr g;
+          src <<= src_addr;
+          g <<= g_addr;
+
+          for(unsigned int i = 0; i < t.size; i++){
+               if(t.group[i].v4.s_addr == g.s_addr && t.origin[i].v4.s_addr == src.s_addr && t.i_if[i] == vif){
+                    return i;
+               }
+          }
+     }else if(t.addr_family == AF_INET6){
+          struct in6_addr src;
+          struct in6_addr g;
+          src <<= src_addr;
+          g <<= g_addr;
+
+          for(unsigned int i = 0; i < t.size; i++){
+               if(IN6_ARE_ADDR_EQUAL(&t.group[i].v6, &g) && IN6_ARE_ADDR_EQUAL(&t.origin[i].v6, &src) && t.i_if[i] == vif){
+                    return i;
+               }
+          }
+     }else{
+          HC_LOG_ERROR("wrong address family");
+     }
+
+     return -1;
+}
+
 //###############
 //##-- snmp6 --##
 //###############
@@ -908,6 +1323,82 @@ void mc_tables::test_mr_cache(int addrFamily){
      cout << endl;
 }
 
+void mc_tables::test_route_table_bench(int addrFamily){
+     HC_LOG_TRACE("");
+
+     const unsigned int rows[] = {10000, 100000};
+     char line[MAX_N_LINE_LENGTH];
+
+     for(unsigned int r = 0; r < sizeof(rows)/sizeof(rows[0]); r++){
+          ostringstream path_stream;
+          path_stream << "/tmp/mcproxy_mr_cache_" << rows[r];
+          string path = path_stream.str();
+
+          //--generate the table--
+          FILE* f = fopen(path.c_str(), "w");
+          if(f == NULL){
+               cout << "can't create file: " << path << " ==>FAILED!" << endl;
+               return;
+          }
+          fprintf(f, "Group    Origin   Iif     Pkts    Bytes    Wrong Oifs\n");
+          for(unsigned int i = 0; i < rows[r]; i++){
+               int n;
+               if(addrFamily == AF_INET){
+                    struct in_addr g;
+                    struct in_addr src;
+                    g.s_addr = htonl(0xEF000000 | (i & 0xFFFF));
+                    src.s_addr = htonl(0x0A000000 | (i >> 4));
+                    n = snprintf(line, sizeof(line), "%08X %08X %-3d", g.s_addr, src.s_addr, i % 8);
+               }else{
+                    unsigned int a[8] = {0xff0e, 0, 0, 0, 0, 0, i >> 16, i & 0xFFFF};
+                    unsigned int b[8] = {0x2001, 0x0db8, 0, 0, 0, 0, i >> 20, (i >> 4) & 0xFFFF};
+                    n = snprintf(line, sizeof(line), "%04x:%04x:%04x:%04x:%04x:%04x:%04x:%04x %04x:%04x:%04x:%04x:%04x:%04x:%04x:%04x %-3d",
+                                 a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], b[0], b[1], b[2], b[3], b[4], b[5], b[6], b[7], i % 8);
+               }
+               snprintf(line + n, sizeof(line) - n, " %8u %8u %8u  %2d:%-3d %2d:%-3d\n", i, i * 100, 0, (i + 1) % 8, 1, (i + 2) % 8, 1);
+               fputs(line, f);
+          }
+          fclose(f);
+
+          //--parse it with both parsers--
+          mc_tables t;
+          struct timeval start;
+          struct timeval stop;
+          t.init_tables(addrFamily);
+
+          gettimeofday(&start, NULL);
+          bool ok = t.refresh_routes(path);
+          gettimeofday(&stop, NULL);
+          long stream_usec = (stop.tv_sec - start.tv_sec) * 1000000 + (stop.tv_usec - start.tv_usec);
+
+          gettimeofday(&start, NULL);
+          ok = t.refresh_route_table(path.c_str()) && ok;
+          gettimeofday(&stop, NULL);
+          long fast_usec = (stop.tv_sec - start.tv_sec) * 1000000 + (stop.tv_usec - start.tv_usec);
+
+          //second run with the warm read buffer and snapshot
+          gettimeofday(&start, NULL);
+          ok = t.refresh_route_table(path.c_str()) && ok;
+          gettimeofday(&stop, NULL);
+          long fast_warm_usec = (stop.tv_sec - start.tv_sec) * 1000000 + (stop.tv_usec - start.tv_usec);
+
+          //--compare the results--
+          const struct mr_cache_table& table = t.get_route_table();
+          ok = ok && t.get_routes_count() == rows[r] && table.size == rows[r];
+          for(unsigned int i = 0; ok && i < rows[r]; i += rows[r] / 100){
+               const struct mr_cache& c = t.get_route(i);
+               int row = t.find_route(c.i_if, c.origin, c.group);
+               ok = row == (int)i && table.pkts[row] == (unsigned long)c.pkts
+                    && table.o_if_begin[row + 1] - table.o_if_begin[row] == 2 && table.o_if[table.o_if_begin[row]] == c.o_if[0];
+          }
+
+          cout << rows[r] << " rows: stream parser " << stream_usec / 1000 << "ms, fast parser " << fast_usec / 1000
+               << "ms (warm " << fast_warm_usec / 1000 << "ms) ==>" << (ok? "OK!" : "FAILED!") << endl;
+
+          unlink(path.c_str());
+     }
+}
+
 void mc_tables::test_snmp6(){
      HC_LOG_TRACE("");
 
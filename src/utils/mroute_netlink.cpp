@@ -0,0 +1,559 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * mcproxy is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * mcproxy is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with mcproxy; see the file COPYING.LESSER.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+
+
+#include "include/hamcast_logging.h"
+#include "include/utils/mroute_netlink.hpp"
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <linux/mroute.h>
+#include <errno.h>
+#include <cstring>
+#include <iostream>
+#include <sys/time.h>
+#include <net/if.h>
+#include <arpa/inet.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+mroute_netlink::mroute_netlink():
+     m_addr_family(-1), m_batch_len(0), m_sent(0)
+{
+     HC_LOG_TRACE("");
+}
+
+bool mroute_netlink::init(int addr_family){
+     HC_LOG_TRACE("");
+
+     if(addr_family != AF_INET && addr_family != AF_INET6){
+          HC_LOG_ERROR("wrong addr_family: " << addr_family);
+          return false;
+     }
+     m_addr_family = addr_family;
+
+     if(!m_sock.create_rtnl_socket(0)) return false;
+     if(!m_sock.set_receive_timeout(MROUTE_NETLINK_TIMEOUT)) return false;
+     if(!m_sock.set_receive_buffer(MROUTE_NETLINK_RCVBUF_SIZE)){
+          HC_LOG_WARN("acks of large batches can be lost");
+     }
+
+     return true;
+}
+
+bool mroute_netlink::dump_routes(struct mr_cache_table& table){
+     HC_LOG_TRACE("");
+
+     table.addr_family = m_addr_family;
+     table.size = 0;
+     if(table.o_if_begin.empty()){
+          table.o_if_begin.resize(1);
+     }
+     table.o_if_begin[0] = 0;
+
+     if(!m_sock.is_valid()){
+          HC_LOG_ERROR("netlink socket invalid");
+          return false;
+     }
+
+     //the dump has to see the queued operations
+     if(m_batch_len > 0 && !flush()) return false;
+
+     struct {
+          struct nlmsghdr nlh;
+          struct rtmsg rtm;
+     } req;
+     memset(&req, 0, sizeof(req));
+     req.nlh.nlmsg_len = NLMSG_LENGTH(sizeof(struct rtmsg));
+     req.nlh.nlmsg_type = RTM_GETROUTE;
+     req.nlh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+     req.nlh.nlmsg_seq = m_sock.next_seq();
+     req.rtm.rtm_family = (m_addr_family == AF_INET)? RTNL_FAMILY_IPMR : RTNL_FAMILY_IP6MR;
+
+     if(!m_sock.send(&req, req.nlh.nlmsg_len)) return false;
+
+     for(;;){
+          int len = m_sock.receive(m_buf, false);
+          if(len <= 0){
+               HC_LOG_ERROR("route dump incomplete");
+               return false;
+          }
+
+          for(struct nlmsghdr* nlh = (struct nlmsghdr*)&m_buf[0]; NLMSG_OK(nlh, (unsigned int)len); nlh = NLMSG_NEXT(nlh, len)){
+               if(nlh->nlmsg_seq != req.nlh.nlmsg_seq){
+                    if(nlh->nlmsg_type == NLMSG_ERROR){
+                         handle_ack(nlh);
+                    }
+                    continue;
+               }
+
+               if(nlh->nlmsg_type == NLMSG_DONE){
+                    return true;
+               }else if(nlh->nlmsg_type == NLMSG_ERROR){
+                    struct nlmsgerr* err = (struct nlmsgerr*)NLMSG_DATA(nlh);
+                    HC_LOG_ERROR("route dump failed! Error: " << strerror(-err->error) << " errno: " << -err->error);
+                    return false;
+               }else if(nlh->nlmsg_type == RTM_NEWROUTE){
+                    add_route_row(table, nlh);
+               }
+          }
+     }
+}
+
+bool mroute_netlink::add_route_row(struct mr_cache_table& table, struct nlmsghdr* nlh){
+     HC_LOG_TRACE("");
+
+     struct rtmsg* rtm = (struct rtmsg*)NLMSG_DATA(nlh);
+     struct rtattr* tb[RTA_MAX + 1];
+     int len = nlh->nlmsg_len - NLMSG_LENGTH(sizeof(*rtm));
+     if(len < 0){
+          HC_LOG_ERROR("malformed route message");
+          return false;
+     }
+     netlink_socket::parse_attr(tb, RTA_MAX, RTM_RTA(rtm), len);
+
+     //only the default table, unresolved entries are waiting for the proxy and not forwarded yet
+     //(the default table of ip6mr is RT_TABLE_MAIN if the kernel is built without CONFIG_IPV6_MULTIPLE_TABLES)
+     unsigned int rt_table = tb[RTA_TABLE]? *(unsigned int*)RTA_DATA(tb[RTA_TABLE]) : rtm->rtm_table;
+     bool default_table = (rt_table == RT_TABLE_DEFAULT) || (m_addr_family == AF_INET6 && rt_table == RT_TABLE_MAIN);
+     if(!default_table || (rtm->rtm_flags & RTNH_F_UNRESOLVED) || tb[RTA_IIF] == NULL || tb[RTA_SRC] == NULL || tb[RTA_DST] == NULL){
+          return false;
+     }
+
+     unsigned int addr_size = (m_addr_family == AF_INET)? sizeof(struct in_addr) : sizeof(struct in6_addr);
+     if(RTA_PAYLOAD(tb[RTA_SRC]) < addr_size || RTA_PAYLOAD(tb[RTA_DST]) < addr_size){
+          HC_LOG_ERROR("malformed route address");
+          return false;
+     }
+
+     unsigned int row = table.size;
+     if(table.group.size() <= row){
+          unsigned int rows = 2 * row + 64;
+          table.group.resize(rows);
+          table.origin.resize(rows);
+          table.i_if.resize(rows);
+          table.pkts.resize(rows);
+          table.bytes.resize(rows);
+          table.wrong.resize(rows);
+          table.o_if_begin.resize(rows + 1);
+     }
+
+     memcpy(&table.group[row], RTA_DATA(tb[RTA_DST]), addr_size);
+     memcpy(&table.origin[row], RTA_DATA(tb[RTA_SRC]), addr_size);
+     table.i_if[row] = *(int*)RTA_DATA(tb[RTA_IIF]);
+
+     if(tb[RTA_MFC_STATS] != NULL && RTA_PAYLOAD(tb[RTA_MFC_STATS]) >= sizeof(struct rta_mfc_stats)){
+          struct rta_mfc_stats* stats = (struct rta_mfc_stats*)RTA_DATA(tb[RTA_MFC_STATS]);
+          table.pkts[row] = stats->mfcs_packets;
+          table.bytes[row] = stats->mfcs_bytes;
+          table.wrong[row] = stats->mfcs_wrong_if;
+     }else{
+          table.pkts[row] = 0;
+          table.bytes[row] = 0;
+          table.wrong[row] = 0;
+     }
+
+     unsigned int n_oif = table.o_if_begin[row];
+     if(tb[RTA_MULTIPATH] != NULL){
+          struct rtnexthop* rtnh = (struct rtnexthop*)RTA_DATA(tb[RTA_MULTIPATH]);
+          int nh_len = RTA_PAYLOAD(tb[RTA_MULTIPATH]);
+
+          while(nh_len >= (int)sizeof(*rtnh) && rtnh->rtnh_len <= nh_len){
+               if(table.o_if.size() <= n_oif){
+                    table.o_if.resize(2 * n_oif + 64);
+                    table.o_ttl.resize(2 * n_oif + 64);
+               }
+               table.o_if[n_oif] = rtnh->rtnh_ifindex;
+               table.o_ttl[n_oif] = rtnh->rtnh_hops;
+               n_oif++;
+
+               nh_len -= RTNH_ALIGN(rtnh->rtnh_len);
+               rtnh = RTNH_NEXT(rtnh);
+          }
+     }
+
+     table.size++;
+     table.o_if_begin[table.size] = n_oif;
+     return true;
+}
+
+bool mroute_netlink::add_route(int vif, int if_index, const addr_storage& src_addr, const addr_storage& g_addr, const unsigned int* output_vif, unsigned int output_vif_size){
+     HC_LOG_TRACE("");
+
+     return add_route_msg(true, vif, if_index, src_addr, g_addr, output_vif, output_vif_size);
+}
+
+bool mroute_netlink::del_route(int vif, int if_index, const addr_storage& src_addr, const addr_storage& g_addr){
+     HC_LOG_TRACE("");
+
+     return add_route_msg(false, vif, if_index, src_addr, g_addr, NULL, 0);
+}
+
+//called once per route, the public functions trace
+bool mroute_netlink::add_route_msg(bool add, int vif, int if_index, const addr_storage& src_addr, const addr_storage& g_addr, const unsigned int* output_vif, unsigned int output_vif_size){
+     if(m_addr_family != AF_INET){
+          HC_LOG_ERROR("batched routes are only supported for AF_INET");
+          return false;
+     }
+
+     if(!m_sock.is_valid()){
+          HC_LOG_ERROR("netlink socket invalid");
+          return false;
+     }
+
+     //the position of a nexthop in RTA_MULTIPATH is the output vif, rtnh_hops its ttl threshold
+     struct rtnexthop nh[MAXVIFS];
+     unsigned int nh_count = 0;
+     for(unsigned int i = 0; i < output_vif_size; i++){
+          if(output_vif[i] >= MAXVIFS){
+               HC_LOG_ERROR("output vif to large: " << output_vif[i]);
+               return false;
+          }
+          while(nh_count <= output_vif[i]){
+               memset(&nh[nh_count], 0, sizeof(nh[nh_count]));
+               nh[nh_count].rtnh_len = sizeof(nh[nh_count]);
+               nh_count++;
+          }
+          nh[output_vif[i]].rtnh_hops = MROUTE_DEFAULT_TTL;
+     }
+
+     unsigned int msg_size = NLMSG_SPACE(sizeof(struct rtmsg)) + 4 * RTA_SPACE(sizeof(unsigned int)) + RTA_SPACE(sizeof(nh));
+     if(m_batch_len + msg_size > MROUTE_NETLINK_BATCH_SIZE){
+          if(!flush()) return false;
+     }
+     if(m_batch.size() < MROUTE_NETLINK_BATCH_SIZE){
+          m_batch.resize(MROUTE_NETLINK_BATCH_SIZE);
+     }
+
+     struct nlmsghdr* nlh = (struct nlmsghdr*)&m_batch[m_batch_len];
+     unsigned int max_size = MROUTE_NETLINK_BATCH_SIZE - m_batch_len;
+     memset(nlh, 0, NLMSG_SPACE(sizeof(struct rtmsg)));
+     nlh->nlmsg_len = NLMSG_LENGTH(sizeof(struct rtmsg));
+     nlh->nlmsg_type = add? RTM_NEWROUTE : RTM_DELROUTE;
+     nlh->nlmsg_flags = NLM_F_REQUEST | NLM_F_ACK;
+     if(add){
+          nlh->nlmsg_flags |= NLM_F_CREATE | NLM_F_REPLACE;
+     }
+     nlh->nlmsg_seq = m_sock.next_seq();
+
+     struct rtmsg* rtm = (struct rtmsg*)NLMSG_DATA(nlh);
+     rtm->rtm_family = RTNL_FAMILY_IPMR;
+     rtm->rtm_dst_len = 32;
+     rtm->rtm_src_len = 32;
+     rtm->rtm_table = RT_TABLE_DEFAULT;
+     rtm->rtm_protocol = RTPROT_MROUTED; //owned by the multicast routing socket like MRT_ADD_MFC, not static
+     rtm->rtm_scope = RT_SCOPE_UNIVERSE;
+     rtm->rtm_type = RTN_MULTICAST;
+
+     unsigned int table = RT_TABLE_DEFAULT;
+     struct in_addr src;
+     struct in_addr g;
+     src <<= src_addr;
+     g <<= g_addr;
+
+     if(netlink_socket::add_attr(nlh, max_size, RTA_TABLE, &table, sizeof(table)) == NULL) return false;
+     if(netlink_socket::add_attr(nlh, max_size, RTA_SRC, &src, sizeof(src)) == NULL) return false;
+     if(netlink_socket::add_attr(nlh, max_size, RTA_DST, &g, sizeof(g)) == NULL) return false;
+     if(netlink_socket::add_attr(nlh, max_size, RTA_IIF, &if_index, sizeof(if_index)) == NULL) return false;
+     if(add && nh_count > 0){
+          if(netlink_socket::add_attr(nlh, max_size, RTA_MULTIPATH, nh, nh_count * sizeof(nh[0])) == NULL) return false;
+     }
+
+     m_batch_len += NLMSG_ALIGN(nlh->nlmsg_len);
+     m_ops.push_back(mroute_netlink_op(add, vif, src_addr, g_addr));
+     m_ops.back().seq = nlh->nlmsg_seq;
+     return true;
+}
+
+bool mroute_netlink::flush(){
+     HC_LOG_TRACE("");
+
+     if(m_batch_len > 0){
+          if(!m_sock.send(&m_batch[0], m_batch_len)){
+               while(m_ops.size() > m_sent){
+                    m_ops.back().error = -1;
+                    m_failed.push_back(m_ops.back());
+                    m_ops.pop_back();
+               }
+               m_batch_len = 0;
+               return false;
+          }
+
+          HC_LOG_DEBUG("sent batch with " << m_ops.size() - m_sent << " operations and " << m_batch_len << " byte");
+          m_sent = m_ops.size();
+          m_batch_len = 0;
+     }
+
+     receive_acks(false);
+     return true;
+}
+
+bool mroute_netlink::receive_acks(bool wait_all){
+     HC_LOG_TRACE("");
+
+     while(m_sent > 0){
+          int len = m_sock.receive(m_buf, !wait_all);
+          if(len == 0){
+               if(wait_all){
+                    HC_LOG_ERROR("timeout, " << m_sent << " operations are not acknowledged");
+               }
+               break;
+          }else if(len < 0){
+               //e.g. ENOBUFS, the acks are lost but the kernel has processed the operations
+               HC_LOG_WARN("lost the acks of " << m_sent << " operations");
+               m_ops.erase(m_ops.begin(), m_ops.begin() + m_sent);
+               m_sent = 0;
+               break;
+          }
+
+          for(struct nlmsghdr* nlh = (struct nlmsghdr*)&m_buf[0]; NLMSG_OK(nlh, (unsigned int)len); nlh = NLMSG_NEXT(nlh, len)){
+               if(nlh->nlmsg_type == NLMSG_ERROR){
+                    handle_ack(nlh);
+               }
+          }
+     }
+
+     return m_sent == 0;
+}
+
+//called once per route
+void mroute_netlink::handle_ack(struct nlmsghdr* nlh){
+     struct nlmsgerr* err = (struct nlmsgerr*)NLMSG_DATA(nlh);
+
+     //skip operations whose ack got lost
+     while(m_sent > 0 && (int)(m_ops.front().seq - nlh->nlmsg_seq) < 0){
+          m_ops.pop_front();
+          m_sent--;
+     }
+
+     if(m_sent == 0 || m_ops.front().seq != nlh->nlmsg_seq){
+          return; //not a batched operation
+     }
+
+     struct mroute_netlink_op& op = m_ops.front();
+     if(err->error != 0){
+          op.error = -err->error;
+          HC_LOG_ERROR("failed to " << (op.add? "add" : "delete") << " multicast route src: " << op.src_addr << " g: " << op.g_addr << "! Error: " << strerror(op.error) << " errno: " << op.error);
+          m_failed.push_back(op);
+     }
+     m_ops.pop_front();
+     m_sent--;
+}
+
+unsigned int mroute_netlink::pending() const{
+     HC_LOG_TRACE("");
+     return m_ops.size();
+}
+
+void mroute_netlink::swap_failed(vector<struct mroute_netlink_op>& failed){
+     HC_LOG_TRACE("");
+     failed.clear();
+     failed.swap(m_failed);
+}
+
+void mroute_netlink::test_dump_routes(int addr_family){
+     HC_LOG_TRACE("");
+
+     mroute_netlink m;
+     struct mr_cache_table t;
+     if(!m.init(addr_family) || !m.dump_routes(t)){
+          cout << "dump routes ==>FAILED!" << endl;
+          return;
+     }
+
+     cout << "Group\t\tOrigin\t\tIif\tPkts\tBytes\tWrong\tOifs" << endl;
+     for(unsigned int i = 0; i < t.size; i++){
+          addr_storage g = (addr_family == AF_INET)? addr_storage(t.group[i].v4) : addr_storage(t.group[i].v6);
+          addr_storage src = (addr_family == AF_INET)? addr_storage(t.origin[i].v4) : addr_storage(t.origin[i].v6);
+
+          cout << g << "\t" << src << "\t" << t.i_if[i] << "\t" << t.pkts[i] << "\t" << t.bytes[i] << "\t" << t.wrong[i] << "\t";
+          for(unsigned int o = t.o_if_begin[i]; o < t.o_if_begin[i + 1]; o++){
+               cout << t.o_if[o] << ":" << t.o_ttl[o] << " ";
+          }
+          cout << endl;
+     }
+     cout << "dump routes: " << t.size << " routes ==>OK!" << endl;
+}
+
+void mroute_netlink::test_route_batch_bench(mroute_socket* m, int count){
+     HC_LOG_TRACE("");
+
+     cout << "-- route batch bench (" << count << " routes) --" << endl;
+
+     mroute_netlink n;
+     if(!n.init(AF_INET)){
+          cout << "init ==>FAILED!" << endl;
+          return;
+     }
+
+     int vif_one = MROUTE_SOCKET_IF_NUM_ONE;
+     int if_one = if_nametoindex(MROUTE_SOCKET_IF_STR_ONE);
+     unsigned int output_vifs[] = {MROUTE_SOCKET_IF_NUM_TWO};
+     unsigned int output_vifs_size = sizeof(output_vifs) / sizeof(output_vifs[0]);
+
+     vector<addr_storage> groups;
+     for(int i = 0; i < count; i++){
+          struct in_addr g;
+          g.s_addr = htonl(0xef010000 + i); //239.1.x.x
+          groups.push_back(addr_storage(g));
+     }
+     addr_storage src(string(MROUTE_SOCKET_SRC_ADDR_V4));
+     string str_src = src.to_string();
+
+     struct timeval start, end;
+     bool ok = true;
+
+     //setsockopt
+     gettimeofday(&start, NULL);
+     for(int i = 0; i < count; i++){
+          ok &= m->add_mroute(vif_one, str_src.c_str(), groups[i].to_string().c_str(), output_vifs, output_vifs_size);
+     }
+     for(int i = 0; i < count; i++){
+          ok &= m->del_mroute(vif_one, str_src.c_str(), groups[i].to_string().c_str());
+     }
+     gettimeofday(&end, NULL);
+     cout << "setsockopt add+del: " << (end.tv_sec - start.tv_sec) * 1000000 + (end.tv_usec - start.tv_usec) << " usec" << endl;
+
+     //netlink batches
+     vector<struct mroute_netlink_op> failed;
+     gettimeofday(&start, NULL);
+     for(int i = 0; i < count; i++){
+          ok &= n.add_route(vif_one, if_one, src, groups[i], output_vifs, output_vifs_size);
+     }
+     ok &= n.flush();
+     ok &= n.receive_acks(true);
+     for(int i = 0; i < count; i++){
+          ok &= n.del_route(vif_one, if_one, src, groups[i]);
+     }
+     ok &= n.flush();
+     ok &= n.receive_acks(true);
+     gettimeofday(&end, NULL);
+     n.swap_failed(failed);
+     cout << "netlink batch add+del: " << (end.tv_sec - start.tv_sec) * 1000000 + (end.tv_usec - start.tv_usec) << " usec" << endl;
+
+     if(ok && failed.empty()){
+          cout << "route batch bench ==>OK!" << endl;
+     }else{
+          cout << "route batch bench: " << failed.size() << " failed operations ==>FAILED!" << endl;
+     }
+}
+
+unsigned int mroute_netlink::count_routes(const struct mr_cache_table& table, int if_index){
+     HC_LOG_TRACE("");
+
+     unsigned int count = 0;
+     for(unsigned int i = 0; i < table.size; i++){
+          if(table.i_if[i] == if_index){
+               count++;
+          }
+     }
+     return count;
+}
+
+bool mroute_netlink::set_link(const char* if_name, bool up){
+     HC_LOG_TRACE("");
+
+     int sock = socket(AF_INET, SOCK_DGRAM, 0);
+     if(sock < 0){
+          HC_LOG_ERROR("failed to create socket! Error: " << strerror(errno) << " errno: " << errno);
+          return false;
+     }
+
+     struct ifreq ifr;
+     memset(&ifr, 0, sizeof(ifr));
+     strncpy(ifr.ifr_name, if_name, IFNAMSIZ - 1);
+     bool ok = ioctl(sock, SIOCGIFFLAGS, &ifr) == 0;
+     if(ok){
+          if(up){
+               ifr.ifr_flags |= IFF_UP;
+          }else{
+               ifr.ifr_flags &= ~IFF_UP;
+          }
+          ok = ioctl(sock, SIOCSIFFLAGS, &ifr) == 0;
+     }
+     if(!ok){
+          HC_LOG_ERROR("failed to set the link of " << if_name << (up? " up" : " down") << "! Error: " << strerror(errno) << " errno: " << errno);
+     }
+
+     close(sock);
+     return ok;
+}
+
+void mroute_netlink::test_failover(int addr_family, const char* if_name, int timeout){
+     HC_LOG_TRACE("");
+
+     cout << "-- failover test (" << if_name << ") --" << endl;
+
+     int if_index = if_nametoindex(if_name);
+     mroute_netlink m;
+     struct mr_cache_table t;
+     if(if_index == 0 || !m.init(addr_family) || !m.dump_routes(t)){
+          cout << "dump routes ==>FAILED!" << endl;
+          return;
+     }
+
+     unsigned int routes = count_routes(t, if_index);
+     if(routes == 0){
+          cout << "no route with the input interface " << if_name << " ==>FAILED!" << endl;
+          return;
+     }
+     cout << "routes on " << if_name << ": " << routes << endl;
+
+     struct timeval start, end;
+     long elapsed;
+
+     //failover, mcproxy sends DEL_UPSTREAM after the link is down
+     if(!set_link(if_name, false)){
+          cout << "set link down ==>FAILED!" << endl;
+          return;
+     }
+     gettimeofday(&start, NULL);
+     do{
+          usleep(1000);
+          gettimeofday(&end, NULL);
+          elapsed = (end.tv_sec - start.tv_sec) * 1000000 + (end.tv_usec - start.tv_usec);
+     }while(m.dump_routes(t) && count_routes(t, if_index) > 0 && elapsed < timeout * 1000);
+
+     if(t.size > 0 && count_routes(t, if_index) == 0){
+          cout << "failover: " << elapsed << " usec, " << t.size << " routes ==>OK!" << endl;
+     }else{
+          cout << "failover: " << count_routes(t, if_index) << " routes left after " << elapsed << " usec ==>FAILED!" << endl;
+     }
+
+     //failback, mcproxy sends ADD_UPSTREAM after the link is up and the groups move back
+     if(!set_link(if_name, true)){
+          cout << "set link up ==>FAILED!" << endl;
+          return;
+     }
+     gettimeofday(&start, NULL);
+     do{
+          usleep(1000);
+          gettimeofday(&end, NULL);
+          elapsed = (end.tv_sec - start.tv_sec) * 1000000 + (end.tv_usec - start.tv_usec);
+     }while(m.dump_routes(t) && count_routes(t, if_index) < routes && elapsed < timeout * 1000);
+
+     if(count_routes(t, if_index) >= routes){
+          cout << "failback: " << elapsed << " usec ==>OK!" << endl;
+     }else{
+          cout << "failback: " << count_routes(t, if_index) << " of " << routes << " routes after " << elapsed << " usec ==>FAILED!" << endl;
+     }
+}
@@ -22,12 +22,14 @@
 
 #include "include/hamcast_logging.h"
 #include "include/utils/mroute_socket.hpp"
+#include "include/utils/mc_msg_format.hpp"
 
 #include <netinet/icmp6.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 //#include <linux/in6.h>
 #include <net/if.h>
+#include <sys/ioctl.h>
 #include <errno.h>
 #include <arpa/inet.h>
 #include <linux/mroute.h>
@@ -113,16 +115,120 @@ u_int16_t mroute_socket::calc_checksum(const unsigned char* buf, int buf_size){
      HC_LOG_TRACE("");
 
      u_int16_t* b=(u_int16_t*)buf;
-     int sum=0;
+     u_int32_t sum=0;
 
      for(int i=0; i<buf_size/2;i++){
-          ADD_SIGNED_NUM_U16(sum,b[i]);
-          //sum +=b[i];
+          sum +=b[i];
      }
 
      if(buf_size%2==1){
-          //sum += buf[buf_size-1];
-          ADD_SIGNED_NUM_U16(sum,buf[buf_size-1]);
+          sum += buf[buf_size-1];
+     }
+
+     //fold the carries back into the lower 16 bit
+     while(sum >> 16){
+          sum = (sum & 0xffff) + (sum >> 16);
+     }
+
+     return ~sum;
+}
+
+bool mroute_socket::send_packets(const struct mroute_socket_packet* packets, unsigned int count){
+     HC_LOG_TRACE("count: " << count);
+
+     if (!is_udp_valid()) {
+          HC_LOG_ERROR("raw_socket invalid");
+          return false;
+     }
+
+     if(m_addrFamily != AF_INET && m_addrFamily != AF_INET6){
+          HC_LOG_ERROR("wrong address family: " << m_addrFamily);
+          return false;
+     }
+
+     unsigned int batch = (count < MROUTE_SOCKET_MAX_BATCH)? count : MROUTE_SOCKET_MAX_BATCH;
+     const unsigned int cmsg_space = (m_addrFamily == AF_INET)? CMSG_SPACE(sizeof(struct in_pktinfo)) : CMSG_SPACE(sizeof(struct in6_pktinfo));
+     if(m_mmsg.size() < batch){
+          m_mmsg.resize(batch);
+          m_iov.resize(batch);
+     }
+     if(m_cmsg.size() < batch * cmsg_space){
+          m_cmsg.resize(batch * cmsg_space);
+     }
+
+     bool correct = true;
+     unsigned int next = 0;
+     while(next < count){
+          unsigned int n = (count - next < batch)? count - next : batch;
+
+          memset(&m_mmsg[0], 0, n * sizeof(struct mmsghdr));
+          memset(&m_cmsg[0], 0, n * cmsg_space);
+          for(unsigned int i = 0; i < n; i++){
+               const struct mroute_socket_packet& p = packets[next + i];
+               struct msghdr& msg = m_mmsg[i].msg_hdr;
+
+               m_iov[i].iov_base = (void*)p.data;
+               m_iov[i].iov_len = p.data_size;
+
+               msg.msg_name = (void*)p.dst;
+               msg.msg_namelen = p.dst_len;
+               msg.msg_iov = &m_iov[i];
+               msg.msg_iovlen = 1;
+               msg.msg_control = &m_cmsg[i * cmsg_space];
+               msg.msg_controllen = cmsg_space;
+
+               struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+               if(m_addrFamily == AF_INET){
+                    cmsg->cmsg_level = IPPROTO_IP;
+                    cmsg->cmsg_type = IP_PKTINFO;
+                    cmsg->cmsg_len = CMSG_LEN(sizeof(struct in_pktinfo));
+                    ((struct in_pktinfo*)CMSG_DATA(cmsg))->ipi_ifindex = p.if_index;
+                    if(p.src != NULL){
+                         ((struct in_pktinfo*)CMSG_DATA(cmsg))->ipi_spec_dst = *(const struct in_addr*)p.src;
+                    }
+               }else{
+                    cmsg->cmsg_level = IPPROTO_IPV6;
+                    cmsg->cmsg_type = IPV6_PKTINFO;
+                    cmsg->cmsg_len = CMSG_LEN(sizeof(struct in6_pktinfo));
+                    ((struct in6_pktinfo*)CMSG_DATA(cmsg))->ipi6_ifindex = p.if_index;
+                    if(p.src != NULL){
+                         ((struct in6_pktinfo*)CMSG_DATA(cmsg))->ipi6_addr = *(const struct in6_addr*)p.src;
+                    }
+               }
+          }
+
+          int rc = sendmmsg(m_sock, &m_mmsg[0], n, 0);
+          if(rc < 0){
+               if(errno == EINTR){
+                    continue;
+               }
+
+               //the first packet of the batch failed, skip it
+               HC_LOG_ERROR("failed to send packet to if_index: " << packets[next].if_index << "! Error: " << strerror(errno) << " errno: " << errno);
+               correct = false;
+               next++;
+          }else{
+               next += rc;
+          }
+     }
+
+     return correct;
+}
+
+//called for every group specific query, it does not trace
+u_int16_t mroute_socket::update_checksum(u_int16_t cksum, const unsigned char* old_data, const unsigned char* new_data, int size){
+     const u_int16_t* o=(const u_int16_t*)old_data;
+     const u_int16_t* n=(const u_int16_t*)new_data;
+     u_int32_t sum = (u_int16_t)~cksum;
+
+     //HC' = ~(~HC + ~m + m')
+     for(int i=0; i<size/2; i++){
+          sum += (u_int16_t)~o[i];
+          sum += n[i];
+     }
+
+     while(sum >> 16){
+          sum = (sum & 0xffff) + (sum >> 16);
      }
 
      return ~sum;
@@ -163,8 +269,14 @@ bool mroute_socket::add_extension_header(const unsigned char* buf, unsigned int
      }
 
      if(m_addrFamily == AF_INET){
-          HC_LOG_ERROR("this funktion is only available vor IPv6 sockets ");
-          return false;
+          int rc= setsockopt(m_sock,IPPROTO_IP, IP_OPTIONS, buf, buf_size);
+
+          if(rc == -1){
+               HC_LOG_ERROR("failed to add ip options! Error: " << strerror(errno) << " errno: " << errno);
+               return false;
+          }else{
+               return true;
+          }
      }else if(m_addrFamily == AF_INET6){
           int rc= setsockopt(m_sock,IPPROTO_IPV6, IPV6_HOPOPTS, buf, buf_size);
 
@@ -198,6 +310,8 @@ bool mroute_socket::set_recv_icmpv6_msg(){
           ICMP6_FILTER_SETBLOCKALL(&myfilter);
           ICMP6_FILTER_SETPASS(MLD_LISTENER_REPORT, &myfilter);
           ICMP6_FILTER_SETPASS(MLD_LISTENER_REDUCTION, &myfilter);
+          ICMP6_FILTER_SETPASS(MLD_LISTENER_QUERY, &myfilter);
+          ICMP6_FILTER_SETPASS(MC_MSG_MLDV2_LISTENER_REPORT, &myfilter);
 
 
           if(setsockopt(m_sock,IPPROTO_ICMPV6,ICMP6_FILTER, &myfilter,sizeof(myfilter)) < 0){
@@ -620,6 +734,54 @@ bool mroute_socket::del_mroute(int input_vifNum, const char* source_addr, const
      return false;
 }
 
+bool mroute_socket::get_mroute_stats(const addr_storage& source_addr, const addr_storage& group_addr, unsigned long* pkt_cnt, unsigned long* byte_cnt, unsigned long* wrong_if) const{
+     HC_LOG_TRACE("");
+
+     if (!is_udp_valid()) {
+          HC_LOG_ERROR("raw_socket invalid");
+          return false;
+     }
+
+     if(m_addrFamily == AF_INET){
+          struct sioc_sg_req sg_req;
+          memset(&sg_req, 0, sizeof(sg_req));
+
+          sg_req.src <<= source_addr;
+          sg_req.grp <<= group_addr;
+
+          if(ioctl(m_sock, SIOCGETSGCNT, &sg_req) < 0){
+               HC_LOG_DEBUG("failed to get multicast route counters! Error: " << strerror(errno) << " errno: " << errno);
+               return false;
+          }
+
+          if(pkt_cnt != NULL) *pkt_cnt = sg_req.pktcnt;
+          if(byte_cnt != NULL) *byte_cnt = sg_req.bytecnt;
+          if(wrong_if != NULL) *wrong_if = sg_req.wrong_if;
+          return true;
+     }else if(m_addrFamily == AF_INET6){
+          struct sioc_sg_req6 sg_req;
+          memset(&sg_req, 0, sizeof(sg_req));
+
+          sg_req.src.sin6_family = AF_INET6;
+          sg_req.src.sin6_addr <<= source_addr;
+          sg_req.grp.sin6_family = AF_INET6;
+          sg_req.grp.sin6_addr <<= group_addr;
+
+          if(ioctl(m_sock, SIOCGETSGCNT_IN6, &sg_req) < 0){
+               HC_LOG_DEBUG("failed to get multicast route counters! Error: " << strerror(errno) << " errno: " << errno);
+               return false;
+          }
+
+          if(pkt_cnt != NULL) *pkt_cnt = sg_req.pktcnt;
+          if(byte_cnt != NULL) *byte_cnt = sg_req.bytecnt;
+          if(wrong_if != NULL) *wrong_if = sg_req.wrong_if;
+          return true;
+     }else{
+          HC_LOG_ERROR("wrong address family");
+          return false;
+     }
+}
+
 void mroute_socket::print_struct_mf6cctl(struct mf6cctl* mc){
      HC_LOG_TRACE("");
 
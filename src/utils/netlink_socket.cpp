@@ -0,0 +1,230 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * mcproxy is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * mcproxy is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with mcproxy; see the file COPYING.LESSER.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+
+
+#include "include/hamcast_logging.h"
+#include "include/utils/netlink_socket.hpp"
+
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <errno.h>
+#include <cstring>
+
+netlink_socket::netlink_socket():
+     m_sock(-1), m_seq(0), m_pid(0)
+{
+     HC_LOG_TRACE("");
+}
+
+netlink_socket::~netlink_socket(){
+     HC_LOG_TRACE("");
+
+     close_socket();
+}
+
+bool netlink_socket::create_rtnl_socket(unsigned int groups){
+     HC_LOG_TRACE("groups: " << groups);
+
+     close_socket();
+
+     m_sock = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+     if(m_sock < 0){
+          HC_LOG_ERROR("failed to create netlink socket! Error: " << strerror(errno) << " errno: " << errno);
+          return false;
+     }
+
+     struct sockaddr_nl addr;
+     memset(&addr, 0, sizeof(addr));
+     addr.nl_family = AF_NETLINK;
+     addr.nl_groups = groups;
+
+     if(bind(m_sock, (struct sockaddr*)&addr, sizeof(addr)) < 0){
+          HC_LOG_ERROR("failed to bind netlink socket! Error: " << strerror(errno) << " errno: " << errno);
+          close_socket();
+          return false;
+     }
+
+     socklen_t addr_len = sizeof(addr);
+     if(getsockname(m_sock, (struct sockaddr*)&addr, &addr_len) < 0){
+          HC_LOG_ERROR("failed to get netlink port id! Error: " << strerror(errno) << " errno: " << errno);
+          close_socket();
+          return false;
+     }
+     m_pid = addr.nl_pid;
+
+     struct timeval tv;
+     gettimeofday(&tv, NULL);
+     m_seq = tv.tv_sec;
+
+     return true;
+}
+
+void netlink_socket::close_socket(){
+     HC_LOG_TRACE("");
+
+     if(m_sock >= 0){
+          close(m_sock);
+          m_sock = -1;
+     }
+}
+
+int netlink_socket::get_socket() const{
+     HC_LOG_TRACE("");
+     return m_sock;
+}
+
+unsigned int netlink_socket::get_pid() const{
+     HC_LOG_TRACE("");
+     return m_pid;
+}
+
+bool netlink_socket::send(const void* buf, unsigned int size){
+     HC_LOG_TRACE("size: " << size);
+
+     struct sockaddr_nl kernel;
+     memset(&kernel, 0, sizeof(kernel));
+     kernel.nl_family = AF_NETLINK;
+
+     struct iovec iov;
+     iov.iov_base = (void*)buf;
+     iov.iov_len = size;
+
+     struct msghdr msg;
+     memset(&msg, 0, sizeof(msg));
+     msg.msg_name = &kernel;
+     msg.msg_namelen = sizeof(kernel);
+     msg.msg_iov = &iov;
+     msg.msg_iovlen = 1;
+
+     for(;;){
+          if(sendmsg(m_sock, &msg, 0) < 0){
+               if(errno == EINTR){
+                    continue;
+               }
+               HC_LOG_ERROR("failed to send netlink message! Error: " << strerror(errno) << " errno: " << errno);
+               return false;
+          }
+          return true;
+     }
+}
+
+int netlink_socket::receive(vector<char>& buf, bool dont_wait){
+     HC_LOG_TRACE("");
+
+     if(buf.size() < NETLINK_SOCKET_RECV_BUF_SIZE){
+          buf.resize(NETLINK_SOCKET_RECV_BUF_SIZE);
+     }
+
+     struct sockaddr_nl from;
+     struct iovec iov;
+     iov.iov_base = &buf[0];
+     iov.iov_len = buf.size();
+
+     struct msghdr msg;
+     memset(&msg, 0, sizeof(msg));
+     msg.msg_name = &from;
+     msg.msg_namelen = sizeof(from);
+     msg.msg_iov = &iov;
+     msg.msg_iovlen = 1;
+
+     for(;;){
+          int rc = recvmsg(m_sock, &msg, dont_wait? MSG_DONTWAIT : 0);
+          if(rc < 0){
+               if(errno == EINTR){
+                    continue;
+               }else if(errno == EAGAIN || errno == EWOULDBLOCK){
+                    return 0;
+               }
+               HC_LOG_ERROR("failed to receive netlink message! Error: " << strerror(errno) << " errno: " << errno);
+               return -1;
+          }
+
+          if(from.nl_pid != 0){ //only accept messages from the kernel
+               HC_LOG_DEBUG("ignore netlink message from port id: " << from.nl_pid);
+               continue;
+          }
+
+          if(msg.msg_flags & MSG_TRUNC){
+               HC_LOG_ERROR("netlink message truncated");
+               return -1;
+          }
+
+          return rc;
+     }
+}
+
+bool netlink_socket::set_receive_timeout(long msec){
+     HC_LOG_TRACE("msec: " << msec);
+
+     struct timeval t;
+     t.tv_sec = msec / 1000;
+     t.tv_usec = 1000 * (msec % 1000);
+
+     if(setsockopt(m_sock, SOL_SOCKET, SO_RCVTIMEO, (char *)&t, sizeof(t)) < 0){
+          HC_LOG_ERROR("failed to set timeout! Error: " << strerror(errno) << " errno: " << errno);
+          return false;
+     }
+     return true;
+}
+
+bool netlink_socket::set_receive_buffer(int size){
+     HC_LOG_TRACE("size: " << size);
+
+     //SO_RCVBUFFORCE ignores rmem_max but needs CAP_NET_ADMIN
+     if(setsockopt(m_sock, SOL_SOCKET, SO_RCVBUFFORCE, &size, sizeof(size)) < 0){
+          if(setsockopt(m_sock, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size)) < 0){
+               HC_LOG_ERROR("failed to set receive buffer! Error: " << strerror(errno) << " errno: " << errno);
+               return false;
+          }
+     }
+     return true;
+}
+
+//called for every attribute of a message, it does not trace
+struct rtattr* netlink_socket::add_attr(struct nlmsghdr* nlh, unsigned int max_size, int type, const void* data, unsigned int size){
+     unsigned int len = RTA_LENGTH(size);
+     if(NLMSG_ALIGN(nlh->nlmsg_len) + RTA_ALIGN(len) > max_size){
+          HC_LOG_ERROR("netlink message buffer to small for attribute: " << type);
+          return NULL;
+     }
+
+     struct rtattr* rta = (struct rtattr*)(((char*)nlh) + NLMSG_ALIGN(nlh->nlmsg_len));
+     rta->rta_type = type;
+     rta->rta_len = len;
+     if(size > 0){
+          memcpy(RTA_DATA(rta), data, size);
+     }
+     nlh->nlmsg_len = NLMSG_ALIGN(nlh->nlmsg_len) + RTA_ALIGN(len);
+     return rta;
+}
+
+//called for every received message, it does not trace
+void netlink_socket::parse_attr(struct rtattr* tb[], int max, struct rtattr* rta, int len){
+     memset(tb, 0, sizeof(struct rtattr*) * (max + 1));
+     while(RTA_OK(rta, len)){
+          if(rta->rta_type <= max){
+               tb[rta->rta_type] = rta;
+          }
+          rta = RTA_NEXT(rta, len);
+     }
+}